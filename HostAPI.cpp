@@ -3,9 +3,11 @@
 #include <regex>
 #include <unordered_set>
 #include <mutex>
+#include <algorithm>
 
 #include "HostAPI.h"
 #include "pad.h"
+#include "pad_samples.h"
 
 namespace PAD {
 	using namespace std;
@@ -22,6 +24,210 @@ namespace PAD {
 		void Catch(HardError he) { throw he; }
 	};
 
+	void StreamMix::Compile(const vector<float>& gains, const vector<ChannelRoute>& channelRoutes, unsigned channels, const vector<unsigned>& callBegins) {
+		gain.clear( );
+		routeBegin.clear( );
+		routes.clear( );
+		crossChannels.clear( );
+		crossBegin.assign(1, 0);
+		crossGain.clear( );
+		crossRoutes.clear( );
+
+		vector<float> channelGain(channels, 1.f);
+		for (unsigned i(0); i < gains.size( ) && i < channels; ++i) channelGain[i] = gains[i];
+		vector<ChannelRoute> valid;
+		vector<bool> routed(channels, false);
+		for (auto& r : channelRoutes) {
+			if (r.destination < channels && r.source < channels) {
+				valid.push_back(r);
+				routed[r.destination] = true;
+			}
+		}
+
+		/* a destination routed from another call is mixed across calls; so are the mixed
+		   sources it needs unmixed, and the destinations reading what it overwrites */
+		auto call = [&](unsigned channel) { return upper_bound(callBegins.begin( ), callBegins.end( ), channel) - callBegins.begin( ); };
+		vector<bool> cross(channels, false);
+		for (auto& r : valid) if (call(r.source) != call(r.destination)) cross[r.destination] = true;
+		for (bool grown(true); grown;) {
+			grown = false;
+			for (auto& r : valid) {
+				if (cross[r.destination] && cross[r.source] == false && (channelGain[r.source] != 1.f || routed[r.source])) grown = cross[r.source] = true;
+				if (cross[r.source] && cross[r.destination] == false) grown = cross[r.destination] = true;
+			}
+		}
+
+		for (unsigned i(0); i < channels; ++i) {
+			if (cross[i]) {
+				crossChannels.push_back(i);
+				crossGain.push_back(channelGain[i]);
+				for (auto& r : valid) if (r.destination == i) crossRoutes.push_back(Converter::RouteTerm{ r.source, r.gain });
+				crossBegin.push_back((unsigned)crossRoutes.size( ));
+				channelGain[i] = 1.f;
+			}
+		}
+		crossRow.resize(crossChannels.size( ));
+
+		for (unsigned i(0); i < channels; ++i) {
+			if (channelGain[i] != 1.f) {
+				gain = channelGain;
+				break;
+			}
+		}
+
+		/* rows of the sparse routing matrix, by destination channel */
+		vector<unsigned> count(channels + 1, 0);
+		for (auto& r : valid) if (cross[r.destination] == false) count[r.destination + 1]++;
+		for (unsigned i(0); i < channels; ++i) count[i + 1] += count[i];
+		if (count[channels] == 0) return;
+
+		routeBegin = count;
+		routes.resize(count[channels]);
+		for (auto& r : valid) {
+			if (cross[r.destination] == false) routes[count[r.destination]++] = Converter::RouteTerm{ r.source, r.gain };
+		}
+	}
+
+	Converter::FusedStages StreamMix::Stages(unsigned first, const Converter::DitherState* dither) const {
+		return Converter::FusedStages{ first,
+			gain.empty( ) ? nullptr : gain.data( ),
+			routeBegin.empty( ) ? nullptr : routeBegin.data( ),
+			routes.data( ), dither };
+	}
+
+	void LimitToConverters(AudioStreamConfiguration& cfg) {
+		auto fmt = cfg.GetCanonicalFormat( );
+		if (fmt == CanonicalFormat::Int32 || fmt == CanonicalFormat::Int16) {
+			cfg.SetPlanar(false);
+			cfg.SetDither(DitherMode::None);
+			cfg.ClearGains( );
+			cfg.ClearRoutes( );
+		}
+	}
+
+	vector<unsigned> PlanarCalls(unsigned numChannels) {
+		vector<unsigned> calls(numChannels);
+		for (unsigned c(0); c < numChannels; ++c) calls[c] = c;
+		return calls;
+	}
+
+	void LimitToDeviceBuffers(AudioStreamConfiguration& cfg) {
+		cfg.SetCanonicalFormat(CanonicalFormat::Float32);
+		cfg.SetPlanar(false);
+		cfg.SetDither(DitherMode::None);
+		cfg.ClearGains( );
+		cfg.ClearRoutes( );
+	}
+
+	static const Converter::HostFormat blockFormat = SYSTEM_BIGENDIAN ? Converter::HostFormat::Float32MSB : Converter::HostFormat::Float32LSB;
+
+	void BlockStream::Prepare(const AudioStreamConfiguration& cfg) {
+		config = &cfg;
+		numInputs = cfg.GetNumStreamInputs( );
+		numOutputs = cfg.GetNumStreamOutputs( );
+		bufferFrames = cfg.GetBufferSize( );
+		auto canon = cfg.GetCanonicalFormat( );
+		f32 = canon == CanonicalFormat::Float32;
+		f64 = canon == CanonicalFormat::Float64;
+		planar = cfg.IsPlanar( );
+
+		inputBuffer.assign(f32 ? numInputs * bufferFrames : 0, 0.f);
+		outputBuffer.assign(f32 ? numOutputs * bufferFrames : 0, 0.f);
+		inputBuffer64.assign(f64 ? numInputs * bufferFrames : 0, 0.0);
+		outputBuffer64.assign(f64 ? numOutputs * bufferFrames : 0, 0.0);
+		inputBuffer32.assign(canon == CanonicalFormat::Int32 ? numInputs * bufferFrames : 0, 0);
+		outputBuffer32.assign(canon == CanonicalFormat::Int32 ? numOutputs * bufferFrames : 0, 0);
+		inputBuffer16.assign(canon == CanonicalFormat::Int16 ? numInputs * bufferFrames : 0, 0);
+		outputBuffer16.assign(canon == CanonicalFormat::Int16 ? numOutputs * bufferFrames : 0, 0);
+		inputChannels.assign(planar && f32 ? numInputs : 0, nullptr);
+		outputChannels.assign(planar && f32 ? numOutputs : 0, nullptr);
+		if (planar && f64) {
+			PlanarChannels(inputChannels64, inputBuffer64.data( ), numInputs, bufferFrames);
+			PlanarChannels(outputChannels64, outputBuffer64.data( ), numOutputs, bufferFrames);
+		} else {
+			inputChannels64.clear( );
+			outputChannels64.clear( );
+		}
+
+		/* planar streams convert one block at a time */
+		inputMix.Compile(cfg.GetInputGains( ), cfg.GetInputRoutes( ), numInputs, planar ? PlanarCalls(numInputs) : vector<unsigned>( ));
+		outputMix.Compile(cfg.GetOutputGains( ), cfg.GetOutputRoutes( ), numOutputs, planar ? PlanarCalls(numOutputs) : vector<unsigned>( ));
+		inputConverter = &Converter::GetChannelKernels(blockFormat, planar ? 1 : numInputs);
+		outputConverter = &Converter::GetChannelKernels(blockFormat, planar ? 1 : numOutputs);
+	}
+
+	IO BlockStream::Interleave(const void **inputBlocks, void **outputBlocks, unsigned frames, chrono::microseconds inputTime, chrono::microseconds outputTime) {
+		auto canon = config->GetCanonicalFormat( );
+		if (planar) {
+			for (unsigned c(0); c < numInputs; ++c) {
+				auto stages = inputMix.Stages(c);
+				if (f64) {
+					if (inputMix.Empty( )) inputConverter->Interleave64(inputBuffer64.data( ) + c * bufferFrames, inputBlocks + c, frames, 1, 1);
+					else inputConverter->InterleaveFused64(inputBuffer64.data( ) + c * bufferFrames, inputBlocks + c, frames, 1, 1, stages);
+				} else if (inputMix.Empty( )) inputChannels[c] = (const float*)inputBlocks[c];
+				else {
+					inputConverter->InterleaveFused(inputBuffer.data( ) + c * bufferFrames, inputBlocks + c, frames, 1, 1, stages);
+					inputChannels[c] = inputBuffer.data( ) + c * bufferFrames;
+				}
+			}
+			if (f64) inputMix.MixAcrossCalls(inputBuffer64.data( ), frames, 1, bufferFrames);
+			else inputMix.MixAcrossCalls(inputBuffer.data( ), frames, 1, bufferFrames);
+			if (f64 == false) for (unsigned c(0); c < numOutputs; ++c) {
+				outputChannels[c] = outputMix.Empty( ) ? (float*)outputBlocks[c] : outputBuffer.data( ) + c * bufferFrames;
+			}
+		} else if (numInputs) {
+			if (inputMix.Empty( ) == false) {
+				auto stages = inputMix.Stages(0);
+				if (f64) inputConverter->InterleaveFused64(inputBuffer64.data( ), inputBlocks, frames, numInputs, numInputs, stages);
+				else inputConverter->InterleaveFused(inputBuffer.data( ), inputBlocks, frames, numInputs, numInputs, stages);
+			}
+			else if (f64) inputConverter->Interleave64(inputBuffer64.data( ), inputBlocks, frames, numInputs, numInputs);
+			else if (canon == CanonicalFormat::Int32) inputConverter->InterleaveInt32(inputBuffer32.data( ), inputBlocks, frames, numInputs, numInputs);
+			else if (canon == CanonicalFormat::Int16) inputConverter->InterleaveInt16(inputBuffer16.data( ), inputBlocks, frames, numInputs, numInputs);
+			else inputConverter->Interleave(inputBuffer.data( ), inputBlocks, frames, numInputs, numInputs);
+		}
+
+		return IO{ *config,
+			f32 && !planar ? inputBuffer.data( ) : nullptr,
+			f32 && !planar ? outputBuffer.data( ) : nullptr,
+			frames, inputTime, outputTime,
+			f64 && !planar ? inputBuffer64.data( ) : nullptr,
+			f64 && !planar ? outputBuffer64.data( ) : nullptr,
+			planar && f32 ? inputChannels.data( ) : nullptr,
+			planar && f32 ? outputChannels.data( ) : nullptr,
+			planar && f64 ? inputChannels64.data( ) : nullptr,
+			planar && f64 ? outputChannels64.data( ) : nullptr,
+			inputBuffer32.empty( ) ? nullptr : inputBuffer32.data( ),
+			outputBuffer32.empty( ) ? nullptr : outputBuffer32.data( ),
+			inputBuffer16.empty( ) ? nullptr : inputBuffer16.data( ),
+			outputBuffer16.empty( ) ? nullptr : outputBuffer16.data( ) };
+	}
+
+	void BlockStream::DeInterleave(void **outputBlocks, unsigned frames) {
+		auto canon = config->GetCanonicalFormat( );
+		if (planar) {
+			if (f64 == false && outputMix.Empty( )) return;
+			if (f64) outputMix.MixAcrossCalls(outputBuffer64.data( ), frames, 1, bufferFrames);
+			else outputMix.MixAcrossCalls(outputBuffer.data( ), frames, 1, bufferFrames);
+			for (unsigned c(0); c < numOutputs; ++c) {
+				auto stages = outputMix.Stages(c);
+				if (f64 == false) outputConverter->DeInterleaveFused(outputChannels[c], outputBlocks + c, frames, 1, 1, stages);
+				else if (outputMix.Empty( )) outputConverter->DeInterleave64(outputChannels64[c], outputBlocks + c, frames, 1, 1);
+				else outputConverter->DeInterleaveFused64(outputChannels64[c], outputBlocks + c, frames, 1, 1, stages);
+			}
+		} else if (numOutputs) {
+			if (outputMix.Empty( ) == false) {
+				auto stages = outputMix.Stages(0);
+				if (f64) outputConverter->DeInterleaveFused64(outputBuffer64.data( ), outputBlocks, frames, numOutputs, numOutputs, stages);
+				else outputConverter->DeInterleaveFused(outputBuffer.data( ), outputBlocks, frames, numOutputs, numOutputs, stages);
+			}
+			else if (f64) outputConverter->DeInterleave64(outputBuffer64.data( ), outputBlocks, frames, numOutputs, numOutputs);
+			else if (canon == CanonicalFormat::Int32) outputConverter->DeInterleaveInt32(outputBuffer32.data( ), outputBlocks, frames, numOutputs, numOutputs);
+			else if (canon == CanonicalFormat::Int16) outputConverter->DeInterleaveInt16(outputBuffer16.data( ), outputBlocks, frames, numOutputs, numOutputs);
+			else outputConverter->DeInterleave(outputBuffer.data( ), outputBlocks, frames, numOutputs, numOutputs);
+		}
+	}
+
 	HostAPIPublisher::HostAPIPublisher( ) {
 		/* todo: lock thread access */
 		AvailablePublishers( ).push_back(this);
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include "pad.h"
+#include "pad_converters.h"
 
 namespace PAD{
 	class HostAPIPublisher : public IHostAPI {
@@ -12,4 +13,92 @@ namespace PAD{
 		virtual void Publish(Session&, DeviceErrorDelegate&) = 0;
 		virtual void Cleanup(Session&) {};
 	};
+
+	/* gains and routes of one stream direction, compiled for the fused channel converters;
+	   routes referring to channels outside the stream are ignored.
+	   A kernel call only sees its own blocks, or its own planar channel, so a destination
+	   routed from another call is left out of the fused stages, together with the mixed
+	   channels it is connected to. Those few channels are mixed in the canonical buffer by
+	   MixAcrossCalls, after the input calls or before the output calls */
+	class StreamMix {
+		std::vector<float> gain;
+		std::vector<unsigned> routeBegin;
+		std::vector<Converter::RouteTerm> routes;
+		/* destinations mixed across calls, with their gains and rows of routes */
+		std::vector<unsigned> crossChannels, crossBegin;
+		std::vector<float> crossGain, crossRow;
+		std::vector<Converter::RouteTerm> crossRoutes;
+	public:
+		/* callBegins holds the first channel of each kernel call in ascending order; empty
+		   when all channels are converted in one call */
+		void Compile(const std::vector<float>& gains, const std::vector<ChannelRoute>& routes, unsigned channels, const std::vector<unsigned>& callBegins = { });
+		bool Empty( ) const { return gain.empty( ) && routeBegin.empty( ) && crossChannels.empty( ); }
+		Converter::FusedStages Stages(unsigned first, const Converter::DitherState* dither = nullptr) const;
+
+		/* mixes the channels routed across calls in place; sample c of frame i is at
+		   buffer[i * frameStride + c * channelStride] */
+		template <typename CANON> void MixAcrossCalls(CANON *buffer, unsigned frames, size_t frameStride, size_t channelStride);
+	};
+
+	template <typename CANON> void StreamMix::MixAcrossCalls(CANON *buffer, unsigned frames, size_t frameStride, size_t channelStride) {
+		if (crossChannels.empty( )) return;
+		/* every destination of a frame is summed from the unmixed samples before any is stored */
+		for (unsigned i(0); i < frames; ++i, buffer += frameStride) {
+			for (unsigned d(0); d < crossChannels.size( ); ++d) {
+				float sum(crossBegin[d] == crossBegin[d + 1] ? float(buffer[crossChannels[d] * channelStride]) : 0.f);
+				for (unsigned t(crossBegin[d]); t < crossBegin[d + 1]; ++t) sum += crossRoutes[t].gain * float(buffer[crossRoutes[t].source * channelStride]);
+				crossRow[d] = sum * crossGain[d];
+			}
+			for (unsigned d(0); d < crossChannels.size( ); ++d) buffer[crossChannels[d] * channelStride] = CANON(crossRow[d]);
+		}
+	}
+
+	/* drops the parts of a configuration the converter kernels can not apply: integer
+	   canonical streams are interleaved and unmixed */
+	void LimitToConverters(AudioStreamConfiguration&);
+
+	/* the first channel of each kernel call of a stream that converts numChannels one at a
+	   time, for StreamMix::Compile */
+	std::vector<unsigned> PlanarCalls(unsigned numChannels);
+
+	/* for backends that pass their own interleaved float buffers to the client without a
+	   stream mix: Float32, interleaved, without gains, routes or dither */
+	void LimitToDeviceBuffers(AudioStreamConfiguration&);
+
+	/* channel pointers into a planar buffer holding frames samples of each channel in turn */
+	template <typename PTR, typename SAMPLE> void PlanarChannels(std::vector<PTR>& channels, SAMPLE *buffer, unsigned numChannels, unsigned frames) {
+		channels.resize(numChannels);
+		for (unsigned c(0); c < numChannels; ++c) channels[c] = buffer + c * frames;
+	}
+
+	/* client side of a stream whose device buffers are native float blocks, one per stream
+	   channel: holds the client buffers of the canonical format and converts the blocks to
+	   and from them around the buffer switch. Planar float streams use the blocks in place
+	   unless they are mixed */
+	class BlockStream {
+		const AudioStreamConfiguration *config = nullptr;
+		unsigned numInputs = 0, numOutputs = 0, bufferFrames = 0;
+		bool f32 = true, f64 = false, planar = false;
+		std::vector<float> inputBuffer, outputBuffer;
+		std::vector<double> inputBuffer64, outputBuffer64;
+		std::vector<int32_t> inputBuffer32, outputBuffer32;
+		std::vector<int16_t> inputBuffer16, outputBuffer16;
+		std::vector<const float*> inputChannels;
+		std::vector<float*> outputChannels;
+		std::vector<const double*> inputChannels64;
+		std::vector<double*> outputChannels64;
+		StreamMix inputMix, outputMix;
+		const Converter::ChannelKernels *inputConverter = nullptr;
+		const Converter::ChannelKernels *outputConverter = nullptr;
+	public:
+		/* sized for the stream channels and buffer size of cfg, which must outlive the stream */
+		void Prepare(const AudioStreamConfiguration& cfg);
+
+		/* converts the input blocks and returns the IO of the buffer switch; frames may be
+		   less than the buffer size */
+		IO Interleave(const void **inputBlocks, void **outputBlocks, unsigned frames, std::chrono::microseconds inputTime, std::chrono::microseconds outputTime);
+
+		/* converts the client output of the buffer switch to the output blocks */
+		void DeInterleave(void **outputBlocks, unsigned frames);
+	};
 }
@@ -3,14 +3,15 @@
 #include <numeric>
 #include <ostream>
 #include <algorithm>
+#include <cmath>
 
 
 namespace PAD {
 	using namespace std;
-	const char* VersionString( ) { return "1.1.0"; }
+	const char* VersionString( ) { return "2.0.0"; }
 
 	AudioStreamConfiguration::AudioStreamConfiguration(double samplerate, bool valid)
-		:sampleRate(samplerate), valid(valid), startSuspended(false), numStreamIns(0), numStreamOuts(0), bufferSize(512) { }
+		:sampleRate(samplerate), valid(valid), startSuspended(false), numStreamIns(0), numStreamOuts(0), bufferSize(512), canonicalFormat(CanonicalFormat::Float32), dither(DitherMode::None), planar(false) { }
 
 	enum RangeFindResult {
 		In,
@@ -154,6 +155,44 @@ namespace PAD {
         auto tmp(*this); tmp.SetSuspendOnStartup(true); return tmp;
     }
 
+	AudioStreamConfiguration AudioStreamConfiguration::Canonical(CanonicalFormat fmt) const {
+		auto tmp(*this); tmp.SetCanonicalFormat(fmt); return tmp;
+	}
+
+	AudioStreamConfiguration AudioStreamConfiguration::Dither(DitherMode mode) const {
+		auto tmp(*this); tmp.SetDither(mode); return tmp;
+	}
+
+	AudioStreamConfiguration AudioStreamConfiguration::Planar( ) const {
+		auto tmp(*this); tmp.SetPlanar(true); return tmp;
+	}
+
+	void AudioStreamConfiguration::SetInputGain(unsigned streamChannel, float gain) {
+		if (streamChannel >= inputGains.size( )) inputGains.resize(streamChannel + 1, 1.f);
+		inputGains[streamChannel] = gain;
+	}
+
+	void AudioStreamConfiguration::SetOutputGain(unsigned streamChannel, float gain) {
+		if (streamChannel >= outputGains.size( )) outputGains.resize(streamChannel + 1, 1.f);
+		outputGains[streamChannel] = gain;
+	}
+
+	AudioStreamConfiguration AudioStreamConfiguration::InputGain(unsigned streamChannel, float gain) const {
+		auto tmp(*this); tmp.SetInputGain(streamChannel, gain); return tmp;
+	}
+
+	AudioStreamConfiguration AudioStreamConfiguration::OutputGain(unsigned streamChannel, float gain) const {
+		auto tmp(*this); tmp.SetOutputGain(streamChannel, gain); return tmp;
+	}
+
+	AudioStreamConfiguration AudioStreamConfiguration::InputRoute(unsigned destination, unsigned source, float gain) const {
+		auto tmp(*this); tmp.AddInputRoute(ChannelRoute{ destination, source, gain }); return tmp;
+	}
+
+	AudioStreamConfiguration AudioStreamConfiguration::OutputRoute(unsigned destination, unsigned source, float gain) const {
+		auto tmp(*this); tmp.AddOutputRoute(ChannelRoute{ destination, source, gain }); return tmp;
+	}
+
 
 	static void SetChannelLimits(vector<ChannelRange>& channelRanges, unsigned maxCh) {
 		vector<ChannelRange> newChannelRange;
@@ -172,6 +211,126 @@ namespace PAD {
 		numStreamIns = GetNumChannels(inputRanges);
 		numStreamOuts = GetNumChannels(outputRanges);
 	}
+
+	void DSPLoadMeter::Reset( ) {
+		smoothed.store(0);
+		peak.store(0);
+		ClearHistogram( );
+	}
+
+	void DSPLoadMeter::GetHistogram(uint64_t (&counts)[HistogramBins]) const {
+		for (unsigned i(0); i < HistogramBins; ++i) counts[i] = histogram[i].load(std::memory_order_relaxed);
+	}
+
+	void DSPLoadMeter::ClearHistogram( ) {
+		for (auto& bin : histogram) bin.store(0, std::memory_order_relaxed);
+	}
+
+	void AudioDevice::RaiseXrun(XrunStage stage, uint64_t framesLost) {
+		xruns.count.fetch_add(1, std::memory_order_relaxed);
+		xruns.framesLost.fetch_add(framesLost, std::memory_order_relaxed);
+		XrunOccurred(XrunInfo{ xruns.dispatched.load(std::memory_order_relaxed), framesLost, stage });
+	}
+
+	XrunStage AudioDevice::GetOverrunStage( ) const {
+		if (cycle.Total( ) <= cycle.period) return XrunStage::Scheduling;
+		if (cycle.process >= cycle.input && cycle.process >= cycle.output) return XrunStage::Process;
+		return cycle.input >= cycle.output ? XrunStage::Input : XrunStage::Output;
+	}
+
+	void AudioDevice::DetectTimestampGap(const IO& io) {
+		bool reported = xruns.reported.exchange(false, std::memory_order_relaxed);
+		auto time = io.outputBufferTime.count( ) > 0 ? io.outputBufferTime : io.inputBufferTime;
+		if (time.count( ) <= 0) {
+			lastBufferTime = std::chrono::microseconds(0);
+			return;
+		}
+
+		/* a buffer that starts more than half a period after the previous one ended */
+		if (lastBufferTime.count( ) > 0 && reported == false) {
+			double late = (time - lastBufferTime).count( ) * 1e-6 - lastPeriod;
+			if (late > 0.5 * lastPeriod) RaiseXrun(GetOverrunStage( ), uint64_t(late * io.config.GetSampleRate( ) + 0.5));
+		}
+		lastBufferTime = time;
+		lastPeriod = io.numFrames / io.config.GetSampleRate( );
+	}
+
+	void CycleTimingRing::Reset( ) {
+		for (auto& s : slots) {
+			s.sequence.store(0);
+			s.start.store(0); s.period.store(0);
+			s.input.store(0); s.process.store(0); s.output.store(0);
+		}
+		written.store(0);
+	}
+
+	std::vector<CycleTiming> CycleTimingRing::Snapshot( ) const {
+		uint64_t end = written.load(std::memory_order_acquire);
+		uint64_t begin = end > Capacity ? end - Capacity : 0;
+		std::vector<CycleTiming> timings;
+		timings.reserve(size_t(end - begin));
+		for (uint64_t n(begin); n < end; ++n) {
+			const Slot& s(slots[n % Capacity]);
+			uint64_t seq = s.sequence.load(std::memory_order_acquire);
+			/* a slot the writer has lapped: keep the cycles after it, so that the snapshot is
+			   contiguous */
+			if (seq != 2 * n + 2) { timings.clear( ); continue; }
+			CycleTiming t;
+			t.start = s.start.load(std::memory_order_relaxed);
+			t.period = s.period.load(std::memory_order_relaxed);
+			t.input = s.input.load(std::memory_order_relaxed);
+			t.process = s.process.load(std::memory_order_relaxed);
+			t.output = s.output.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (s.sequence.load(std::memory_order_relaxed) != seq) { timings.clear( ); continue; }
+			timings.push_back(t);
+		}
+		return timings;
+	}
+
+	static double Percentile(std::vector<int64_t>& v, double p) {
+		if (v.empty( )) return 0;
+		size_t i = std::min(v.size( ) - 1, size_t(p * v.size( )));
+		std::nth_element(v.begin( ), v.begin( ) + i, v.end( ));
+		return v[i] * 1e-9;
+	}
+
+	CycleStatistics CycleTimingRing::Analyze(const std::vector<CycleTiming>& timings) {
+		CycleStatistics stats = { };
+		stats.cycles = unsigned(timings.size( ));
+		if (timings.empty( )) return stats;
+
+		std::vector<int64_t> total, input, process, output;
+		int64_t minMargin = timings[0].period - timings[0].Total( );
+		for (auto& t : timings) {
+			total.push_back(t.Total( ));
+			input.push_back(t.input);
+			process.push_back(t.process);
+			output.push_back(t.output);
+			minMargin = std::min(minMargin, t.period - t.Total( ));
+		}
+
+		/* snapshots are contiguous, so each start follows the previous cycle */
+		double sumSquares = 0, maxError = 0;
+		unsigned intervals = 0;
+		for (size_t i(1); i < timings.size( ); ++i) {
+			double error = double(timings[i].start - timings[i - 1].start - timings[i - 1].period);
+			sumSquares += error * error;
+			maxError = std::max(maxError, std::abs(error));
+			++intervals;
+		}
+		if (intervals) stats.intervalJitter = std::sqrt(sumSquares / intervals) * 1e-9;
+		stats.maxIntervalError = maxError * 1e-9;
+
+		stats.p50 = Percentile(total, 0.5);
+		stats.p99 = Percentile(total, 0.99);
+		stats.max = *std::max_element(total.begin( ), total.end( )) * 1e-9;
+		stats.inputP99 = Percentile(input, 0.99);
+		stats.processP99 = Percentile(process, 0.99);
+		stats.outputP99 = Percentile(output, 0.99);
+		stats.minMargin = minMargin * 1e-9;
+		return stats;
+	}
 }
 
 namespace PAD {
@@ -179,6 +338,9 @@ namespace PAD {
 	IHostAPI* LinkASIO( );
 	IHostAPI* LinkWASAPI( );
 	IHostAPI* LinkJACK( );
+	IHostAPI* LinkNull( );
+	IHostAPI* LinkOffline( );
+	IHostAPI* LinkLoopback( );
 
 	std::vector<IHostAPI*> GetLinkedAPIs( ) {
 		std::vector<IHostAPI*> hosts;
@@ -194,6 +356,15 @@ namespace PAD {
 #ifdef PAD_LINK_JACK
 		hosts.push_back(LinkJACK());
 #endif
+#ifdef PAD_LINK_NULL
+		hosts.push_back(LinkNull( ));
+#endif
+#ifdef PAD_LINK_OFFLINE
+		hosts.push_back(LinkOffline( ));
+#endif
+#ifdef PAD_LINK_LOOPBACK
+		hosts.push_back(LinkLoopback( ));
+#endif
 
 		return hosts;
 	}
@@ -227,6 +398,14 @@ namespace PAD {
 			stream << "]";
 		} else stream << "[" << devIns << "x" << devOuts << "]";
 
+		if (cfg.GetCanonicalFormat( ) == CanonicalFormat::Float64) stream << " f64";
+		else if (cfg.GetCanonicalFormat( ) == CanonicalFormat::Int32) stream << " i32";
+		else if (cfg.GetCanonicalFormat( ) == CanonicalFormat::Int16) stream << " i16";
+		if (cfg.GetDither( ) == DitherMode::TPDF) stream << " tpdf";
+		else if (cfg.GetDither( ) == DitherMode::NoiseShapedTPDF) stream << " shaped tpdf";
+		if (cfg.GetInputRoutes( ).size( ) || cfg.GetOutputRoutes( ).size( )) stream << " routed";
+		if (cfg.IsPlanar( )) stream << " planar";
+
 		return stream;
 	}
 }
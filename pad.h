@@ -3,6 +3,10 @@
 #include <forward_list>
 #include <mutex>
 #include <memory>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <thread>
 #include <cstdint>
 #include <functional>
 #include <cassert>
@@ -13,6 +17,8 @@
 #define PAD_GUI_CONTROL_PANEL_SUPPORT 1
 
 namespace PAD {
+	/* 2.0.0 replaced the buffer switch mutex with BufferSwitchGate and made CPU_Load a
+	   non-virtual reading of the DSP load meter; see readme.txt */
 	const char* VersionString( );
 
 	class IHostAPI {
@@ -35,6 +41,29 @@ namespace PAD {
 		Channel(unsigned c) :ChannelRange(c, c + 1) { }
 	};
 
+	/* sample format of the interleaved buffers passed to BufferSwitch; integer samples are
+	   left justified to the full width of the type and passed through without gain, routing
+	   or dither, and integer streams are always interleaved */
+	enum class CanonicalFormat {
+		Float32,
+		Float64,
+		Int32,
+		Int16
+	};
+
+	/* dither added when canonical samples are quantized to integer device formats */
+	enum class DitherMode {
+		None,
+		TPDF,
+		NoiseShapedTPDF
+	};
+
+	/* adds gain times the source stream channel into the destination stream channel */
+	struct ChannelRoute {
+		unsigned destination, source;
+		float gain;
+	};
+
 	class AudioStreamConfiguration {
 		friend class AudioDevice;
 		double sampleRate;
@@ -43,6 +72,11 @@ namespace PAD {
 		unsigned numStreamIns;
 		unsigned numStreamOuts;
 		unsigned bufferSize;
+		CanonicalFormat canonicalFormat;
+		DitherMode dither;
+		std::vector<float> inputGains, outputGains;
+		std::vector<ChannelRoute> inputRoutes, outputRoutes;
+		bool planar;
 		bool startSuspended;
 		bool valid;
 		static void Normalize(std::vector<ChannelRange>&);
@@ -62,6 +96,24 @@ namespace PAD {
 
 		void SetSuspendOnStartup(bool suspend) { startSuspended = suspend; }
 
+		void SetCanonicalFormat(CanonicalFormat fmt) { canonicalFormat = fmt; }
+
+		void SetDither(DitherMode mode) { dither = mode; }
+
+		/* planar streams pass one buffer per stream channel in IO instead of interleaving them */
+		void SetPlanar(bool p) { planar = p; }
+
+		/* gains of stream channels, applied during sample format conversion */
+		void SetInputGain(unsigned streamChannel, float gain);
+		void SetOutputGain(unsigned streamChannel, float gain);
+
+		/* a routed stream channel is replaced by the sum of its routes before the gain;
+		   input routes are summed over stream inputs, output routes over stream outputs */
+		void AddInputRoute(ChannelRoute route) { inputRoutes.push_back(route); }
+		void AddOutputRoute(ChannelRoute route) { outputRoutes.push_back(route); }
+		void ClearRoutes( ) { inputRoutes.clear( ); outputRoutes.clear( ); }
+		void ClearGains( ) { inputGains.clear( ); outputGains.clear( ); }
+
 		bool IsInputEnabled(unsigned index) const;
 		bool IsOutputEnabled(unsigned index) const;
 
@@ -78,6 +130,20 @@ namespace PAD {
 
 		bool HasSuspendOnStartup( ) const { return startSuspended; }
 
+		CanonicalFormat GetCanonicalFormat( ) const { return canonicalFormat; }
+
+		DitherMode GetDither( ) const { return dither; }
+
+		bool IsPlanar( ) const { return planar; }
+
+		float GetInputGain(unsigned streamChannel) const { return streamChannel < inputGains.size( ) ? inputGains[streamChannel] : 1.f; }
+		float GetOutputGain(unsigned streamChannel) const { return streamChannel < outputGains.size( ) ? outputGains[streamChannel] : 1.f; }
+
+		const std::vector<float>& GetInputGains( ) const { return inputGains; }
+		const std::vector<float>& GetOutputGains( ) const { return outputGains; }
+		const std::vector<ChannelRoute>& GetInputRoutes( ) const { return inputRoutes; }
+		const std::vector<ChannelRoute>& GetOutputRoutes( ) const { return outputRoutes; }
+
 		void SetDeviceChannelLimits(unsigned maximumDeviceInputChannel, unsigned maximumDeviceOutputChannel);
 
 		/* Monad constructors for named parameter idion */
@@ -89,6 +155,13 @@ namespace PAD {
 		AudioStreamConfiguration StereoOutput(unsigned index) const;
 		AudioStreamConfiguration SampleRate(double rate) const;
 		AudioStreamConfiguration StartSuspended( ) const;
+		AudioStreamConfiguration Canonical(CanonicalFormat) const;
+		AudioStreamConfiguration Dither(DitherMode) const;
+		AudioStreamConfiguration Planar( ) const;
+		AudioStreamConfiguration InputGain(unsigned streamChannel, float gain) const;
+		AudioStreamConfiguration OutputGain(unsigned streamChannel, float gain) const;
+		AudioStreamConfiguration InputRoute(unsigned destination, unsigned source, float gain = 1.f) const;
+		AudioStreamConfiguration OutputRoute(unsigned destination, unsigned source, float gain = 1.f) const;
 
 		const std::vector<ChannelRange> GetInputRanges( ) const { return inputRanges; }
 		const std::vector<ChannelRange> GetOutputRanges( ) const { return outputRanges; }
@@ -148,6 +221,101 @@ namespace PAD {
 		}
 	};
 
+	/**
+	 * Event that may be modified while another thread is dispatching it. Dispatch reads an
+	 * immutable snapshot of the handlers through an atomic pointer and never allocates, locks
+	 * or frees. Modifications copy the snapshot under a mutex, publish the copy and retire the
+	 * old one; retired snapshots are deleted by the modifying thread once no dispatch is in
+	 * progress, at the latest by a later modification or the destructor.
+	 ***/
+	template <typename... ARGS> class RealtimeEvent : public IEvent {
+		friend class EventSubscriber;
+		using Handler = std::pair<IEventSubscriber*, std::function<void(ARGS...)>>;
+		using Snapshot = std::vector<Handler>;
+
+		std::atomic<const Snapshot*> current;
+		std::atomic<unsigned> dispatching;
+		std::vector<const Snapshot*> retired;
+		mutable std::mutex modify;
+
+		template <typename FN> void Modify(FN&& change) {
+			std::lock_guard<std::mutex> lock(modify);
+			auto old = current.load(std::memory_order_relaxed);
+			std::unique_ptr<Snapshot> next(old ? new Snapshot(*old) : new Snapshot);
+			change(*next);
+			/* an event without handlers publishes null, which dispatch skips without counting */
+			if (next->empty( )) next.reset( );
+			retired.push_back(current.exchange(next.release( ), std::memory_order_seq_cst));
+			Reclaim( );
+		}
+
+		/* once no dispatch is in progress after the exchange, none can see a retired snapshot */
+		void Reclaim( ) {
+			if (dispatching.load(std::memory_order_seq_cst)) return;
+			for (auto s : retired) delete s;
+			retired.clear( );
+		}
+
+		void AddSubscriber(IEventSubscriber* sub, const std::function<void(ARGS...)>& func) {
+			Modify([&](Snapshot& s) { s.emplace(s.begin( ), sub, func); });
+		}
+
+		void RemoveSubscriber(IEventSubscriber *sub) {
+			Modify([sub](Snapshot& s) {
+				s.erase(std::remove_if(s.begin( ), s.end( ), [sub](const Handler& h) { return h.first == sub; }), s.end( ));
+			});
+		}
+
+		void Clear( ) {
+			if (auto s = current.load( )) for (auto& h : *s) if (h.first) h.first->RemoveEvent(this);
+		}
+	public:
+		RealtimeEvent( ) :current(nullptr), dispatching(0) { }
+
+		/* copies carry the plain handlers; subscriptions stay with the original */
+		RealtimeEvent(const RealtimeEvent& from) :RealtimeEvent( ) { *this = from; }
+
+		RealtimeEvent& operator=(const RealtimeEvent& from) {
+			if (&from == this) return *this;
+			Snapshot plain;
+			{
+				std::lock_guard<std::mutex> lock(from.modify);
+				if (auto s = from.current.load( )) for (auto& h : *s) if (h.first == nullptr) plain.push_back(h);
+			}
+			Modify([&](Snapshot& s) { s.swap(plain); });
+			return *this;
+		}
+
+		~RealtimeEvent( ) {
+			Clear( );
+			delete current.load( );
+			for (auto s : retired) delete s;
+		}
+
+		void operator()(const ARGS&... args) {
+			if (current.load(std::memory_order_relaxed) == nullptr) return;
+			dispatching.fetch_add(1, std::memory_order_seq_cst);
+			if (auto s = current.load(std::memory_order_seq_cst)) for (auto& h : *s) h.second(args...);
+			dispatching.fetch_sub(1, std::memory_order_release);
+		}
+
+		RealtimeEvent& operator=(const std::function<void(ARGS...)>& handler) {
+			Modify([&](Snapshot& s) { s.assign(1, Handler(nullptr, handler)); });
+			return *this;
+		}
+
+		RealtimeEvent& operator+=(const std::function<void(ARGS...)>& handler) {
+			Modify([&](Snapshot& s) { s.emplace(s.begin( ), nullptr, handler); });
+			return *this;
+		}
+
+		/* deletes the retired snapshots if no dispatch is in progress; modifications call this */
+		void Collect( ) {
+			std::lock_guard<std::mutex> lock(modify);
+			Reclaim( );
+		}
+	};
+
 	class EventSubscriber : public IEventSubscriber {
 		std::forward_list<IEvent*> subscriptions;
 	public:
@@ -165,6 +333,11 @@ namespace PAD {
 			evt.AddSubscriber(this, f);
 			subscriptions.emplace_front(&evt);
 		}
+
+		template <typename FN, typename... ARGS> void When(RealtimeEvent<ARGS...>& evt, const FN& f) {
+			evt.AddSubscriber(this, f);
+			subscriptions.emplace_front(&evt);
+		}
 	};
 
 	struct IO {
@@ -173,12 +346,292 @@ namespace PAD {
 		float *output;
 		unsigned numFrames;
 		std::chrono::microseconds inputBufferTime, outputBufferTime;
+
+		/* CanonicalFormat::Float64 streams exchange samples here instead of input and output */
+		const double *input64 = nullptr;
+		double *output64 = nullptr;
+
+		/* planar streams exchange one buffer of numFrames samples per stream channel here;
+		   they may be the device buffers themselves when no conversion is needed */
+		const float* const* inputChannels = nullptr;
+		float* const* outputChannels = nullptr;
+		const double* const* inputChannels64 = nullptr;
+		double* const* outputChannels64 = nullptr;
+
+		/* CanonicalFormat::Int32 and Int16 streams exchange samples here */
+		const int32_t *input32 = nullptr;
+		int32_t *output32 = nullptr;
+		const int16_t *input16 = nullptr;
+		int16_t *output16 = nullptr;
 	};
  
+	/**
+	 * Keeps control threads and the buffer switch apart without blocking the audio thread.
+	 * Control threads lock the gate like a recursive mutex; locking closes it and waits for
+	 * the buffer switches in progress to leave. The audio thread only tries to enter, and a
+	 * buffer switch that finds the gate closed is skipped and counted instead of waiting.
+	 * A buffer switch may lock the gate it is inside of, as with Close from inside a callback;
+	 * it then takes the gate ahead of control threads still waiting for it and never waits
+	 * for itself or for other buffer switches to leave
+	 ***/
+	class BufferSwitchGate {
+		/* the state counts buffer switches inside in the low bits and lockers above them */
+		static const unsigned locker = 0x10000u;
+		std::atomic<unsigned> state;
+		std::atomic<std::thread::id> owner;
+		unsigned depth = 0;
+		std::atomic<uint64_t> missed;
+
+		bool TryEnter( ) {
+			if (state.fetch_add(1, std::memory_order_acquire) >= locker) {
+				state.fetch_sub(1, std::memory_order_release);
+				missed.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			return true;
+		}
+
+		void Leave( ) {
+			state.fetch_sub(1, std::memory_order_release);
+		}
+
+		/* buffer switches of the calling thread inside this gate */
+		unsigned EnteredByThisThread( ) const;
+	public:
+		BufferSwitchGate( ) :state(0), owner(std::thread::id( )), missed(0) { }
+
+		void lock( ) {
+			auto self = std::this_thread::get_id( );
+			if (owner.load(std::memory_order_relaxed) == self) {
+				++depth;
+				return;
+			}
+			state.fetch_add(locker, std::memory_order_seq_cst);
+			/* a thread inside the gate can only be waiting for another buffer switch that
+			   holds it from inside; control threads wait for every buffer switch to leave */
+			bool inside = EnteredByThisThread( ) > 0;
+			for (;;) {
+				auto none = std::thread::id( );
+				if ((inside || (state.load(std::memory_order_acquire) & (locker - 1)) == 0) &&
+					owner.compare_exchange_weak(none, self, std::memory_order_acquire)) break;
+				std::this_thread::yield( );
+			}
+			depth = 1;
+		}
+
+		void unlock( ) {
+			if (--depth) return;
+			owner.store(std::thread::id( ), std::memory_order_release);
+			state.fetch_sub(locker, std::memory_order_release);
+		}
+
+		/* buffer switches skipped because the gate was closed */
+		uint64_t GetMissedBufferSwitches( ) const { return missed.load(std::memory_order_relaxed); }
+
+		/* enters the gate for the lifetime of the object when it is open; the entries of a
+		   thread form a stack that lets lock tell buffer switches from control threads */
+		class Entry {
+			friend class BufferSwitchGate;
+			BufferSwitchGate *gate;
+			bool entered;
+			const Entry *outer;
+
+			static const Entry*& Innermost( ) {
+				static thread_local const Entry *innermost = nullptr;
+				return innermost;
+			}
+		public:
+			Entry(BufferSwitchGate *g) :gate(g), entered(g ? g->TryEnter( ) : true), outer(Innermost( )) { Innermost( ) = this; }
+			~Entry( ) {
+				Innermost( ) = outer;
+				if (gate && entered) gate->Leave( );
+			}
+			Entry(const Entry&) = delete;
+			Entry& operator=(const Entry&) = delete;
+			explicit operator bool( ) const { return entered; }
+		};
+	};
+
+	inline unsigned BufferSwitchGate::EnteredByThisThread( ) const {
+		unsigned count = 0;
+		for (auto e = Entry::Innermost( ); e; e = e->outer) if (e->gate == this && e->entered) ++count;
+		return count;
+	}
+
+	/**
+	 * Time spent in the buffer switch relative to the period of the buffer, measured with a
+	 * monotonic clock around every dispatch. The audio thread is the only writer; everything
+	 * can be read from any thread without locking
+	 ***/
+	class DSPLoadMeter {
+	public:
+		/* cycles below 100% load fall in bins of 5%, the last bin counts the overruns */
+		static const unsigned HistogramBins = 21;
+	private:
+		std::atomic<double> smoothed, peak;
+		std::atomic<uint64_t> histogram[HistogramBins];
+		void Reset( );
+	public:
+		/* time constant of the smoothed load */
+		static constexpr double SmoothingSeconds = 0.1;
+
+		DSPLoadMeter( ) { Reset( ); }
+		/* measurements belong to the stream of the original, so copies start empty */
+		DSPLoadMeter(const DSPLoadMeter&) { Reset( ); }
+		DSPLoadMeter& operator=(const DSPLoadMeter&) { Reset( ); return *this; }
+
+		void Record(double seconds, double period) {
+			if (period <= 0) return;
+			double load = seconds / period;
+			double s = smoothed.load(std::memory_order_relaxed);
+			smoothed.store(s + (load - s) * std::min(1.0, period / SmoothingSeconds), std::memory_order_relaxed);
+			/* a reader may reset the peak between the load and the store */
+			double worst = peak.load(std::memory_order_relaxed);
+			while (load > worst && !peak.compare_exchange_weak(worst, load, std::memory_order_relaxed)) { }
+			unsigned bin = load < 1.0 ? unsigned(load * (HistogramBins - 1)) : HistogramBins - 1;
+			histogram[bin].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/* load averaged over about SmoothingSeconds */
+		double GetLoad( ) const { return smoothed.load(std::memory_order_relaxed); }
+
+		/* worst cycle since the previous call */
+		double GetPeakLoad( ) { return peak.exchange(0, std::memory_order_relaxed); }
+
+		/* cycles counted in each bin since the device was created or the histogram cleared */
+		void GetHistogram(uint64_t (&counts)[HistogramBins]) const;
+		void ClearHistogram( );
+	};
+
+	/* one buffer switch, in nanoseconds: start on the steady clock, the buffer period and
+	   the time spent converting the inputs, in the client and converting the outputs */
+	struct CycleTiming {
+		int64_t start, period;
+		int64_t input, process, output;
+		int64_t Total( ) const { return input + process + output; }
+	};
+
+	/* summary of the cycles in a CycleTimingRing, in seconds */
+	struct CycleStatistics {
+		unsigned cycles;
+		/* deviation of the interval between cycle starts from the buffer period */
+		double intervalJitter, maxIntervalError;
+		/* percentiles of the whole cycle, and of each stage */
+		double p50, p99, max;
+		double inputP99, processP99, outputP99;
+		/* smallest period minus cycle time; negative after an overrun */
+		double minMargin;
+	};
+
+	/**
+	 * The most recent buffer switches, written by the audio thread into a fixed ring without
+	 * locking or allocating. Each slot carries a sequence number so that a monitoring thread
+	 * can copy the ring at any time and drop the slots that were overwritten as it read them
+	 ***/
+	class CycleTimingRing {
+	public:
+		static const unsigned Capacity = 1024;
+	private:
+		struct Slot {
+			std::atomic<uint64_t> sequence;
+			std::atomic<int64_t> start, period, input, process, output;
+		};
+		Slot slots[Capacity];
+		std::atomic<uint64_t> written;
+		void Reset( );
+	public:
+		CycleTimingRing( ) { Reset( ); }
+		/* timings belong to the stream of the original, so copies start empty */
+		CycleTimingRing(const CycleTimingRing&) { Reset( ); }
+		CycleTimingRing& operator=(const CycleTimingRing&) { Reset( ); return *this; }
+
+		/* audio thread only */
+		void Push(const CycleTiming& t) {
+			uint64_t n = written.load(std::memory_order_relaxed);
+			Slot& s(slots[n % Capacity]);
+			s.sequence.store(2 * n + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			s.start.store(t.start, std::memory_order_relaxed);
+			s.period.store(t.period, std::memory_order_relaxed);
+			s.input.store(t.input, std::memory_order_relaxed);
+			s.process.store(t.process, std::memory_order_relaxed);
+			s.output.store(t.output, std::memory_order_relaxed);
+			s.sequence.store(2 * n + 2, std::memory_order_release);
+			written.store(n + 1, std::memory_order_release);
+		}
+
+		/* buffer switches recorded so far */
+		uint64_t GetCount( ) const { return written.load(std::memory_order_acquire); }
+
+		/* copies up to Capacity of the latest consecutive cycles, oldest first; monitoring
+		   threads only, as it allocates */
+		std::vector<CycleTiming> Snapshot( ) const;
+
+		static CycleStatistics Analyze(const std::vector<CycleTiming>&);
+		CycleStatistics GetStatistics( ) const { return Analyze(Snapshot( )); }
+	};
+
+	/* where the time went in a dropout: one of the stages of the previous cycle ran past the
+	   period, the cycle started late, or the device or its driver reported the loss */
+	enum class XrunStage {
+		Unknown,
+		Input,
+		Process,
+		Output,
+		Scheduling,
+		Device
+	};
+
+	struct XrunInfo {
+		/* buffer switches dispatched before the one that noticed the xrun */
+		uint64_t cycle;
+		/* estimated; 0 when the backend can not tell */
+		uint64_t framesLost;
+		XrunStage stage;
+	};
+
+	/* totals of the xruns of a device, readable from any thread */
+	class XrunCounters {
+		std::atomic<uint64_t> count, framesLost;
+		std::atomic<bool> reported;
+		/* buffer switches dispatched; counted by the audio thread and read by reports from
+		   other threads */
+		std::atomic<uint64_t> dispatched;
+		friend class AudioDevice;
+	public:
+		XrunCounters( ) :count(0), framesLost(0), reported(false), dispatched(0) { }
+		/* counts belong to the stream of the original, so copies start from zero */
+		XrunCounters(const XrunCounters&) :XrunCounters( ) { }
+		XrunCounters& operator=(const XrunCounters&) { return *this; }
+
+		uint64_t GetCount( ) const { return count.load(std::memory_order_relaxed); }
+		uint64_t GetFramesLost( ) const { return framesLost.load(std::memory_order_relaxed); }
+	};
+
 	class AudioDevice {
-		std::shared_ptr<std::recursive_mutex> deviceMutex;
+		std::shared_ptr<BufferSwitchGate> gate;
+		DSPLoadMeter loadMeter;
+		CycleTimingRing cycleTimings;
+		XrunCounters xruns;
+		/* gap detector on the buffer timestamps, touched only by the audio thread */
+		std::chrono::microseconds lastBufferTime = std::chrono::microseconds(0);
+		double lastPeriod = 0;
+		void DetectTimestampGap(const IO&);
+		void RaiseXrun(XrunStage, uint64_t framesLost);
+		/* the cycle in progress, touched only by the audio thread */
+		CycleTiming cycle = { };
+		std::chrono::steady_clock::time_point cycleBegin, processEnd;
+		bool inCycle = false;
+
+		static int64_t Nanoseconds(std::chrono::steady_clock::duration d) {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count( );
+		}
+		void(*realtimeCallback)(void*, const IO&) = nullptr;
+		void *realtimeContext = nullptr;
+		std::shared_ptr<void> realtimeTarget;
 	public:
 		using BufferSwitchHandler = std::function<void( )>;
+		using RealtimeCallback = void(*)(void* context, const IO&);
 
 		virtual ~AudioDevice( ) { }
 		virtual unsigned GetNumInputs( ) const = 0;
@@ -203,7 +656,31 @@ namespace PAD {
 
 		virtual void Close( ) = 0;
 
-		virtual double CPU_Load( ) const = 0;
+		/* smoothed DSP load, from GetDSPLoadMeter */
+		double CPU_Load( ) const { return loadMeter.GetLoad( ); }
+		DSPLoadMeter& GetDSPLoadMeter( ) { return loadMeter; }
+
+		/* the latest buffer switches of this device */
+		const CycleTimingRing& GetCycleTimings( ) const { return cycleTimings; }
+
+		const XrunCounters& GetXruns( ) const { return xruns; }
+
+		/**
+		 * Called by the backends when the device or driver reports a dropout, from any
+		 * thread. Timestamp gaps between buffer switches are detected here unless a backend
+		 * has reported the same cycle already
+		 ***/
+		void ReportXrun(XrunStage stage, uint64_t framesLost) {
+			RaiseXrun(stage, framesLost);
+			xruns.reported.store(true, std::memory_order_relaxed);
+		}
+
+		/* audio thread only: the stage that ran the previous cycle past its period, or
+		   Scheduling if it finished in time */
+		XrunStage GetOverrunStage( ) const;
+
+		/* backends call this before starting a stream, so that the pause is not a gap */
+		void ResetXrunDetector( ) { lastBufferTime = std::chrono::microseconds(0); }
 #if PAD_GUI_CONTROL_PANEL_SUPPORT
 		void ShowControlPanel() 
 		{ 
@@ -213,14 +690,84 @@ namespace PAD {
 		std::function<void(void)> ShowControlPanelFunc;
 #endif
 
-		std::shared_ptr<std::recursive_mutex>& GetBufferSwitchLock( ) { return deviceMutex; }
-		void SetBufferSwitchLock(std::shared_ptr<std::recursive_mutex> lock) { deviceMutex = std::move(lock); }
+		/* lock with std::lock_guard to keep the buffer switch from running; null when the
+		   backend does not need one and none has been set */
+		std::shared_ptr<BufferSwitchGate>& GetBufferSwitchGate( ) { return gate; }
+		void SetBufferSwitchGate(std::shared_ptr<BufferSwitchGate> g) { gate = std::move(g); }
+
+		/* removed in 2.0.0; these only remain to fail with a message naming the replacement */
+		template <typename T = void> void GetBufferSwitchLock( ) {
+			static_assert(!std::is_void<T>::value, "GetBufferSwitchLock was removed in PAD 2.0.0: lock GetBufferSwitchGate( ) with std::lock_guard<BufferSwitchGate> instead");
+		}
+		template <typename T = void> void SetBufferSwitchLock(T&&) {
+			static_assert(std::is_void<T>::value, "SetBufferSwitchLock was removed in PAD 2.0.0: share a BufferSwitchGate with SetBufferSwitchGate instead");
+		}
 
+		/* the callback reads the device clock without a device; it is null for devices whose
+		   clock needs one, such as the offline and loopback devices, so prefer DeviceTimeNow */
 		using GetDeviceTime = std::chrono::microseconds(*)();
 		virtual GetDeviceTime GetDeviceTimeCallback() const = 0;
 		virtual std::chrono::microseconds DeviceTimeNow() const = 0;
 
-		Event<IO> BufferSwitch;
+		/**
+		 * A single callable the backends invoke directly before raising BufferSwitch, with no
+		 * type erasure beyond one function pointer and no copy of the IO. Unlike BufferSwitch
+		 * it must only be set while the stream is not running
+		 ***/
+		void SetRealtimeCallback(RealtimeCallback callback, void *context) {
+			realtimeTarget.reset( );
+			realtimeContext = context;
+			realtimeCallback = callback;
+		}
+
+		template <typename F> void SetRealtimeCallback(F&& callable) {
+			using Target = typename std::decay<F>::type;
+			auto target = std::make_shared<Target>(std::forward<F>(callable));
+			SetRealtimeCallback([](void *context, const IO& io) { (*(Target*)context)(io); }, target.get( ));
+			realtimeTarget = std::move(target);
+		}
+
+		void ClearRealtimeCallback( ) { SetRealtimeCallback(nullptr, nullptr); }
+
+		/* called by the backends once per buffer, optionally between BeginCycle before input
+		   conversion and EndCycle after output conversion */
+		void DispatchBufferSwitch(const IO& io) {
+			DetectTimestampGap(io);
+			auto begin = std::chrono::steady_clock::now( );
+			if (realtimeCallback) realtimeCallback(realtimeContext, io);
+			BufferSwitch(io);
+			processEnd = std::chrono::steady_clock::now( );
+			std::chrono::duration<double> elapsed = processEnd - begin;
+			double period = io.numFrames / io.config.GetSampleRate( );
+			loadMeter.Record(elapsed.count( ), period);
+
+			if (inCycle == false) cycleBegin = begin;
+			cycle.start = Nanoseconds(cycleBegin.time_since_epoch( ));
+			cycle.period = int64_t(period * 1e9);
+			cycle.input = Nanoseconds(begin - cycleBegin);
+			cycle.process = Nanoseconds(processEnd - begin);
+			cycle.output = 0;
+			if (inCycle == false) cycleTimings.Push(cycle);
+			xruns.dispatched.store(xruns.dispatched.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		void BeginCycle( ) {
+			cycleBegin = std::chrono::steady_clock::now( );
+			inCycle = true;
+		}
+
+		void EndCycle( ) {
+			if (inCycle == false) return;
+			inCycle = false;
+			cycle.output = Nanoseconds(std::chrono::steady_clock::now( ) - processEnd);
+			cycleTimings.Push(cycle);
+		}
+
+		/* may be reassigned while the stream is running */
+		RealtimeEvent<IO> BufferSwitch;
+
+		/* raised on the audio thread, or on the notification thread of the backend */
+		RealtimeEvent<XrunInfo> XrunOccurred;
 		Event<AudioStreamConfiguration> AboutToBeginStream;
 		Event<> StreamDidEnd;
 		Event<AudioStreamConfiguration::ConfigurationChangeFlags, AudioStreamConfiguration> StreamConfigurationDidChange;
@@ -256,6 +803,70 @@ namespace PAD {
 
 	std::vector<IHostAPI*> GetLinkedAPIs( );
 
+	/* what the inputs of a null device read */
+	enum class NullSignal {
+		Silence,
+		Sine
+	};
+
+	/**
+	 * Adds a virtual device to the "null" host API, published by sessions created afterwards.
+	 * Its stream is driven by a timer thread at the buffer size of the device and the sample
+	 * rate of the stream, with the same conversions and dispatch as a hardware backend, and
+	 * its output is discarded. A stereo device named "null" is always present
+	 ***/
+	void AddNullDevice(const char *name, unsigned numInputs, unsigned numOutputs, double sampleRate = 48000.0, unsigned bufferSize = 64, NullSignal input = NullSignal::Silence);
+
+	/**
+	 * Devices of the "offline" host API render as fast as the buffer switch returns, on a
+	 * thread of their own, with IO times from a sample clock that starts from zero with each
+	 * stream. A source fills up to frames samples of each input channel and returns how many
+	 * it filled; the buffer it does not fill is the last one. Sources and sinks with fewer
+	 * channels than the stream read silence for the others and drop them. A sink receives
+	 * every rendered buffer, and a call with no frames whenever the stream stops.
+	 * StreamDidEnd is raised from the render thread when the render runs out
+	 ***/
+	using OfflineSource = std::function<unsigned(float* const* channels, unsigned numChannels, unsigned frames)>;
+	using OfflineSink = std::function<void(const float* const* channels, unsigned numChannels, unsigned frames)>;
+
+	/* adds a device to the "offline" host API, published by sessions created afterwards; a
+	   stereo device named "offline" is always present */
+	void AddOfflineDevice(const char *name, unsigned numInputs, unsigned numOutputs, double sampleRate = 48000.0, unsigned bufferSize = 512);
+
+	/* what the next streams of an offline device read and write, and the number of frames
+	   they render, or zero to render until the source runs out or the stream is suspended;
+	   not while the device is streaming */
+	void SetOfflineRender(AudioDevice& offlineDevice, OfflineSource source, OfflineSink sink, uint64_t numFrames = 0);
+
+	/* interleaved samples in memory; the sink appends to a vector that must outlive it */
+	OfflineSource MemorySource(std::vector<float> interleaved, unsigned numChannels);
+	OfflineSink MemorySink(std::vector<float>& interleaved, unsigned numChannels);
+
+	/* reads 16, 24 and 32 bit integer or 32 and 64 bit float wave files, and writes 32 bit
+	   float wave files */
+	OfflineSource WaveFileSource(const char *path);
+	OfflineSink WaveFileSink(const char *path, unsigned numChannels, double sampleRate);
+
+	/* how the clock of a loopback pair advances */
+	enum class LoopbackClock {
+		/* one buffer per period of the sample rate, losing the buffers it falls behind on */
+		RealTime,
+		/* as soon as both devices have returned from their buffer switch, and only while
+		   both of them stream */
+		FreeRunning
+	};
+
+	/**
+	 * Adds a pair of devices to the "loopback" host API, published by sessions created
+	 * afterwards. The outputs of each device are the inputs of the other, latencyFrames later;
+	 * a latency shorter than the buffer size is one buffer. Both devices cycle in step on a
+	 * clock of the pair that starts from zero, with silent cables, when the first of them
+	 * starts streaming. The input time of a buffer is that of its first frame on the clock,
+	 * and the output time is when its first frame arrives at the other device. A stereo pair
+	 * named "loopback a" and "loopback b" with a latency of one buffer is always present
+	 ***/
+	void AddLoopbackPair(const char *first, const char *second, unsigned numChannels, unsigned latencyFrames, double sampleRate = 48000.0, unsigned bufferSize = 64, LoopbackClock clock = LoopbackClock::RealTime);
+
 	static inline void* LinkAPIs( ) {
         static std::vector<IHostAPI*> apis = GetLinkedAPIs();
         return apis.data( );
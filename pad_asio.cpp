@@ -8,12 +8,12 @@
 #include <mutex>
 #include <thread>
 #include <memory>
+#include <atomic>
+#include <cstring>
 
 #include "HostAPI.h"
 #include "PAD.h"
-#include "pad_samples.h"
-#include "pad_samples_sse2.h"
-#include "pad_channels.h"
+#include "pad_converters.h"
 
 #include "WinDebugStream.h"
 
@@ -57,7 +57,6 @@ namespace {
 			Running
 		} State = AsioState::Idle;
 
-		double CPU_Load( ) const { return current_cpu_load; }
 		
 		ASIO::DriverRecord driverInfo;
 		string deviceName;
@@ -69,7 +68,29 @@ namespace {
 		vector<ASIO::BufferInfo> bufferInfos;
 		vector<ASIO::ChannelInfo> channelInfos;
 		vector<float> delegateBufferInput, delegateBufferOutput;
+		vector<double> delegateBufferInput64, delegateBufferOutput64;
+		vector<int32_t> delegateBufferInput32, delegateBufferOutput32;
+		vector<int16_t> delegateBufferInput16, delegateBufferOutput16;
+		vector<const float*> delegateInputChannels;
+		vector<float*> delegateOutputChannels;
+		vector<const double*> delegateInputChannels64;
+		vector<double*> delegateOutputChannels64;
+		vector<uint32_t> ditherSeed;
+		vector<float> ditherError;
+		StreamMix inputMix, outputMix;
+
+		/* consecutive stream channels of one sample type, converted by a single kernel call */
+		struct ChannelGroup {
+			unsigned begin, end;
+			const Converter::ChannelKernels *kernels;
+		};
+		vector<ChannelGroup> inputGroups, outputGroups;
 		unsigned callbackBufferFrames, streamNumInputs, streamNumOutputs;
+
+		/* the driver buffers exist; cleared before they are disposed, which waits for the
+		   buffer switches that are silencing them to leave */
+		atomic<bool> buffersValid{ false };
+		atomic<unsigned> silencing{ 0 };
 		std::chrono::microseconds inputLatency, outputLatency;
 
 		AudioStreamConfiguration defaultMono, defaultStereo, defaultAll;
@@ -93,6 +114,8 @@ namespace {
 				State = Prepared;
 			case Prepared:
 				if (to >= Prepared) break;
+				buffersValid.store(false);
+				while (silencing.load( )) this_thread::yield( );
 				THROW_ERROR(DeviceCloseStreamFailure, ASIO().disposeBuffers());
 				State = Initialized;
 			case Initialized:
@@ -111,16 +134,16 @@ namespace {
 		}
 
 		void AsioUnwind(AsioState to) {
-			if (GetBufferSwitchLock( )) {
-				lock_guard<recursive_mutex> lock(*GetBufferSwitchLock( ));
+			if (GetBufferSwitchGate( )) {
+				lock_guard<BufferSwitchGate> lock(*GetBufferSwitchGate( ));
 				_AsioUnwind(to);
 			} else _AsioUnwind(to);
 		}
 
 	public:
-		AsioDevice(ASIO::DriverRecord comDriverInfo, shared_ptr<recursive_mutex> callbackMtx, double defaultRate, const string& name, unsigned inputs, unsigned outputs) :
+		AsioDevice(ASIO::DriverRecord comDriverInfo, shared_ptr<BufferSwitchGate> callbackGate, double defaultRate, const string& name, unsigned inputs, unsigned outputs) :
 			deviceName(name), numInputs(inputs), numOutputs(outputs), driverInfo(comDriverInfo) {
-			if (callbackMtx) SetBufferSwitchLock(std::move(callbackMtx));
+			if (callbackGate) SetBufferSwitchGate(std::move(callbackGate));
 
 			if (numOutputs >= 1) {
 				defaultMono = AudioStreamConfiguration(defaultRate, true);
@@ -155,8 +178,6 @@ namespace {
 			return false;
 		}
 
-		double current_cpu_load = 0.0;
-
 		void BufferSwitch(long doubleBufferIndex, ASIO::Bool directProcess) {
 			try {
 				ASIO::Time time;
@@ -220,6 +241,9 @@ namespace {
 				UpdateLatencies();
 				break;
 			case ASIO::ResyncRequest:
+				/* the driver lost samples, for example to an interrupt it could not service */
+				ReportXrun(XrunStage::Device, 0);
+				return 1L;
 			case ASIO::SupportsTimeInfo:
 			case ASIO::SupportsTimeCode:
 				return 1L;
@@ -254,8 +278,14 @@ namespace {
 					}
 				}
 
+				auto canon = currentConfiguration.GetCanonicalFormat( );
+				bool f64 = canon == CanonicalFormat::Float64;
+
 				streamNumInputs = (unsigned)bufferInfos.size( );
-				delegateBufferInput.resize(callbackBufferFrames * streamNumInputs);
+				delegateBufferInput.resize(canon == CanonicalFormat::Float32 ? callbackBufferFrames * streamNumInputs : 0);
+				delegateBufferInput64.resize(f64 ? callbackBufferFrames * streamNumInputs : 0);
+				delegateBufferInput32.resize(canon == CanonicalFormat::Int32 ? callbackBufferFrames * streamNumInputs : 0);
+				delegateBufferInput16.resize(canon == CanonicalFormat::Int16 ? callbackBufferFrames * streamNumInputs : 0);
 
 				for (unsigned i(0); i < GetNumOutputs( ); ++i) {
 					if (currentConfiguration.IsOutputEnabled(i)) {
@@ -265,7 +295,21 @@ namespace {
 				}
 
 				streamNumOutputs = (unsigned)bufferInfos.size( ) - streamNumInputs;
-				delegateBufferOutput.resize(callbackBufferFrames * streamNumOutputs);
+				delegateBufferOutput.resize(canon == CanonicalFormat::Float32 ? callbackBufferFrames * streamNumOutputs : 0);
+				delegateBufferOutput64.resize(f64 ? callbackBufferFrames * streamNumOutputs : 0);
+				delegateBufferOutput32.resize(canon == CanonicalFormat::Int32 ? callbackBufferFrames * streamNumOutputs : 0);
+				delegateBufferOutput16.resize(canon == CanonicalFormat::Int16 ? callbackBufferFrames * streamNumOutputs : 0);
+
+				/* planar streams see the delegate buffers one channel after another */
+				bool planar = currentConfiguration.IsPlanar( );
+				PlanarChannels(delegateInputChannels, delegateBufferInput.data( ), planar && !f64 ? streamNumInputs : 0, callbackBufferFrames);
+				PlanarChannels(delegateOutputChannels, delegateBufferOutput.data( ), planar && !f64 ? streamNumOutputs : 0, callbackBufferFrames);
+				PlanarChannels(delegateInputChannels64, delegateBufferInput64.data( ), planar && f64 ? streamNumInputs : 0, callbackBufferFrames);
+				PlanarChannels(delegateOutputChannels64, delegateBufferOutput64.data( ), planar && f64 ? streamNumOutputs : 0, callbackBufferFrames);
+
+				ditherSeed.resize(streamNumOutputs);
+				ditherError.resize(streamNumOutputs);
+				Converter::ResetDither(ditherSeed.data( ), ditherError.data( ), streamNumOutputs);
 
 				channelInfos.clear();
 				channelInfos.resize(bufferInfos.size());
@@ -275,13 +319,26 @@ namespace {
 					THROW_ERROR(DeviceOpenStreamFailure, ASIO().getChannelInfo(&channelInfos[i]));
 				}
 
+				GroupChannels(0, streamNumInputs, inputGroups);
+				GroupChannels(streamNumInputs, streamNumInputs + streamNumOutputs, outputGroups);
+
+				/* an input group converts without the blocks of the others, while an output group
+				   reads the whole delegate buffer */
+				vector<unsigned> groupBegins;
+				for (auto& g : inputGroups) groupBegins.push_back(g.begin);
+				inputMix.Compile(currentConfiguration.GetInputGains( ), currentConfiguration.GetInputRoutes( ), streamNumInputs, planar ? PlanarCalls(streamNumInputs) : groupBegins);
+				outputMix.Compile(currentConfiguration.GetOutputGains( ), currentConfiguration.GetOutputRoutes( ), streamNumOutputs, planar ? PlanarCalls(streamNumOutputs) : vector<unsigned>( ));
+
 				THROW_ERROR(DeviceOpenStreamFailure, ASIO( ).createBuffers(bufferInfos.data( ), (long)bufferInfos.size( ), callbackBufferFrames, callbacks));
+				buffersValid.store(true);
 				State = Prepared;
 			}
 		}
 
 		void Run( ) {
 			if (State < Running) {
+				ResetXrunDetector( );
+				samplePosition = -1;
 				THROW_ERROR(DeviceOpenStreamFailure, ASIO( ).start( ));
 				State = Running;
 			}
@@ -292,211 +349,226 @@ namespace {
 			Output
 		};
 
-		template <Direction MODE>
-		static void Format(ASIO::SampleType type, float* interleaved, void** blocks, unsigned frames, unsigned channels, unsigned stride) {
+		static bool GetHostFormat(ASIO::SampleType type, Converter::HostFormat& fmt) {
+			using Converter::HostFormat;
 			switch (type) {
-			case ASIO::Int16MSB:
-			{
-				typedef HostSample<int16_t, float, -(1 << 15), (1 << 15) - 1, 0, true> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-			case ASIO::Int32MSB:
-			{
-				typedef HostSample<int32_t, float, -(1 << 24), (1 << 23) - 1, 8, true> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-			case ASIO::Int32MSB16:
-			{
-				typedef HostSample<int32_t, float, -(1 << 15), (1 << 15) - 1, 0, true> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-			case ASIO::Int32MSB18:
-			{
-				typedef HostSample<int32_t, float, -(1 << 17), (1 << 17) - 1, 0, true> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-			case ASIO::Int32MSB20:
-			{
-				typedef HostSample<int32_t, float, -(1 << 19), (1 << 19) - 1, 0, true> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-			case ASIO::Int32MSB24:
-			{
-				typedef HostSample<int32_t, float, -(1 << 23), (1 << 23) - 1, 0, true> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-			case ASIO::Float32MSB:
-			{
-				typedef HostSample<float, float, -1, 1, 0, true> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-				//case ASIO::Float64MSB: 
-				//	{
-				//		typedef HostSample<double,float,-1,1,0,true> AsioSmp;
-				//		ChannelConverter<AsioSmp>::DeInterleave(interleaved,(AsioSmp**)blocks,frames,channels,stride);
-				//		break;
-				//	}
-			case ASIO::Int16LSB:
-			{
-				typedef HostSample<int16_t, float, -(1 << 15), (1 << 15) - 1, 0, false> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-			case ASIO::Int32LSB:
-			{
-				typedef HostSample<int32_t, float, -(1 << 23), (1 << 23) - 1, 8, false> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
+			case ASIO::Int16MSB: fmt = HostFormat::Int16MSB; return true;
+			case ASIO::Int24MSB: fmt = HostFormat::Int24MSB; return true;
+			case ASIO::Int32MSB: fmt = HostFormat::Int32MSB; return true;
+			case ASIO::Int32MSB16: fmt = HostFormat::Int32MSB16; return true;
+			case ASIO::Int32MSB18: fmt = HostFormat::Int32MSB18; return true;
+			case ASIO::Int32MSB20: fmt = HostFormat::Int32MSB20; return true;
+			case ASIO::Int32MSB24: fmt = HostFormat::Int32MSB24; return true;
+			case ASIO::Float32MSB: fmt = HostFormat::Float32MSB; return true;
+			case ASIO::Int16LSB: fmt = HostFormat::Int16LSB; return true;
+			case ASIO::Int24LSB: fmt = HostFormat::Int24LSB; return true;
+			case ASIO::Int32LSB: fmt = HostFormat::Int32LSB; return true;
+			case ASIO::Int32LSB16: fmt = HostFormat::Int32LSB16; return true;
+			case ASIO::Int32LSB18: fmt = HostFormat::Int32LSB18; return true;
+			case ASIO::Int32LSB20: fmt = HostFormat::Int32LSB20; return true;
+			case ASIO::Int32LSB24: fmt = HostFormat::Int32LSB24; return true;
+			case ASIO::Float32LSB: fmt = HostFormat::Float32LSB; return true;
+			case ASIO::Float64MSB: fmt = HostFormat::Float64MSB; return true;
+			case ASIO::Float64LSB: fmt = HostFormat::Float64LSB; return true;
+			default: return false;
 			}
-			case ASIO::Int32LSB16:
-			{
-				typedef HostSample<int32_t, float, -(1 << 15), (1 << 15) - 1, 0, false> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
-			}
-			case ASIO::Int32LSB18:
-			{
-				typedef HostSample<int32_t, float, -(1 << 17), (1 << 17) - 1, 0, false> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
+		}
+
+		static void Convert(const Converter::ChannelKernels& kernels, Direction mode, float* interleaved, void** blocks, unsigned frames, unsigned channels, unsigned stride, const Converter::FusedStages* stages) {
+			if (mode == Output) {
+				if (stages) kernels.DeInterleaveFused(interleaved, blocks, frames, channels, stride, *stages);
+				else kernels.DeInterleave(interleaved, blocks, frames, channels, stride);
+			} else {
+				if (stages) kernels.InterleaveFused(interleaved, (const void**)blocks, frames, channels, stride, *stages);
+				else kernels.Interleave(interleaved, (const void**)blocks, frames, channels, stride);
 			}
-			case ASIO::Int32LSB20:
-			{
-				typedef HostSample<int32_t, float, -(1 << 19), (1 << 19) - 1, 0, false> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
+		}
+
+		static void Convert(const Converter::ChannelKernels& kernels, Direction mode, double* interleaved, void** blocks, unsigned frames, unsigned channels, unsigned stride, const Converter::FusedStages* stages) {
+			if (mode == Output) {
+				if (stages) kernels.DeInterleaveFused64(interleaved, blocks, frames, channels, stride, *stages);
+				else kernels.DeInterleave64(interleaved, blocks, frames, channels, stride);
+			} else {
+				if (stages) kernels.InterleaveFused64(interleaved, (const void**)blocks, frames, channels, stride, *stages);
+				else kernels.Interleave64(interleaved, (const void**)blocks, frames, channels, stride);
 			}
-			case ASIO::Int32LSB24:
-			{
-				typedef HostSample<int32_t, float, -(1 << 23), (1 << 23) - 1, 0, false> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
+		}
+
+		/* integer streams carry no fused stages */
+		static void Convert(const Converter::ChannelKernels& kernels, Direction mode, int32_t* interleaved, void** blocks, unsigned frames, unsigned channels, unsigned stride, const Converter::FusedStages*) {
+			if (mode == Output) kernels.DeInterleaveInt32(interleaved, blocks, frames, channels, stride);
+			else kernels.InterleaveInt32(interleaved, (const void**)blocks, frames, channels, stride);
+		}
+
+		static void Convert(const Converter::ChannelKernels& kernels, Direction mode, int16_t* interleaved, void** blocks, unsigned frames, unsigned channels, unsigned stride, const Converter::FusedStages*) {
+			if (mode == Output) kernels.DeInterleaveInt16(interleaved, blocks, frames, channels, stride);
+			else kernels.InterleaveInt16(interleaved, (const void**)blocks, frames, channels, stride);
+		}
+
+		/* split buffers beg..end into groups of one sample type and select their kernels for
+		   the group size, with the widest instruction set the cpu supports; planar streams
+		   convert the channels of a group one at a time */
+		void GroupChannels(unsigned beg, unsigned end, vector<ChannelGroup>& groups) {
+			groups.clear( );
+			for (unsigned idx(beg); idx < end; ++idx) {
+				if (idx == end - 1 || channelInfos[idx + 1].type != channelInfos[beg].type || (idx + 1 - beg) >= 64) {
+					Converter::HostFormat fmt;
+					const Converter::ChannelKernels *kernels = nullptr;
+					unsigned layout = currentConfiguration.IsPlanar( ) ? 1 : idx + 1 - beg;
+					if (GetHostFormat(channelInfos[beg].type, fmt)) kernels = &Converter::GetChannelKernels(fmt, layout);
+					groups.push_back(ChannelGroup{ beg, idx + 1, kernels });
+					beg = idx + 1;
+				}
 			}
-			case ASIO::Float32LSB:
-			{
-				typedef HostSample<float, float, -1, 1, 0, false> AsioSmp;
-				if (MODE == Output) ChannelConverter<AsioSmp>::DeInterleave(interleaved, (AsioSmp**)blocks, frames, channels, stride);
-				else ChannelConverter<AsioSmp>::Interleave(interleaved, (const AsioSmp**)blocks, frames, channels, stride);
-				break;
+		}
+
+		/* gain and routing of the stream inputs from index first on, or null when there are none */
+		const Converter::FusedStages* InputStages(unsigned first, Converter::FusedStages& stages) {
+			if (inputMix.Empty( )) return nullptr;
+			stages = inputMix.Stages(first);
+			return &stages;
+		}
+
+		/* gain, routing and dither of the stream outputs from index first on, or null when there are none */
+		const Converter::FusedStages* OutputStages(unsigned first, Converter::DitherState& dither, Converter::FusedStages& stages) {
+			bool dithered = currentConfiguration.GetDither( ) != DitherMode::None;
+			if (outputMix.Empty( ) && dithered == false) return nullptr;
+			dither.seed = ditherSeed.data( );
+			dither.error = ditherError.data( );
+			dither.shaped = currentConfiguration.GetDither( ) == DitherMode::NoiseShapedTPDF;
+			stages = outputMix.Stages(first, dithered ? &dither : nullptr);
+			return &stages;
+		}
+
+		/* buffers the driver skipped show as a jump in the sample position */
+		int64_t samplePosition = -1;
+
+		void DetectPositionGap(const ASIO::Time* params) {
+			if ((params->timeInfo.flags & ASIO::SamplePositionValid) == 0) return;
+			int64_t position = (int64_t)(uint64_t)params->timeInfo.samplePosition;
+			if (samplePosition >= 0 && position > samplePosition + callbackBufferFrames)
+				ReportXrun(GetOverrunStage( ), uint64_t(position - samplePosition - callbackBufferFrames));
+			samplePosition = position;
+		}
+
+		static unsigned SampleBytes(ASIO::SampleType type) {
+			switch (type) {
+			case ASIO::Int16MSB: case ASIO::Int16LSB: return 2;
+			case ASIO::Int24MSB: case ASIO::Int24LSB: return 3;
+			case ASIO::Float64MSB: case ASIO::Float64LSB: return 8;
+			case ASIO::Int32MSB: case ASIO::Int32MSB16: case ASIO::Int32MSB18: case ASIO::Int32MSB20: case ASIO::Int32MSB24:
+			case ASIO::Int32LSB: case ASIO::Int32LSB16: case ASIO::Int32LSB18: case ASIO::Int32LSB20: case ASIO::Int32LSB24:
+			case ASIO::Float32MSB: case ASIO::Float32LSB: return 4;
+			default: return 0;
 			}
-				//case ASIO::Float64LSB: 
-				//	{
-				//		typedef HostSample<double,float,-1,1,0,false> AsioSmp;
-				//		ChannelConverter<AsioSmp>::DeInterleave(interleaved,(AsioSmp**)blocks,frames,channels,stride);
-				//		break;
-				//	}
-			default:break;
+		}
+
+		/* a cycle missed while a control thread holds the gate plays silence instead of the
+		   half of the driver buffers written two periods ago, unless they are being disposed */
+		void SilenceOutputs(long doubleBufferIndex) {
+			silencing++;
+			if (buffersValid.load( ) && streamNumOutputs) {
+				for (unsigned j(streamNumInputs); j < bufferInfos.size( ); ++j)
+					memset(bufferInfos[j].buffers[doubleBufferIndex], 0, callbackBufferFrames * SampleBytes(channelInfos[j].type));
+				ASIO( ).outputReady( );
 			}
+			silencing--;
 		}
 
 		ASIO::Time* BufferSwitchTimeInfo(ASIO::Time* params, long doubleBufferIndex, ASIO::Bool directProcess) {
-			LARGE_INTEGER perf_freq, perf_t0, perf_t1;
-			QueryPerformanceFrequency(&perf_freq);
-			QueryPerformanceCounter(&perf_t0);
-			ASIO::Time* result_ = nullptr;
-			if (GetBufferSwitchLock( )) {
-				lock_guard<recursive_mutex> lock(*GetBufferSwitchLock( ));
-				result_ = _BufferSwitchTimeInfo(params, doubleBufferIndex, directProcess);
-			} else result_ = _BufferSwitchTimeInfo(params, doubleBufferIndex, directProcess);
-			QueryPerformanceCounter(&perf_t1);
-			double elapsed_ms = double(perf_t1.QuadPart - perf_t0.QuadPart) / perf_freq.QuadPart * 1000.0;
-			double callback_max_len = 1000.0 / this->currentConfiguration.GetSampleRate( )*callbackBufferFrames;
-			current_cpu_load = 1.0 / callback_max_len*elapsed_ms;
-			return result_;
+			BufferSwitchGate::Entry entry(GetBufferSwitchGate( ).get( ));
+			if (entry) return _BufferSwitchTimeInfo(params, doubleBufferIndex, directProcess);
+			SilenceOutputs(doubleBufferIndex);
+			return params;
 		}
 
-		ASIO::Time* _BufferSwitchTimeInfo(ASIO::Time* params, long doubleBufferIndex, ASIO::Bool directProcess) {
-			/* convert ASIO format to canonical format */
+		/* convert ASIO format to canonical format */
+		template <typename CANON> void FormatInputs(CANON *canonical, long doubleBufferIndex) {
 			void *bufferPtr[64];
-			unsigned block(0);
-			ASIO::SampleType blockType(-1);
-			unsigned strideInCanonicalBuffer = streamNumInputs;
-
+			Converter::FusedStages stages;
+
+			for (auto& g : inputGroups) {
+				assert(bufferInfos[g.begin].isInput && channelInfos[g.begin].isInput);
+				if (g.kernels == nullptr) continue;
+				for (unsigned j(g.begin); j != g.end; ++j) bufferPtr[j - g.begin] = bufferInfos[j].buffers[doubleBufferIndex];
+				if (currentConfiguration.IsPlanar( )) {
+					for (unsigned j(g.begin); j != g.end; ++j)
+						Convert(*g.kernels, Input, canonical + j * callbackBufferFrames, bufferPtr + j - g.begin, callbackBufferFrames, 1, 1, InputStages(j, stages));
+				} else Convert(*g.kernels, Input, canonical + g.begin, bufferPtr, callbackBufferFrames, g.end - g.begin, streamNumInputs, InputStages(g.begin, stages));
+			}
 
-			/* convert ASIO format to canonical format */
-			if (streamNumInputs) {
-				unsigned beg(0);
-				blockType = channelInfos[beg].type;
+			if (currentConfiguration.IsPlanar( )) inputMix.MixAcrossCalls(canonical, callbackBufferFrames, 1, callbackBufferFrames);
+			else inputMix.MixAcrossCalls(canonical, callbackBufferFrames, streamNumInputs, 1);
+		}
 
-				unsigned idx(1);
-				while (idx < streamNumInputs) {
-					assert(bufferInfos[idx].isInput && channelInfos[idx].isInput);
-					if (channelInfos[idx].type != blockType || (idx - beg) >= 64) {
-						for (unsigned j(beg); j != idx; ++j) bufferPtr[j - beg] = bufferInfos[j].buffers[doubleBufferIndex];
-						Format<Input>(blockType, delegateBufferInput.data( ) + beg, (void**)bufferPtr, callbackBufferFrames, idx - beg, streamNumInputs);
+		/* convert canonical format to ASIO format */
+		template <typename CANON> void FormatOutputs(CANON *canonical, long doubleBufferIndex) {
+			void *bufferPtr[64];
+			Converter::DitherState dither;
+			Converter::FusedStages stages;
 
-						beg = idx;
-						blockType = channelInfos[beg].type;
-					}
-					idx++;
+			if (streamNumOutputs) {
+				if (currentConfiguration.IsPlanar( )) outputMix.MixAcrossCalls(canonical, callbackBufferFrames, 1, callbackBufferFrames);
+				for (auto& g : outputGroups) {
+					assert(bufferInfos[g.begin].isInput == false);
+					if (g.kernels == nullptr) continue;
+					unsigned first = g.begin - streamNumInputs;
+					for (unsigned j(g.begin); j != g.end; ++j) bufferPtr[j - g.begin] = bufferInfos[j].buffers[doubleBufferIndex];
+					if (currentConfiguration.IsPlanar( )) {
+						for (unsigned j(first); j != first + g.end - g.begin; ++j)
+							Convert(*g.kernels, Output, canonical + j * callbackBufferFrames, bufferPtr + j - first, callbackBufferFrames, 1, 1, OutputStages(j, dither, stages));
+					} else Convert(*g.kernels, Output, canonical + first, bufferPtr, callbackBufferFrames, g.end - g.begin, streamNumOutputs, OutputStages(first, dither, stages));
 				}
 
-				if (beg < streamNumInputs) {
-					for (unsigned j(beg); j != streamNumInputs; ++j) bufferPtr[j - beg] = bufferInfos[j].buffers[doubleBufferIndex];
-					Format<Input>(blockType, delegateBufferInput.data( ) + beg, (void**)bufferPtr, callbackBufferFrames, streamNumInputs - beg, streamNumInputs);
-				}
+				ASIO( ).outputReady( );
 			}
-			
+		}
+
+		ASIO::Time* _BufferSwitchTimeInfo(ASIO::Time* params, long doubleBufferIndex, ASIO::Bool directProcess) {
+			BeginCycle( );
+			DetectPositionGap(params);
+			auto canon = currentConfiguration.GetCanonicalFormat( );
+			bool f32 = canon == CanonicalFormat::Float32;
+			bool f64 = canon == CanonicalFormat::Float64;
+			bool planar = currentConfiguration.IsPlanar( );
+			switch (canon) {
+			case CanonicalFormat::Float64: FormatInputs(delegateBufferInput64.data( ), doubleBufferIndex); break;
+			case CanonicalFormat::Int32: FormatInputs(delegateBufferInput32.data( ), doubleBufferIndex); break;
+			case CanonicalFormat::Int16: FormatInputs(delegateBufferInput16.data( ), doubleBufferIndex); break;
+			default: FormatInputs(delegateBufferInput.data( ), doubleBufferIndex); break;
+			}
+
 			// system time is in nanosecs
 			std::chrono::microseconds sysTime(params->timeInfo.systemTime / 1000);
 
 			IO io{
 				currentConfiguration,
-				delegateBufferInput.data( ),
-				delegateBufferOutput.data( ),
+				f32 && !planar ? delegateBufferInput.data( ) : nullptr,
+				f32 && !planar ? delegateBufferOutput.data( ) : nullptr,
 				callbackBufferFrames,
 				sysTime - inputLatency,
-				sysTime + outputLatency
+				sysTime + outputLatency,
+				f64 && !planar ? delegateBufferInput64.data( ) : nullptr,
+				f64 && !planar ? delegateBufferOutput64.data( ) : nullptr,
+				planar && f32 ? delegateInputChannels.data( ) : nullptr,
+				planar && f32 ? delegateOutputChannels.data( ) : nullptr,
+				planar && f64 ? delegateInputChannels64.data( ) : nullptr,
+				planar && f64 ? delegateOutputChannels64.data( ) : nullptr,
+				delegateBufferInput32.empty( ) ? nullptr : delegateBufferInput32.data( ),
+				delegateBufferOutput32.empty( ) ? nullptr : delegateBufferOutput32.data( ),
+				delegateBufferInput16.empty( ) ? nullptr : delegateBufferInput16.data( ),
+				delegateBufferOutput16.empty( ) ? nullptr : delegateBufferOutput16.data( )
 			};
 
-			AudioDevice::BufferSwitch(io);
+			DispatchBufferSwitch(io);
 
-			/* convert canonical format to ASIO format */
-			if (streamNumOutputs) {
-				unsigned streamNumChannels = streamNumInputs + streamNumOutputs;
-				unsigned beg(streamNumInputs);
-				blockType = channelInfos[beg].type;
-
-				unsigned idx(beg + 1);
-				while (idx < streamNumChannels) {
-					assert(bufferInfos[idx].isInput == false);
-					if (channelInfos[idx].type != blockType || (idx - beg) >= 64) {
-						for (unsigned j(beg); j != idx; ++j) bufferPtr[j - beg] = bufferInfos[j].buffers[doubleBufferIndex];
-						Format<Output>(blockType, delegateBufferOutput.data( ) + beg - streamNumInputs, bufferPtr, callbackBufferFrames, idx - beg, streamNumOutputs);
-
-						beg = idx;
-						blockType = channelInfos[beg].type;
-					}
-					idx++;
-				}
-
-				if (beg < streamNumChannels) {
-					for (unsigned j(beg); j != streamNumChannels; ++j) bufferPtr[j - beg] = bufferInfos[j].buffers[doubleBufferIndex];
-					Format<Output>(blockType, delegateBufferOutput.data( ) + beg - streamNumInputs, bufferPtr, callbackBufferFrames, streamNumChannels - beg, streamNumOutputs);
-				}
-
-				ASIO( ).outputReady( );
+			switch (canon) {
+			case CanonicalFormat::Float64: FormatOutputs(delegateBufferOutput64.data( ), doubleBufferIndex); break;
+			case CanonicalFormat::Int32: FormatOutputs(delegateBufferOutput32.data( ), doubleBufferIndex); break;
+			case CanonicalFormat::Int16: FormatOutputs(delegateBufferOutput16.data( ), doubleBufferIndex); break;
+			default: FormatOutputs(delegateBufferOutput.data( ), doubleBufferIndex); break;
 			}
+			EndCycle( );
 
 			return params;
 		}
@@ -516,6 +588,7 @@ namespace {
 			err = ASIO( ).getSampleRate(&sr);
 			currentConfiguration.SetSampleRate(sr);
 			currentConfiguration.SetDeviceChannelLimits(GetNumInputs( ), GetNumOutputs( ));
+			LimitToConverters(currentConfiguration);
 
 			Prepare( );
 
@@ -546,7 +619,6 @@ namespace {
 	};
 
 	struct AsioPublisher : public HostAPIPublisher {
-		vector<unique_ptr<recursive_mutex>> deviceMutex;
 		list<AsioDevice> devices;
 
 		std::vector<ASIO::DriverRecord> AsioRecords;
@@ -596,7 +668,7 @@ namespace {
 									THROW_ERROR(DeviceInitializationFailure, driver->getChannels(&numInputs, &numOutputs));
 									THROW_ERROR(DeviceInitializationFailure, driver->getSampleRate(&currentSampleRate));
 
-									RegisterDevice(PADInstance, drv, make_shared<recursive_mutex>( ), currentSampleRate, drv.driverName, numInputs, numOutputs);					
+									RegisterDevice(PADInstance, drv, make_shared<BufferSwitchGate>( ), currentSampleRate, drv.driverName, numInputs, numOutputs);					
 							}
 						} catch (std::exception& e) {
 							// device failed to open
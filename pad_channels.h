@@ -1,14 +1,290 @@
-namespace PAD {
+#pragma once
+
+#include <type_traits>
+#include <cassert>
+#include "pad_converters.h"
 
+namespace PAD {
+inline namespace PAD_CONVERTER_ISA {
 	using namespace Converter;
+
+	/* widest channel bundle transposed in registers by this instruction set */
+#if defined(PAD_SAMPLES_AVX512)
+	static const int ConverterBundleWidth = 16;
+	static const ConverterISA ConverterKernelISA = ConverterISA::AVX512;
+#elif defined(PAD_SAMPLES_AVX)
+	static const int ConverterBundleWidth = 8;
+	static const ConverterISA ConverterKernelISA = ConverterISA::AVX2;
+#else
+	static const int ConverterBundleWidth = 4;
+	static const ConverterISA ConverterKernelISA = ConverterISA::Baseline;
+#endif
+
+	/* cache footprint of one frame tile of interleaved rows and block buffers */
+	static const unsigned ConverterTileBytes = 32768;
+
+	/* frames per tile: every bundle converts one tile before the next tile is started, so
+	   that the interleaved rows and block buffers of a tile stay in cache. Tiles are whole
+	   multiples of 16 frames, which keeps aligned buffers aligned at every tile. Working
+	   sets below the tiling threshold of the ISA and direction are converted in one tile */
+	static const unsigned MinimumTile = ConverterBundleWidth < 8 ? 16 : 2 * ConverterBundleWidth;
+
+	static inline unsigned FramesPerTile(unsigned frames, unsigned bytesPerFrame, bool interleave)
+	{
+		if (size_t(frames) * bytesPerFrame < GetTilingThreshold(ConverterKernelISA,interleave)) return frames;
+		unsigned tile = unsigned(ConverterTileBytes / bytesPerFrame) & ~15u;
+		return tile < MinimumTile ? MinimumTile : tile;
+	}
+
+	/* recursion step of a fixed channel layout: done, one full bundle, or narrower bundles */
+	template <unsigned CHANNELS, int VEC> using LayoutStep = std::integral_constant<int, CHANNELS == 0 ? 0 : CHANNELS >= (unsigned)VEC ? 1 : 2>;
+
+	/* quantization policies of the deinterleaving converters; Lanes<VEC> is applied to
+	   each loaded frame before the transpose, while the vector lanes are still channels */
+	struct NoDither {
+		template <int VEC> struct Lanes {
+			Lanes(const NoDither&) {}
+			void Apply(SampleVector<float,VEC>&) {}
+			void Store(const NoDither&) {}
+		};
+
+		NoDither Skip(unsigned) const { return *this; }
+	};
+
+	struct TPDFDither {
+		DitherState state;
+		float resolution;
+
+		template <int VEC> struct Lanes : public DitherVector<VEC> {
+			Lanes(const TPDFDither& d):DitherVector<VEC>(d.state.seed,d.state.error,d.state.shaped,d.resolution) {}
+			void Store(const TPDFDither& d) { DitherVector<VEC>::Store(d.state.seed,d.state.error); }
+		};
+
+		TPDFDither Skip(unsigned channels) const
+		{
+			TPDFDither tmp(*this);
+			tmp.state.seed += channels;
+			tmp.state.error += channels;
+			return tmp;
+		}
+	};
+
+	/* gain and routing policies; Bundle<VEC> serves the VEC channels of one bundle */
+	struct NoMix {
+		template <int VEC> struct Bundle {
+			Bundle(const NoMix&) {}
+			bool Routed(unsigned) const { return false; }
+			template <typename CANON> void Row(SampleVector<float,VEC>&, const CANON*) const {}
+			template <typename SAMPLE, int N, bool ALIGNED> SampleVector<float,N> Column(unsigned, unsigned) const { return SampleVector<float,N>(0.f); }
+			void Gain(SampleVector<float,VEC>&) const {}
+		};
+
+		NoMix Skip(unsigned, unsigned) const { return *this; }
+	};
+
+	struct ChannelMix {
+		FusedStages stages;
+		/* block buffers and channel count of the call, the sources of interleave routing */
+		const void * const *sources;
+		unsigned channels;
+		/* stream channel and frame offset of the current bundle */
+		unsigned channel, frame;
+
+		bool Routed(unsigned c) const { return stages.routeBegin && stages.routeBegin[c] != stages.routeBegin[c+1]; }
+
+		template <int VEC> struct Bundle {
+			const ChannelMix& mix;
+			SampleVector<float,VEC> gain;
+			bool routed;
+
+			Bundle(const ChannelMix& m):mix(m),routed(false)
+			{
+				float g[VEC];
+				for(unsigned k(0);k<VEC;++k)
+				{
+					g[k] = m.stages.gain ? m.stages.gain[m.channel + k] : 1.f;
+					routed = routed || m.Routed(m.channel + k);
+				}
+				gain.template Load<false>(g);
+			}
+
+			bool Routed(unsigned k) const { return routed && mix.Routed(mix.channel + k); }
+
+			/* one frame of the bundle, lanes are channels; inlined into the transpose loop,
+			   while routed rows take the out of line summation */
+			template <typename CANON> PAD_FORCEINLINE void Row(SampleVector<float,VEC>& x, const CANON *row) const
+			{
+				if (routed) Route(x,row);
+				x = x * gain;
+			}
+
+			/* routed lanes are summed from the columns of the interleaved row, which starts at
+			   the first bundle channel */
+			template <typename CANON> void Route(SampleVector<float,VEC>& x, const CANON *row) const
+			{
+				const unsigned *begin = mix.stages.routeBegin + mix.channel;
+				float tmp[VEC];
+				x.template Write<false>(tmp);
+				for(unsigned k(0);k<VEC;++k)
+				{
+					if (begin[k] == begin[k+1]) continue;
+					float sum(0);
+					for(unsigned t(begin[k]);t<begin[k+1];++t)
+						sum += mix.stages.routes[t].gain * float(row[int(mix.stages.routes[t].source) - int(mix.channel)]);
+					tmp[k] = sum;
+				}
+				x.template Load<false>(tmp);
+			}
+
+			/* N frames from frame i of routed bundle channel k, lanes are frames */
+			template <typename SAMPLE, int N, bool ALIGNED> SampleVector<float,N> Column(unsigned k, unsigned i) const
+			{
+				const unsigned *begin = mix.stages.routeBegin + mix.channel + k;
+				SampleVector<float,N> sum(0.f);
+				for(unsigned t(begin[0]);t<begin[1];++t)
+				{
+					unsigned source = mix.stages.routes[t].source - mix.stages.first;
+					if (source >= mix.channels) continue;
+					SampleVector<float,N> v = SAMPLE::template LoadVector<N,ALIGNED>((const SAMPLE*)mix.sources[source] + mix.frame + i);
+					sum = sum + v * SampleVector<float,N>(mix.stages.routes[t].gain);
+				}
+				return sum;
+			}
+
+			void Gain(SampleVector<float,VEC>& x) const { x = x * gain; }
+		};
+
+		ChannelMix Skip(unsigned c, unsigned f) const
+		{
+			ChannelMix tmp(*this);
+			tmp.channel += c;
+			tmp.frame += f;
+			return tmp;
+		}
+	};
+
+	/* the stages of a conversion: mixing first, then dither on the way out, and streaming
+	   stores to the destination when it is not going to be read back; only NoStages is
+	   ever streamed */
+	template <typename MIX, typename DITHER, bool STREAM = false> struct Stages {
+		static const bool stream = STREAM;
+		MIX mix;
+		DITHER dither;
+
+		template <int VEC> struct Bundle {
+			static const bool stream = STREAM;
+			typename MIX::template Bundle<VEC> mix;
+			typename DITHER::template Lanes<VEC> dither;
+
+			Bundle(const Stages& s):mix(s.mix),dither(s.dither) {}
+
+			/* deinterleave: one frame before the transpose */
+			template <typename CANON> PAD_FORCEINLINE void Row(SampleVector<float,VEC>& x, const CANON *row)
+			{
+				mix.Row(x,row);
+				dither.Apply(x);
+			}
+
+			void Store(const Stages& s) { dither.Store(s.dither); }
+		};
+
+		Stages Skip(unsigned channels, unsigned frames) const { return Stages{mix.Skip(channels,frames),dither.Skip(channels)}; }
+		Stages<MIX,DITHER,true> Streaming( ) const { return Stages<MIX,DITHER,true>{mix,dither}; }
+	};
+
+	typedef Stages<NoMix,NoDither> NoStages;
+
 	template <typename SAMPLE> class ChannelConverter{
-		template <int VEC, bool ALIGN_I, bool ALIGN_B> static void DeInterleaveBundle(const float *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned stride)
+		template <int VEC> using Paired = std::integral_constant<bool,PairFrames<typename SAMPLE::smp_t,VEC>::value>;
+
+		/* hosts that only fill half a register per VEC lanes transpose two blocks of frames
+		   and convert them with one vector of 2*VEC lanes; returns the frames processed */
+		template <int VEC, bool ALIGN_I, bool ALIGN_B, typename CANON, typename BUNDLE> static unsigned DeInterleavePairs(const CANON*, SAMPLE**, unsigned, unsigned, BUNDLE&, std::false_type)
+		{
+			return 0;
+		}
+
+		template <int VEC, bool ALIGN_I, bool ALIGN_B, typename CANON, typename BUNDLE> static unsigned DeInterleavePairs(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned stride, BUNDLE& stage, std::true_type)
 		{
 			unsigned i(0);
+			for(;i+2*VEC<=frames;i+=2*VEC)
+			{
+				SampleVector<float,VEC> lo[VEC], hi[VEC];
+				for(unsigned j(0);j<VEC;++j)
+				{
+					lo[j].template Load<ALIGN_I>(interleavedBuffer + (i+j) * stride);
+					stage.Row(lo[j],interleavedBuffer + (i+j) * stride);
+				}
+				for(unsigned j(0);j<VEC;++j)
+				{
+					hi[j].template Load<ALIGN_I>(interleavedBuffer + (i+VEC+j) * stride);
+					stage.Row(hi[j],interleavedBuffer + (i+VEC+j) * stride);
+				}
+
+				Transpose(lo);
+				Transpose(hi);
+
+				for(unsigned j(0);j<VEC;++j)
+				{
+					auto tmp = SAMPLE::template ConstructVector<2*VEC>(blockBuffers[0]);
+					tmp = SampleVector<float,2*VEC>(lo[j],hi[j]);
+					tmp.template Store<ALIGN_B,BUNDLE::stream>((typename SAMPLE::smp_t*)blockBuffers[j]+i);
+				}
+			}
+			return i;
+		}
+
+		template <int VEC, bool ALIGN_I, bool ALIGN_B, typename CANON, typename BUNDLE> static unsigned InterleavePairs(CANON*, const SAMPLE**, unsigned, unsigned, const BUNDLE&, std::false_type)
+		{
+			return 0;
+		}
+
+		template <int VEC, bool ALIGN_I, bool ALIGN_B, typename CANON, typename BUNDLE> static unsigned InterleavePairs(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned stride, const BUNDLE& stage, std::true_type)
+		{
+			unsigned i(0);
+			for(;i+2*VEC<=frames;i+=2*VEC)
+			{
+				SampleVector<float,VEC> lo[VEC], hi[VEC];
+				for(unsigned j(0);j<VEC;++j)
+				{
+					if (stage.mix.Routed(j))
+					{
+						lo[j] = stage.mix.template Column<SAMPLE,VEC,ALIGN_B>(j,i);
+						/* the second half is not aligned for narrow samples */
+						hi[j] = stage.mix.template Column<SAMPLE,VEC,false>(j,i+VEC);
+						continue;
+					}
+					SampleVector<float,2*VEC> v = SAMPLE::template LoadVector<2*VEC,ALIGN_B>(blockBuffers[j] + i);
+					lo[j] = v.Low();
+					hi[j] = v.High();
+				}
+
+				Transpose(lo);
+				Transpose(hi);
+
+				for(unsigned j(0);j<VEC;++j)
+				{
+					stage.mix.Gain(lo[j]);
+					stage.mix.Gain(hi[j]);
+					lo[j].template Write<ALIGN_I>(interleavedBuffer + (i+j) * stride);
+					hi[j].template Write<ALIGN_I>(interleavedBuffer + (i+VEC+j) * stride);
+				}
+			}
+			return i;
+		}
+
+		template <int VEC, bool ALIGN_I, bool ALIGN_B, typename CANON, typename STAGES> static void DeInterleaveBundle(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned stride, const STAGES& stages)
+		{
+			typename STAGES::template Bundle<VEC> stage(stages);
+			unsigned i = DeInterleavePairs<VEC,ALIGN_I,ALIGN_B>(interleavedBuffer,blockBuffers,frames,stride,stage,Paired<VEC>());
 			for(;i+VEC<=frames;i+=VEC)
 			{
 				SampleVector<float,VEC> mtx[VEC];
-				for(unsigned j(0);j<VEC;++j) mtx[j].template Load<ALIGN_I>(interleavedBuffer + (i+j) * stride);
+				for(unsigned j(0);j<VEC;++j)
+				{
+					mtx[j].template Load<ALIGN_I>(interleavedBuffer + (i+j) * stride);
+					stage.Row(mtx[j],interleavedBuffer + (i+j) * stride);
+				}
 				
 				Transpose(mtx);
 
@@ -16,37 +292,46 @@ namespace PAD {
 				{
 					auto tmp = SAMPLE::template ConstructVector<VEC>(blockBuffers[0]);
 					tmp = mtx[j];
-					tmp.data.template Write<ALIGN_B>((typename SAMPLE::smp_t*)blockBuffers[j]+i);
+					tmp.template Store<ALIGN_B,STAGES::stream>((typename SAMPLE::smp_t*)blockBuffers[j]+i);
 				}
 			}
 
+			stage.Store(stages);
+
 			if (i < frames)
 			{
 				/* loop remainder */
 				SAMPLE *offset[VEC];
 				for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j]+i;
 				
-				DeInterleaveBundle<(VEC+1)/2,ALIGN_I,ALIGN_B>(interleavedBuffer + i * stride,offset,frames-i,stride);
-				DeInterleaveBundle<(VEC+1)/2,ALIGN_I,ALIGN_B>(interleavedBuffer + i * stride + VEC/2,offset+VEC/2,frames-i,stride);
+				DeInterleaveBundle<(VEC+1)/2,ALIGN_I,ALIGN_B>(interleavedBuffer + i * stride,offset,frames-i,stride,stages.Skip(0,i));
+				DeInterleaveBundle<(VEC+1)/2,ALIGN_I,ALIGN_B>(interleavedBuffer + i * stride + VEC/2,offset+VEC/2,frames-i,stride,stages.Skip(VEC/2,i));
 			}
 		}
 
-		template <int VEC, bool ALIGN_I, bool ALIGN_B> static void InterleaveBundle(float *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned stride)
+		template <int VEC, bool ALIGN_I, bool ALIGN_B, typename CANON, typename STAGES> static void InterleaveBundle(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned stride, const STAGES& stages)
 		{
+			typename STAGES::template Bundle<VEC> stage(stages);
 			unsigned i(0);
 			const SAMPLE* bb[VEC];//={blockBuffers[0],blockBuffers[1],blockBuffers[2],blockBuffers[3]};
 			for(i=0;i<VEC;++i) bb[i]=blockBuffers[i];
-			for(i=0;i+VEC<=frames;i+=VEC)
+			for(i=InterleavePairs<VEC,ALIGN_I,ALIGN_B>(interleavedBuffer,bb,frames,stride,stage,Paired<VEC>());i+VEC<=frames;i+=VEC)
 			{
 				SampleVector<float,VEC> mtx[VEC];
                 SAMPLE fmt;
 				for(unsigned j(0);j<VEC;++j) 
-					mtx[j] = SAMPLE::template LoadVector<VEC,ALIGN_B>(bb[j] + i);
+				{
+					if (stage.mix.Routed(j)) mtx[j] = stage.mix.template Column<SAMPLE,VEC,ALIGN_B>(j,i);
+					else mtx[j] = SAMPLE::template LoadVector<VEC,ALIGN_B>(bb[j] + i);
+				}
 
 				Transpose(mtx);
 
 				for(unsigned j(0);j<VEC;++j) 
+				{
+					stage.mix.Gain(mtx[j]);
 					mtx[j].template Write<ALIGN_I>(interleavedBuffer + (i+j) * stride);
+				}
 			}
 
 			if (i < frames)
@@ -55,127 +340,616 @@ namespace PAD {
 				unsigned rem = frames - i;
 				const SAMPLE *offset[VEC];
 				for(unsigned j(0);j<VEC;++j) offset[j] = bb[j] + i;				
-				InterleaveBundle<(VEC+1)/2,ALIGN_I,ALIGN_B>(interleavedBuffer + i * stride,offset,rem,stride);
-				InterleaveBundle<(VEC+1)/2,ALIGN_I,ALIGN_B>(interleavedBuffer + i * stride + VEC/2,offset+VEC/2,rem,stride);
+				InterleaveBundle<(VEC+1)/2,ALIGN_I,ALIGN_B>(interleavedBuffer + i * stride,offset,rem,stride,stages.Skip(0,i));
+				InterleaveBundle<(VEC+1)/2,ALIGN_I,ALIGN_B>(interleavedBuffer + i * stride + VEC/2,offset+VEC/2,rem,stride,stages.Skip(VEC/2,i));
 			}
 		}
 
-		static void DeInterleaveFallback(const float *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		template <typename CANON> static void DeInterleaveFallback(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
 		{
 			for(unsigned k(0);k<channels;++k)
 				for(unsigned i(0);i<frames;++i)
 					blockBuffers[k][i]=interleavedBuffer[i*stride+k];
 		}
 
-		static void InterleaveFallback(float *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		template <typename CANON> static void InterleaveFallback(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
 		{
 			for(unsigned k(0);k<channels;++k)
 				for(unsigned i(0);i<frames;++i)
 					interleavedBuffer[i*stride+k]=blockBuffers[k][i];
 		}
 
-		template <bool AI, bool AB>
-		static void DeInterleaveVectored(const float *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		/* the bundle recursion converts frames begin .. begin + frames - 1 of the block buffers */
+		template <int VEC, bool AI, bool AB, typename CANON, typename STAGES>
+		static void DeInterleaveVectored(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, unsigned begin, const STAGES& stages)
 		{
 			if (channels == 0) return;
-			else if (channels >= 4)
-			{
-				/* interleave 4 channels from bundle into destination */
-				DeInterleaveBundle<4,AI,AB>(interleavedBuffer,blockBuffers,frames,stride);
-				DeInterleaveVectored<AI,AB>(interleavedBuffer + 4, blockBuffers + 4, frames, channels - 4, stride);
-			}
-			else if (channels >= 2)
+			else if (channels >= VEC)
 			{
-				/* interleave 2 channels from bundle into destination */
-				DeInterleaveBundle<2,AI,AB>(interleavedBuffer,blockBuffers,frames,stride);
-				DeInterleaveVectored<AI,AB>(interleavedBuffer + 2, blockBuffers + 2, frames, channels - 2, stride);
+				/* deinterleave VEC channels from bundle into destination */
+				SAMPLE *offset[VEC];
+				for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j] + begin;
+				DeInterleaveBundle<VEC,AI && (VEC > 1),AB && (VEC > 1)>(interleavedBuffer,offset,frames,stride,stages);
+				DeInterleaveVectored<VEC,AI,AB>(interleavedBuffer + VEC, blockBuffers + VEC, frames, channels - VEC, stride, begin, stages.Skip(VEC,0));
 			}
 			else
 			{
-				DeInterleaveBundle<1,false,false>(interleavedBuffer,blockBuffers,frames,stride);
+				/* narrower bundles for the channels that remain */
+				DeInterleaveVectored<(VEC+1)/2,AI,AB>(interleavedBuffer, blockBuffers, frames, channels, stride, begin, stages);
 			}
 		}
 
-		template <bool AI, bool AB>
-		static void InterleaveVectored(float *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		template <int VEC, bool AI, bool AB, typename CANON, typename STAGES>
+		static void InterleaveVectored(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, unsigned begin, const STAGES& stages)
 		{
 			if (channels == 0) return;
-			if (channels >= 4)
-			{
-				/* interleave 4 channels from bundle into destination */
-				InterleaveBundle<4,AI,AB>(interleavedBuffer,blockBuffers,frames,stride);
-				InterleaveVectored<AI,AB>(interleavedBuffer + 4, blockBuffers + 4, frames, channels - 4, stride);
-			}
-			else if (channels >= 2)
+			else if (channels >= VEC)
 			{
-				/* interleave 2 channels from bundle into destination */
-				InterleaveBundle<2,false,false>(interleavedBuffer,blockBuffers,frames,stride);
-				InterleaveVectored<AI,AB>(interleavedBuffer + 2, blockBuffers + 2, frames, channels - 2, stride);
+				/* interleave VEC channels from bundle into destination */
+				const SAMPLE *offset[VEC];
+				for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j] + begin;
+				InterleaveBundle<VEC,AI && (VEC > 2),AB && (VEC > 2)>(interleavedBuffer,offset,frames,stride,stages);
+				InterleaveVectored<VEC,AI,AB>(interleavedBuffer + VEC, blockBuffers + VEC, frames, channels - VEC, stride, begin, stages.Skip(VEC,0));
 			}
 			else
 			{
-				InterleaveBundle<1,false,false>(interleavedBuffer,blockBuffers,frames,stride);
+				/* narrower bundles for the channels that remain */
+				InterleaveVectored<(VEC+1)/2,AI,AB>(interleavedBuffer, blockBuffers, frames, channels, stride, begin, stages);
 			}
 		}
-	public:
-		static void Interleave(float *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+
+		/* the same recursion unrolled at compile time for a fixed channel count */
+		template <int VEC, unsigned CHANNELS, bool AI, bool AB, typename CANON, typename STAGES>
+		static void DeInterleaveFixed(const CANON*, SAMPLE**, unsigned, unsigned, unsigned, const STAGES&, std::integral_constant<int,0>) {}
+
+		template <int VEC, unsigned CHANNELS, bool AI, bool AB, typename CANON, typename STAGES>
+		static void DeInterleaveFixed(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned stride, unsigned begin, const STAGES& stages, std::integral_constant<int,1>)
+		{
+			SAMPLE *offset[VEC];
+			for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j] + begin;
+			DeInterleaveBundle<VEC,AI && (VEC > 1),AB && (VEC > 1)>(interleavedBuffer,offset,frames,stride,stages);
+			DeInterleaveFixed<VEC,CHANNELS - VEC,AI,AB>(interleavedBuffer + VEC,blockBuffers + VEC,frames,stride,begin,stages.Skip(VEC,0),LayoutStep<CHANNELS - VEC,VEC>());
+		}
+
+		template <int VEC, unsigned CHANNELS, bool AI, bool AB, typename CANON, typename STAGES>
+		static void DeInterleaveFixed(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned stride, unsigned begin, const STAGES& stages, std::integral_constant<int,2>)
+		{
+			DeInterleaveFixed<(VEC+1)/2,CHANNELS,AI,AB>(interleavedBuffer,blockBuffers,frames,stride,begin,stages,LayoutStep<CHANNELS,(VEC+1)/2>());
+		}
+
+		template <int VEC, unsigned CHANNELS, bool AI, bool AB, typename CANON>
+		static void InterleaveFixed(CANON*, const SAMPLE**, unsigned, unsigned, unsigned, std::integral_constant<int,0>) {}
+
+		template <int VEC, unsigned CHANNELS, bool AI, bool AB, typename CANON>
+		static void InterleaveFixed(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned stride, unsigned begin, std::integral_constant<int,1>)
+		{
+			const SAMPLE *offset[VEC];
+			for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j] + begin;
+			InterleaveBundle<VEC,AI && (VEC > 2),AB && (VEC > 2)>(interleavedBuffer,offset,frames,stride,NoStages());
+			InterleaveFixed<VEC,CHANNELS - VEC,AI,AB>(interleavedBuffer + VEC,blockBuffers + VEC,frames,stride,begin,LayoutStep<CHANNELS - VEC,VEC>());
+		}
+
+		template <int VEC, unsigned CHANNELS, bool AI, bool AB, typename CANON>
+		static void InterleaveFixed(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned stride, unsigned begin, std::integral_constant<int,2>)
+		{
+			InterleaveFixed<(VEC+1)/2,CHANNELS,AI,AB>(interleavedBuffer,blockBuffers,frames,stride,begin,LayoutStep<CHANNELS,(VEC+1)/2>());
+		}
+
+		/* are all block buffers aligned to 16 byte boundaries? */
+		template <typename PTR> static bool BlocksAligned(PTR *blockBuffers, unsigned channels)
 		{
-			/* are all block buffers aligned to 16 byte boundaries? */
-			bool ai(true),ab(true);
 			for(unsigned i(0);i<channels;++i)
 			{
 				intptr_t align = intptr_t(blockBuffers[i]);
-				if ((align&15) != 0) 
-				{
-					ab = false;break;
-				}
+				if ((align&15) != 0) return false;
 			}
+			return true;
+		}
 
-			/* is the interleaved buffer and the stride 16-byte aligned? */
+		/* is the interleaved buffer and the stride 16-byte aligned? */
+		template <typename CANON> static bool InterleavedAligned(const CANON *interleavedBuffer, unsigned stride)
+		{
 			intptr_t align = intptr_t(interleavedBuffer);
-			ai = (align&15) == 0 && (stride % 4) == 0;
+			return (align&15) == 0 && (stride % 4) == 0;
+		}
 
-			/* specialize according to alignment properties of interleaved and block buffers */
-			if (ai)
+		template <typename CANON> static unsigned TileFrames(unsigned frames, unsigned channels, unsigned stride, bool interleave)
+		{
+			return FramesPerTile(frames,stride * sizeof(CANON) + channels * sizeof(SAMPLE),interleave);
+		}
+
+		template <bool AI, bool AB, typename CANON, typename STAGES> static void InterleaveTiles(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const STAGES& stages)
+		{
+			unsigned tile = TileFrames<CANON>(frames,channels,stride,true);
+			for(unsigned begin(0);begin<frames;begin+=tile)
 			{
-				if (ab) InterleaveVectored<true,true>(interleavedBuffer,blockBuffers,frames,channels,stride);
-				else InterleaveVectored<true,false>(interleavedBuffer,blockBuffers,frames,channels,stride);
+				unsigned todo = frames - begin < tile ? frames - begin : tile;
+				InterleaveVectored<ConverterBundleWidth,AI,AB>(interleavedBuffer + begin * stride,blockBuffers,todo,channels,stride,begin,stages.Skip(0,begin));
 			}
-			else
+		}
+
+		template <bool AI, bool AB, typename CANON, typename STAGES> static void DeInterleaveTiles(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const STAGES& stages)
+		{
+			unsigned tile = TileFrames<CANON>(frames,channels,stride,false);
+			for(unsigned begin(0);begin<frames;begin+=tile)
 			{
-				if (ab) InterleaveVectored<false,true>(interleavedBuffer,blockBuffers,frames,channels,stride);
-				else InterleaveVectored<false,false>(interleavedBuffer,blockBuffers,frames,channels,stride);
+				unsigned todo = frames - begin < tile ? frames - begin : tile;
+				DeInterleaveVectored<ConverterBundleWidth,AI,AB>(interleavedBuffer + begin * stride,blockBuffers,todo,channels,stride,begin,stages.Skip(0,begin));
 			}
 		}
-		static void DeInterleave(const float *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+
+		template <unsigned CHANNELS, bool AI, bool AB, typename CANON> static void InterleaveFixedTiles(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned stride)
 		{
-			/* are all block buffers aligned to 16 byte boundaries? */
-			bool ai(true),ab(true);
-			for(unsigned i(0);i<channels;++i)
+			unsigned tile = TileFrames<CANON>(frames,CHANNELS,stride,true);
+			for(unsigned begin(0);begin<frames;begin+=tile)
 			{
-				intptr_t align = intptr_t(blockBuffers[i]);
-				if ((align&15) != 0) 
-				{
-					ab = false;
-					break;
-				}
+				unsigned todo = frames - begin < tile ? frames - begin : tile;
+				InterleaveFixed<ConverterBundleWidth,CHANNELS,AI,AB>(interleavedBuffer + begin * stride,blockBuffers,todo,stride,begin,LayoutStep<CHANNELS,ConverterBundleWidth>());
 			}
+		}
 
-			/* is the interleaved buffer and the stride 16-byte aligned? */
-			intptr_t align = intptr_t(interleavedBuffer);
-			ai = (align&15) == 0 && (stride % 4) == 0;
+		template <unsigned CHANNELS, bool AI, bool AB, typename CANON, typename STAGES> static void DeInterleaveFixedTiles(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned stride, const STAGES& stages)
+		{
+			unsigned tile = TileFrames<CANON>(frames,CHANNELS,stride,false);
+			for(unsigned begin(0);begin<frames;begin+=tile)
+			{
+				unsigned todo = frames - begin < tile ? frames - begin : tile;
+				DeInterleaveFixed<ConverterBundleWidth,CHANNELS,AI,AB>(interleavedBuffer + begin * stride,blockBuffers,todo,stride,begin,stages.Skip(0,begin),LayoutStep<CHANNELS,ConverterBundleWidth>());
+			}
+		}
+
+		/* is the destination large enough to bypass the cache? */
+		static bool Streamed(unsigned frames, unsigned channels)
+		{
+			return size_t(frames) * channels * sizeof(SAMPLE) >= GetStreamingThreshold( );
+		}
+
+		template <typename CANON, typename STAGES> static void InterleaveWith(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const STAGES& stages)
+		{
+			bool ai = InterleavedAligned(interleavedBuffer,stride), ab = BlocksAligned(blockBuffers,channels);
+
+			/* specialize according to alignment properties of interleaved and block buffers */
+			if (ai)
+			{
+				if (ab) InterleaveTiles<true,true>(interleavedBuffer,blockBuffers,frames,channels,stride,stages);
+				else InterleaveTiles<true,false>(interleavedBuffer,blockBuffers,frames,channels,stride,stages);
+			}
+			else
+			{
+				if (ab) InterleaveTiles<false,true>(interleavedBuffer,blockBuffers,frames,channels,stride,stages);
+				else InterleaveTiles<false,false>(interleavedBuffer,blockBuffers,frames,channels,stride,stages);
+			}
+		}
+
+		template <typename CANON, typename STAGES> static void DeInterleaveWith(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const STAGES& stages)
+		{
+			bool ai = InterleavedAligned(interleavedBuffer,stride), ab = BlocksAligned(blockBuffers,channels);
 
 			/* specialize according to alignment properties of interleaved and block buffers */
 			if (ai)
 			{
-				if (ab) DeInterleaveVectored<true,true>(interleavedBuffer,blockBuffers,frames,channels,stride);
-				else DeInterleaveVectored<true,false>(interleavedBuffer,blockBuffers,frames,channels,stride);
+				if (ab) DeInterleaveTiles<true,true>(interleavedBuffer,blockBuffers,frames,channels,stride,stages);
+				else DeInterleaveTiles<true,false>(interleavedBuffer,blockBuffers,frames,channels,stride,stages);
 			}
 			else
 			{
-				if (ab) DeInterleaveVectored<false,true>(interleavedBuffer,blockBuffers,frames,channels,stride);
-				else DeInterleaveVectored<false,false>(interleavedBuffer,blockBuffers,frames,channels,stride);
+				if (ab) DeInterleaveTiles<false,true>(interleavedBuffer,blockBuffers,frames,channels,stride,stages);
+				else DeInterleaveTiles<false,false>(interleavedBuffer,blockBuffers,frames,channels,stride,stages);
+			}
+		}
+
+		/* the fused stages are compiled for unaligned buffers only, and dither only for the
+		   quantized formats; calls without any stage take the plain kernels instead */
+		template <typename CANON> static void DeInterleaveDithered(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages, const ChannelMix& mix, std::true_type)
+		{
+			if (stages.dither)
+			{
+				TPDFDither dither{*stages.dither,SAMPLE::Resolution()};
+				DeInterleaveTiles<false,false>(interleavedBuffer,blockBuffers,frames,channels,stride,Stages<ChannelMix,TPDFDither>{mix,dither.Skip(stages.first)});
+			}
+			else DeInterleaveDithered(interleavedBuffer,blockBuffers,frames,channels,stride,stages,mix,std::false_type());
+		}
+
+		template <typename CANON> static void DeInterleaveDithered(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages&, const ChannelMix& mix, std::false_type)
+		{
+			DeInterleaveTiles<false,false>(interleavedBuffer,blockBuffers,frames,channels,stride,Stages<ChannelMix,NoDither>{mix,NoDither()});
+		}
+	public:
+		/* the interleaved canonical buffer is either float or double; samples are converted in float */
+		template <typename CANON> static void Interleave(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		{
+			InterleaveWith(interleavedBuffer,blockBuffers,frames,channels,stride,NoStages());
+		}
+
+		/* only the plain deinterleave streams; streaming stores need aligned block buffers */
+		template <typename CANON> static void DeInterleave(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		{
+			if (BlocksAligned(blockBuffers,channels) && Streamed(frames,channels))
+			{
+				if (InterleavedAligned(interleavedBuffer,stride)) DeInterleaveTiles<true,true>(interleavedBuffer,blockBuffers,frames,channels,stride,NoStages().Streaming());
+				else DeInterleaveTiles<false,true>(interleavedBuffer,blockBuffers,frames,channels,stride,NoStages().Streaming());
+				StreamFence();
+			}
+			else DeInterleaveWith(interleavedBuffer,blockBuffers,frames,channels,stride,NoStages());
+		}
+
+		/* straight-line conversion of exactly CHANNELS channels; the loads and stores are
+		   unaligned so that one variant serves any buffers without a check per call */
+		template <unsigned CHANNELS, typename CANON> static void Interleave(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned stride)
+		{
+			InterleaveFixedTiles<CHANNELS,false,false>(interleavedBuffer,blockBuffers,frames,stride);
+		}
+
+		template <unsigned CHANNELS, typename CANON> static void DeInterleave(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned stride)
+		{
+			DeInterleaveFixedTiles<CHANNELS,false,false>(interleavedBuffer,blockBuffers,frames,stride,NoStages());
+		}
+
+		/* gain and routing are applied to the float vectors in registers */
+		template <typename CANON> static void Interleave(CANON *interleavedBuffer, const SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages)
+		{
+			if (stages.gain || stages.routeBegin)
+			{
+				ChannelMix mix{stages,(const void* const*)blockBuffers,channels,stages.first,0};
+				InterleaveTiles<false,false>(interleavedBuffer,blockBuffers,frames,channels,stride,Stages<ChannelMix,NoDither>{mix,NoDither()});
+			}
+			else Interleave(interleavedBuffer,blockBuffers,frames,channels,stride);
+		}
+
+		/* dither is fused into the quantization of integer formats and ignored by float formats;
+		   it runs with the channel mix, whose gain is unity without gains or routes */
+		template <typename CANON> static void DeInterleave(const CANON *interleavedBuffer, SAMPLE **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages)
+		{
+			if (stages.gain || stages.routeBegin || (SAMPLE::quantized && stages.dither))
+			{
+				ChannelMix mix{stages,(const void* const*)blockBuffers,channels,stages.first,0};
+				DeInterleaveDithered(interleavedBuffer,blockBuffers,frames,channels,stride,stages,mix,std::integral_constant<bool,SAMPLE::quantized>());
+			}
+			else DeInterleave(interleavedBuffer,blockBuffers,frames,channels,stride);
+		}
+	};
+
+	/* type-erased entry points for the runtime dispatch tables in pad_converters.h */
+	template <typename SAMPLE> struct ChannelKernel {
+		template <typename CANON> static void Interleave(CANON *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		{
+			ChannelConverter<SAMPLE>::Interleave(interleavedBuffer,(const SAMPLE**)blockBuffers,frames,channels,stride);
+		}
+
+		template <typename CANON> static void DeInterleave(const CANON *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		{
+			ChannelConverter<SAMPLE>::DeInterleave(interleavedBuffer,(SAMPLE**)blockBuffers,frames,channels,stride);
+		}
+
+		template <typename CANON> static void InterleaveFused(CANON *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages)
+		{
+			ChannelConverter<SAMPLE>::Interleave(interleavedBuffer,(const SAMPLE**)blockBuffers,frames,channels,stride,stages);
+		}
+
+		template <typename CANON> static void DeInterleaveFused(const CANON *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages)
+		{
+			ChannelConverter<SAMPLE>::DeInterleave(interleavedBuffer,(SAMPLE**)blockBuffers,frames,channels,stride,stages);
+		}
+
+		/* the channel count is fixed when the kernel is selected */
+		template <typename CANON, unsigned CHANNELS> static void InterleaveFixed(CANON *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		{
+			assert(channels == CHANNELS);
+			(void)channels;
+			ChannelConverter<SAMPLE>::template Interleave<CHANNELS>(interleavedBuffer,(const SAMPLE**)blockBuffers,frames,stride);
+		}
+
+		template <typename CANON, unsigned CHANNELS> static void DeInterleaveFixed(const CANON *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		{
+			assert(channels == CHANNELS);
+			(void)channels;
+			ChannelConverter<SAMPLE>::template DeInterleave<CHANNELS>(interleavedBuffer,(SAMPLE**)blockBuffers,frames,stride);
+		}
+	};
+
+	/* integer canonical samples are left justified to the width of the canonical type. Integer
+	   hosts are converted with a byte swap and a shift, truncating when narrowing; containers
+	   wider than their nominal range are clipped to it first. Float hosts are scaled, clipped
+	   and rounded to nearest like the float canonical path */
+	template <typename HOST, int MINUS, int SHIFT, bool BIGENDIAN> struct IntegerSample {
+		static constexpr int Bits(int64_t range) { return range <= 1 ? 1 : 1 + Bits(range / 2); }
+
+		static const bool isFloat = std::is_floating_point<HOST>::value;
+		static const bool swapBytes = BIGENDIAN != SYSTEM_BIGENDIAN;
+		/* significant bits of a full scale host sample, and of a nominal one */
+		static const int nominalBits = Bits(-int64_t(MINUS));
+		static const int hostBits = nominalBits + SHIFT;
+		static const bool clipped = SHIFT == 0 && int(sizeof(HOST) * 8) > nominalBits;
+
+		template <typename CANON> static CANON ToCanonical(HOST h, std::false_type)
+		{
+			const int canonBits = sizeof(CANON) * 8;
+			const int up = canonBits > hostBits ? canonBits - hostBits : 0, down = hostBits > canonBits ? hostBits - canonBits : 0;
+			if (swapBytes) h = Bytes<HOST>::Swap(h);
+			int32_t raw = int32_t(h);
+			if (clipped) raw = Max<int32_t>(Min<int32_t>(raw,-MINUS - 1),MINUS);
+			return CANON(int32_t(uint32_t(raw) << up) >> down);
+		}
+
+		template <typename CANON> static CANON ToCanonical(HOST h, std::true_type)
+		{
+			const double scale = double(1u << (sizeof(CANON) * 8 - 1)), top = scale - 1;
+			if (swapBytes) h = Bytes<HOST>::Swap(h);
+			double x = double(h) * scale;
+			return CANON(Round(Max(Min(top,x),-scale)));
+		}
+
+		template <typename CANON> static HOST FromCanonical(CANON v, std::false_type)
+		{
+			const int canonBits = sizeof(CANON) * 8;
+			const int up = hostBits > canonBits ? hostBits - canonBits : 0, down = canonBits > hostBits ? canonBits - hostBits : 0;
+			HOST h = HOST(int32_t(uint32_t(int32_t(v) >> down) << up));
+			return swapBytes ? Bytes<HOST>::Swap(h) : h;
+		}
+
+		template <typename CANON> static HOST FromCanonical(CANON v, std::true_type)
+		{
+			HOST h = HOST(double(v) * (1.0 / double(1u << (sizeof(CANON) * 8 - 1))));
+			return swapBytes ? Bytes<HOST>::Swap(h) : h;
+		}
+
+		template <typename CANON> static CANON ToCanonical(HOST h) { return ToCanonical<CANON>(h,std::integral_constant<bool,isFloat>()); }
+		template <typename CANON> static HOST FromCanonical(CANON v) { return FromCanonical<CANON>(v,std::integral_constant<bool,isFloat>()); }
+
+		/* host vectors as 32-bit lanes, and back */
+		template <int N> static const SampleVector<int32_t,N>& Lanes(const SampleVector<int32_t,N>& x) { return x; }
+		template <int N> static SampleVector<int32_t,N> Lanes(const SampleVector<int24_t,N>& x) { return SampleVector<int32_t,N>(x); }
+		template <int N> static SampleVector<int32_t,N> Lanes(const SampleVector<int16_t,N>& x) { return WidenLanes(x); }
+		template <int N> static SampleVector<int32_t,N> FromLanes(const SampleVector<int32_t,N>& x, const int32_t*) { return x; }
+		template <int N> static SampleVector<int24_t,N> FromLanes(const SampleVector<int32_t,N>& x, const int24_t*) { return SampleVector<int24_t,N>(x); }
+		template <int N> static SampleVector<int16_t,N> FromLanes(const SampleVector<int32_t,N>& x, const int16_t*) { return NarrowLanes(x); }
+
+		/* N consecutive samples of a block buffer to and from canonical samples in 32-bit
+		   lanes. Integer hosts are swapped, clipped and shifted in registers like the scalar
+		   conversion. Float32 hosts are scaled by a power of two in float, which is exact, so
+		   the clip and round agree with the double precision one; Float64 hosts are
+		   converted lane by lane */
+		typedef std::integral_constant<int,isFloat == false ? 0 : sizeof(HOST) == sizeof(float) ? 1 : 2> LaneConversion;
+
+		template <typename CANON, int N> static SampleVector<int32_t,N> ToCanonicalLanes(const HOST *block, std::integral_constant<int,0>)
+		{
+			const int canonBits = sizeof(CANON) * 8;
+			const int up = canonBits > hostBits ? canonBits - hostBits : 0, down = hostBits > canonBits ? hostBits - canonBits : 0;
+			SampleVector<HOST,N> h;
+			h.template Load<false>(block);
+			if (swapBytes) h = Bytes<SampleVector<HOST,N>>::Swap(h);
+			SampleVector<int32_t,N> raw = Lanes(h);
+			if (clipped) raw = ClipLanes(raw,MINUS,-MINUS - 1);
+			return ShiftLanesRight<down>(ShiftLanesLeft<up>(raw));
+		}
+
+		template <typename CANON, int N> static SampleVector<int32_t,N> ToCanonicalLanes(const HOST *block, std::integral_constant<int,1>)
+		{
+			const float scale = float(1u << (sizeof(CANON) * 8 - 1));
+			SampleVector<float,N> h;
+			h.template Load<false>(block);
+			if (swapBytes) h = Bytes<SampleVector<float,N>>::Swap(h);
+			return RoundLanes(h * SampleVector<float,N>(scale),-scale,scale - 1);
+		}
+
+		template <typename CANON, int N> static SampleVector<int32_t,N> ToCanonicalLanes(const HOST *block, std::integral_constant<int,2>)
+		{
+			SampleVector<int32_t,N> x;
+			for(unsigned i(0);i<N;++i) x[i] = ToCanonical<CANON>(block[i]);
+			return x;
+		}
+
+		template <typename CANON, int N> static void FromCanonicalLanes(HOST *block, const SampleVector<int32_t,N>& x, std::integral_constant<int,0>)
+		{
+			const int canonBits = sizeof(CANON) * 8;
+			const int up = hostBits > canonBits ? hostBits - canonBits : 0, down = canonBits > hostBits ? canonBits - hostBits : 0;
+			SampleVector<HOST,N> h = FromLanes(ShiftLanesLeft<up>(ShiftLanesRight<down>(x)),block);
+			if (swapBytes) h = Bytes<SampleVector<HOST,N>>::Swap(h);
+			h.template Write<false>(block);
+		}
+
+		template <typename CANON, int N> static void FromCanonicalLanes(HOST *block, const SampleVector<int32_t,N>& x, std::integral_constant<int,1>)
+		{
+			SampleVector<float,N> h = SampleVector<float,N>(x) * SampleVector<float,N>(1.f / float(1u << (sizeof(CANON) * 8 - 1)));
+			if (swapBytes) h = Bytes<SampleVector<float,N>>::Swap(h);
+			h.template Write<false>(block);
+		}
+
+		template <typename CANON, int N> static void FromCanonicalLanes(HOST *block, const SampleVector<int32_t,N>& x, std::integral_constant<int,2>)
+		{
+			for(unsigned i(0);i<N;++i) block[i] = FromCanonical<CANON>(CANON(x[i]));
+		}
+
+		template <typename CANON, int N> static SampleVector<int32_t,N> ToCanonicalLanes(const HOST *block) { return ToCanonicalLanes<CANON,N>(block,LaneConversion()); }
+		template <typename CANON, int N> static void FromCanonicalLanes(HOST *block, const SampleVector<int32_t,N>& x) { FromCanonicalLanes<CANON,N>(block,x,LaneConversion()); }
+	};
+
+	/* transposition of integer canonical streams on the bundle transposes of the float
+	   converters, which only move 32-bit lanes: bundles of channels are converted to or from
+	   canonical samples in 32-bit lanes and transposed as float vectors of the same bits */
+	template <typename HOST, int MINUS, int SHIFT, bool BIGENDIAN> struct IntegerKernel {
+		typedef IntegerSample<HOST,MINUS,SHIFT,BIGENDIAN> Sample;
+
+		/* rows of the interleaved buffer in 32-bit lanes; int16 rows are sign extended */
+		template <int N> static SampleVector<int32_t,N> LoadRow(const int32_t *row)
+		{
+			SampleVector<int32_t,N> x;
+			x.template Load<false>(row);
+			return x;
+		}
+
+		template <int N> static SampleVector<int32_t,N> LoadRow(const int16_t *row)
+		{
+			SampleVector<int16_t,N> x;
+			x.template Load<false>(row);
+			return WidenLanes(x);
+		}
+
+		template <int N> static void StoreRow(int32_t *row, SampleVector<int32_t,N> x) { x.template Write<false>(row); }
+		template <int N> static void StoreRow(int16_t *row, const SampleVector<int32_t,N>& x) { NarrowLanes(x).template Write<false>(row); }
+
+		template <int N> static void TransposeLanes(SampleVector<int32_t,N> *v)
+		{
+			SampleVector<float,N> f[N];
+			for(unsigned j(0);j<N;++j) f[j] = AsFloatLanes(v[j]);
+			Transpose(f);
+			for(unsigned j(0);j<N;++j) v[j] = AsIntLanes(f[j]);
+		}
+
+		/* bundles narrower than four lanes gain nothing from registers and convert each sample */
+		template <int VEC> using Vectored = std::integral_constant<bool,(VEC >= 4)>;
+
+		template <int VEC, typename CANON> static void InterleaveBundle(CANON *interleavedBuffer, const HOST **blockBuffers, unsigned frames, unsigned stride, std::false_type)
+		{
+			for(unsigned j(0);j<VEC;++j)
+				for(unsigned i(0);i<frames;++i) interleavedBuffer[i * stride + j] = Sample::template ToCanonical<CANON>(blockBuffers[j][i]);
+		}
+
+		template <int VEC, typename CANON> static void DeInterleaveBundle(const CANON *interleavedBuffer, HOST **blockBuffers, unsigned frames, unsigned stride, std::false_type)
+		{
+			for(unsigned j(0);j<VEC;++j)
+				for(unsigned i(0);i<frames;++i) blockBuffers[j][i] = Sample::template FromCanonical<CANON>(interleavedBuffer[i * stride + j]);
+		}
+
+		template <int VEC, typename CANON> static void InterleaveBundle(CANON *interleavedBuffer, const HOST **blockBuffers, unsigned frames, unsigned stride, std::true_type)
+		{
+			unsigned i(0);
+			for(;i+VEC<=frames;i+=VEC)
+			{
+				SampleVector<int32_t,VEC> mtx[VEC];
+				for(unsigned j(0);j<VEC;++j) mtx[j] = Sample::template ToCanonicalLanes<CANON,VEC>(blockBuffers[j] + i);
+
+				TransposeLanes(mtx);
+
+				for(unsigned j(0);j<VEC;++j) StoreRow(interleavedBuffer + (i+j) * stride,mtx[j]);
+			}
+
+			if (i < frames)
+			{
+				/* loop remainder */
+				const HOST *offset[VEC];
+				for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j] + i;
+				InterleaveBundle<(VEC+1)/2>(interleavedBuffer + i * stride,offset,frames - i,stride,Vectored<(VEC+1)/2>());
+				InterleaveBundle<(VEC+1)/2>(interleavedBuffer + i * stride + VEC/2,offset + VEC/2,frames - i,stride,Vectored<(VEC+1)/2>());
 			}
 		}
+
+		template <int VEC, typename CANON> static void DeInterleaveBundle(const CANON *interleavedBuffer, HOST **blockBuffers, unsigned frames, unsigned stride, std::true_type)
+		{
+			unsigned i(0);
+			for(;i+VEC<=frames;i+=VEC)
+			{
+				SampleVector<int32_t,VEC> mtx[VEC];
+				for(unsigned j(0);j<VEC;++j) mtx[j] = LoadRow<VEC>(interleavedBuffer + (i+j) * stride);
+
+				TransposeLanes(mtx);
+
+				for(unsigned j(0);j<VEC;++j) Sample::template FromCanonicalLanes<CANON,VEC>(blockBuffers[j] + i,mtx[j]);
+			}
+
+			if (i < frames)
+			{
+				/* loop remainder */
+				HOST *offset[VEC];
+				for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j] + i;
+				DeInterleaveBundle<(VEC+1)/2>(interleavedBuffer + i * stride,offset,frames - i,stride,Vectored<(VEC+1)/2>());
+				DeInterleaveBundle<(VEC+1)/2>(interleavedBuffer + i * stride + VEC/2,offset + VEC/2,frames - i,stride,Vectored<(VEC+1)/2>());
+			}
+		}
+
+		/* the bundle recursion over channels converts frames begin .. begin + frames - 1 */
+		template <int VEC, typename CANON> static void InterleaveVectored(CANON *interleavedBuffer, const HOST **blockBuffers, unsigned frames, unsigned channels, unsigned stride, unsigned begin)
+		{
+			if (channels == 0) return;
+			else if (channels >= VEC)
+			{
+				const HOST *offset[VEC];
+				for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j] + begin;
+				InterleaveBundle<VEC>(interleavedBuffer,offset,frames,stride,Vectored<VEC>());
+				InterleaveVectored<VEC>(interleavedBuffer + VEC,blockBuffers + VEC,frames,channels - VEC,stride,begin);
+			}
+			else InterleaveVectored<(VEC+1)/2>(interleavedBuffer,blockBuffers,frames,channels,stride,begin);
+		}
+
+		template <int VEC, typename CANON> static void DeInterleaveVectored(const CANON *interleavedBuffer, HOST **blockBuffers, unsigned frames, unsigned channels, unsigned stride, unsigned begin)
+		{
+			if (channels == 0) return;
+			else if (channels >= VEC)
+			{
+				HOST *offset[VEC];
+				for(unsigned j(0);j<VEC;++j) offset[j] = blockBuffers[j] + begin;
+				DeInterleaveBundle<VEC>(interleavedBuffer,offset,frames,stride,Vectored<VEC>());
+				DeInterleaveVectored<VEC>(interleavedBuffer + VEC,blockBuffers + VEC,frames,channels - VEC,stride,begin);
+			}
+			else DeInterleaveVectored<(VEC+1)/2>(interleavedBuffer,blockBuffers,frames,channels,stride,begin);
+		}
+
+		template <typename CANON> static void Interleave(CANON *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		{
+			unsigned tile = FramesPerTile(frames,stride * sizeof(CANON) + channels * sizeof(HOST),true);
+			for(unsigned begin(0);begin<frames;begin+=tile)
+			{
+				unsigned todo = frames - begin < tile ? frames - begin : tile;
+				InterleaveVectored<ConverterBundleWidth>(interleavedBuffer + begin * stride,(const HOST**)blockBuffers,todo,channels,stride,begin);
+			}
+		}
+
+		template <typename CANON> static void DeInterleave(const CANON *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride)
+		{
+			unsigned tile = FramesPerTile(frames,stride * sizeof(CANON) + channels * sizeof(HOST),false);
+			for(unsigned begin(0);begin<frames;begin+=tile)
+			{
+				unsigned todo = frames - begin < tile ? frames - begin : tile;
+				DeInterleaveVectored<ConverterBundleWidth>(interleavedBuffer + begin * stride,(HOST**)blockBuffers,todo,channels,stride,begin);
+			}
+		}
+	};
+
+	/* kernels of one host format for each of PAD_FIXED_LAYOUTS; only the plain float entries
+	   are specialized, the double, fused and integer entries are the generic ones */
+	template <typename HOST, int MINUS, int PLUS, int SHIFT, bool BIGENDIAN> struct FixedChannelKernels {
+		typedef HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN> SAMPLE;
+		typedef IntegerKernel<HOST,MINUS,SHIFT,BIGENDIAN> INTEGER;
+		static const ChannelKernels table[];
+	};
+
+#define PAD_FIXED_LAYOUT_KERNEL(CHANNELS) \
+	{ ChannelKernel<SAMPLE>::template InterleaveFixed<float,CHANNELS>, \
+	  ChannelKernel<SAMPLE>::template DeInterleaveFixed<float,CHANNELS>, \
+	  ChannelKernel<SAMPLE>::template Interleave<double>, \
+	  ChannelKernel<SAMPLE>::template DeInterleave<double>, \
+	  ChannelKernel<SAMPLE>::template InterleaveFused<float>, \
+	  ChannelKernel<SAMPLE>::template DeInterleaveFused<float>, \
+	  ChannelKernel<SAMPLE>::template InterleaveFused<double>, \
+	  ChannelKernel<SAMPLE>::template DeInterleaveFused<double>, \
+	  INTEGER::template Interleave<int32_t>, \
+	  INTEGER::template DeInterleave<int32_t>, \
+	  INTEGER::template Interleave<int16_t>, \
+	  INTEGER::template DeInterleave<int16_t> },
+
+	template <typename HOST, int MINUS, int PLUS, int SHIFT, bool BIGENDIAN> const ChannelKernels FixedChannelKernels<HOST,MINUS,PLUS,SHIFT,BIGENDIAN>::table[] = {
+		PAD_FIXED_LAYOUTS(PAD_FIXED_LAYOUT_KERNEL)
 	};
-}
\ No newline at end of file
+
+#undef PAD_FIXED_LAYOUT_KERNEL
+
+	/* table entry for one line of PAD_HOST_FORMATS */
+#define PAD_CHANNEL_KERNEL(NAME, HOST, MINUS, PLUS, SHIFT, BIGENDIAN) \
+	{ ChannelKernel<HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN>>::Interleave<float>, \
+	  ChannelKernel<HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN>>::DeInterleave<float>, \
+	  ChannelKernel<HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN>>::Interleave<double>, \
+	  ChannelKernel<HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN>>::DeInterleave<double>, \
+	  ChannelKernel<HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN>>::InterleaveFused<float>, \
+	  ChannelKernel<HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN>>::DeInterleaveFused<float>, \
+	  ChannelKernel<HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN>>::InterleaveFused<double>, \
+	  ChannelKernel<HostSample<HOST,float,MINUS,PLUS,SHIFT,BIGENDIAN>>::DeInterleaveFused<double>, \
+	  IntegerKernel<HOST,MINUS,SHIFT,BIGENDIAN>::Interleave<int32_t>, \
+	  IntegerKernel<HOST,MINUS,SHIFT,BIGENDIAN>::DeInterleave<int32_t>, \
+	  IntegerKernel<HOST,MINUS,SHIFT,BIGENDIAN>::Interleave<int16_t>, \
+	  IntegerKernel<HOST,MINUS,SHIFT,BIGENDIAN>::DeInterleave<int16_t> },
+
+	/* fixed layout table of PAD_FIXED_LAYOUT_FORMAT */
+#define PAD_FIXED_CHANNEL_KERNELS(NAME, HOST, MINUS, PLUS, SHIFT, BIGENDIAN) \
+	FixedChannelKernels<HOST,MINUS,PLUS,SHIFT,BIGENDIAN>::table
+}
+}
@@ -0,0 +1,210 @@
+#include "pad_converters.h"
+
+#include <atomic>
+
+#ifndef PAD_STREAMING_THRESHOLD
+#define PAD_STREAMING_THRESHOLD (~size_t(0))
+#endif
+
+#ifndef PAD_TILING_THRESHOLD
+#define PAD_TILING_THRESHOLD AutomaticTiling
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace PAD {
+	namespace Converter {
+		const char* GetName(HostFormat fmt) {
+			static const char *names[] = {
+#define PAD_HOST_FORMAT_NAME(NAME, ...) #NAME,
+				PAD_HOST_FORMATS(PAD_HOST_FORMAT_NAME)
+#undef PAD_HOST_FORMAT_NAME
+			};
+			return fmt < HostFormat::NumFormats ? names[(int)fmt] : "unknown";
+		}
+
+		void ResetDither(uint32_t *seed, float *error, unsigned channels) {
+			uint32_t state = 0x9e3779b9u;
+			for (unsigned i(0); i < channels; ++i) {
+				/* xorshift32 must not start from zero */
+				do state = state * 1664525u + 1013904223u; while (state == 0);
+				seed[i] = state;
+				error[i] = 0;
+			}
+		}
+
+		const char* GetName(ConverterISA isa) {
+			switch (isa) {
+			case ConverterISA::Baseline: return "baseline";
+			case ConverterISA::AVX2: return "avx2";
+			case ConverterISA::AVX512: return "avx512";
+			default: return "unknown";
+			}
+		}
+
+		static std::atomic<size_t> streamingThreshold(PAD_STREAMING_THRESHOLD);
+
+		void SetStreamingThreshold(size_t bytes) {
+			streamingThreshold.store(bytes, std::memory_order_relaxed);
+		}
+
+		size_t GetStreamingThreshold( ) {
+			return streamingThreshold.load(std::memory_order_relaxed);
+		}
+
+		static std::atomic<size_t> tilingThreshold(PAD_TILING_THRESHOLD);
+
+		void SetTilingThreshold(size_t bytes) {
+			tilingThreshold.store(bytes, std::memory_order_relaxed);
+		}
+
+		size_t GetTilingThreshold( ) {
+			return tilingThreshold.load(std::memory_order_relaxed);
+		}
+
+		size_t GetTilingThreshold(ConverterISA isa, bool interleave) {
+			size_t bytes = tilingThreshold.load(std::memory_order_relaxed);
+			if (bytes != AutomaticTiling) return bytes;
+			/* over 1024 frames, tiled interleave is 1.6-2.5x faster on the baseline kernels
+			   from 64 channels, the smallest of which is 384 KiB of Int16 blocks and float
+			   rows. AVX2 gains 1.5-1.9x at 256 channels, from 1.5 MiB, and is mixed below.
+			   AVX-512 interleave loses and deinterleave is within noise or loses */
+			if (interleave == false) return ~size_t(0);
+			switch (isa) {
+			case ConverterISA::Baseline: return 384 * 1024;
+			case ConverterISA::AVX2: return 1536 * 1024;
+			default: return ~size_t(0);
+			}
+		}
+
+		unsigned GetBundleWidth(ConverterISA isa) {
+			switch (isa) {
+			case ConverterISA::AVX2: return 8;
+			case ConverterISA::AVX512: return 16;
+			default: return 4;
+			}
+		}
+
+#if defined(PAD_CONVERTERS_AVX2) || defined(PAD_CONVERTERS_AVX512)
+		static void CPUID(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+			__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+			__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		}
+
+		static uint64_t XCR0( ) {
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			uint32_t lo, hi;
+			__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+			return ((uint64_t)hi << 32) | lo;
+#endif
+		}
+
+		static bool DetectAVX2( ) {
+			unsigned regs[4];
+			CPUID(0, 0, regs);
+			if (regs[0] < 7) return false;
+
+			/* the OS must preserve the ymm state across context switches */
+			CPUID(1, 0, regs);
+			const unsigned osxsave = 1u << 27, avx = 1u << 28;
+			if ((regs[2] & (osxsave | avx)) != (osxsave | avx)) return false;
+			if ((XCR0( ) & 0x6) != 0x6) return false;
+
+			CPUID(7, 0, regs);
+			return (regs[1] & (1u << 5)) != 0;
+		}
+
+		static bool DetectAVX512F( ) {
+			if (DetectAVX2( ) == false) return false;
+
+			/* opmask and both halves of the zmm register file must be OS managed */
+			if ((XCR0( ) & 0xe6) != 0xe6) return false;
+
+			unsigned regs[4];
+			CPUID(7, 0, regs);
+			return (regs[1] & (1u << 16)) != 0;
+		}
+#endif
+
+		bool IsSupported(ConverterISA isa) {
+			switch (isa) {
+			case ConverterISA::Baseline: return true;
+#if defined(PAD_CONVERTERS_AVX2)
+			case ConverterISA::AVX2:
+			{
+				static const bool hasAVX2 = DetectAVX2( );
+				return hasAVX2;
+			}
+#endif
+#if defined(PAD_CONVERTERS_AVX512)
+			case ConverterISA::AVX512:
+			{
+				static const bool hasAVX512F = DetectAVX512F( );
+				return hasAVX512F;
+			}
+#endif
+			default: return false;
+			}
+		}
+
+		ConverterISA GetConverterISA( ) {
+			static const ConverterISA best =
+				IsSupported(ConverterISA::AVX512) ? ConverterISA::AVX512 :
+				IsSupported(ConverterISA::AVX2) ? ConverterISA::AVX2 : ConverterISA::Baseline;
+			return best;
+		}
+
+		const ChannelKernels& GetChannelKernels(HostFormat fmt, ConverterISA isa) {
+			switch (IsSupported(isa) ? isa : ConverterISA::Baseline) {
+#if defined(PAD_CONVERTERS_AVX2)
+			case ConverterISA::AVX2: return AVX2ChannelKernels[(int)fmt];
+#endif
+#if defined(PAD_CONVERTERS_AVX512)
+			case ConverterISA::AVX512: return AVX512ChannelKernels[(int)fmt];
+#endif
+			default: return BaselineChannelKernels[(int)fmt];
+			}
+		}
+
+		const ChannelKernels& GetChannelKernels(HostFormat fmt) {
+			return GetChannelKernels(fmt, GetConverterISA( ));
+		}
+
+		static int FixedLayout(unsigned channels) {
+			static const unsigned layouts[] = {
+#define PAD_FIXED_LAYOUT_COUNT(CHANNELS) CHANNELS,
+				PAD_FIXED_LAYOUTS(PAD_FIXED_LAYOUT_COUNT)
+#undef PAD_FIXED_LAYOUT_COUNT
+			};
+			for (int i(0); i < int(sizeof(layouts) / sizeof(layouts[0])); ++i) if (layouts[i] == channels) return i;
+			return -1;
+		}
+
+		const ChannelKernels& GetChannelKernels(HostFormat fmt, ConverterISA isa, unsigned channels) {
+			int layout = FixedLayout(channels);
+			if (fmt != FixedLayoutFormat || layout < 0) return GetChannelKernels(fmt, isa);
+			switch (IsSupported(isa) ? isa : ConverterISA::Baseline) {
+#if defined(PAD_CONVERTERS_AVX2)
+			case ConverterISA::AVX2: return AVX2FixedChannelKernels[layout];
+#endif
+#if defined(PAD_CONVERTERS_AVX512)
+			case ConverterISA::AVX512: return AVX512FixedChannelKernels[layout];
+#endif
+			default: return BaselineFixedChannelKernels[layout];
+			}
+		}
+
+		const ChannelKernels& GetChannelKernels(HostFormat fmt, unsigned channels) {
+			return GetChannelKernels(fmt, GetConverterISA( ), channels);
+		}
+	}
+}
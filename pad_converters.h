@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace PAD {
+	namespace Converter {
+		/**
+		 * Host sample formats the channel converters are instantiated for:
+		 * name, host sample type, nominal minus, nominal plus, left shift, big endian
+		 ***/
+#define PAD_HOST_FORMATS(F) \
+		F(Int16LSB,   int16_t, -(1 << 15), (1 << 15) - 1, 0, false) \
+		F(Int16MSB,   int16_t, -(1 << 15), (1 << 15) - 1, 0, true)  \
+		F(Int24LSB,   int24_t, -(1 << 23), (1 << 23) - 1, 0, false) \
+		F(Int24MSB,   int24_t, -(1 << 23), (1 << 23) - 1, 0, true)  \
+		F(Int32LSB,   int32_t, -(1 << 23), (1 << 23) - 1, 8, false) \
+		F(Int32MSB,   int32_t, -(1 << 23), (1 << 23) - 1, 8, true)  \
+		F(Int32LSB16, int32_t, -(1 << 15), (1 << 15) - 1, 0, false) \
+		F(Int32MSB16, int32_t, -(1 << 15), (1 << 15) - 1, 0, true)  \
+		F(Int32LSB18, int32_t, -(1 << 17), (1 << 17) - 1, 0, false) \
+		F(Int32MSB18, int32_t, -(1 << 17), (1 << 17) - 1, 0, true)  \
+		F(Int32LSB20, int32_t, -(1 << 19), (1 << 19) - 1, 0, false) \
+		F(Int32MSB20, int32_t, -(1 << 19), (1 << 19) - 1, 0, true)  \
+		F(Int32LSB24, int32_t, -(1 << 23), (1 << 23) - 1, 0, false) \
+		F(Int32MSB24, int32_t, -(1 << 23), (1 << 23) - 1, 0, true)  \
+		F(Float32LSB, float,   -1,         1,             0, false) \
+		F(Float32MSB, float,   -1,         1,             0, true)  \
+		F(Float64LSB, double,  -1,         1,             0, false) \
+		F(Float64MSB, double,  -1,         1,             0, true)
+
+		/* channel counts with kernels specialized at compile time */
+#define PAD_FIXED_LAYOUTS(F) F(1) F(2) F(6) F(8) F(16) F(32) F(64)
+
+		/* the one host format specialized for them: the little endian float blocks that JACK
+		   and the virtual devices select at Open. Other formats use the generic kernels */
+#define PAD_FIXED_LAYOUT_FORMAT(F) F(Float32LSB, float, -1, 1, 0, false)
+
+		enum class HostFormat {
+#define PAD_HOST_FORMAT_ENUM(NAME, ...) NAME,
+			PAD_HOST_FORMATS(PAD_HOST_FORMAT_ENUM)
+#undef PAD_HOST_FORMAT_ENUM
+			NumFormats
+		};
+
+#define PAD_FIXED_LAYOUT_ENUM(NAME, ...) HostFormat::NAME
+		static const HostFormat FixedLayoutFormat = PAD_FIXED_LAYOUT_FORMAT(PAD_FIXED_LAYOUT_ENUM);
+#undef PAD_FIXED_LAYOUT_ENUM
+
+		enum class ConverterISA {
+			Baseline,
+			AVX2,
+			AVX512,
+			NumISAs
+		};
+
+		/* TPDF dither state of the output channels: one xorshift generator and one error
+		   feedback term per stream channel, advanced in place by each conversion. The
+		   error feedback shapes the noise with a first order highpass when shaped is set */
+		struct DitherState {
+			uint32_t *seed;
+			float *error;
+			bool shaped;
+		};
+
+		/* seeds distinct nonzero generators and clears the error terms */
+		void ResetDither(uint32_t *seed, float *error, unsigned channels);
+
+		/* one term of a sparse routing matrix row */
+		struct RouteTerm {
+			unsigned source;
+			float gain;
+		};
+
+		/* optional stages fused into a conversion, indexed by stream channel; a call converts
+		   the stream channels first .. first + channels - 1. A destination channel d with terms
+		   routes[routeBegin[d] .. routeBegin[d+1]) is replaced by the sum of gain * source over
+		   them, then every channel is scaled by its gain. Interleave reads sources from the
+		   block buffers of the same call and skips others; deinterleave reads any column of
+		   the interleaved buffer. Dither applies when deinterleaving to integer formats */
+		struct FusedStages {
+			unsigned first;
+			const float *gain;
+			const unsigned *routeBegin;
+			const RouteTerm *routes;
+			const DitherState *dither;
+		};
+
+		struct ChannelKernels {
+			void(*Interleave)(float *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride);
+			void(*DeInterleave)(const float *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride);
+
+			/* the same conversions to and from a double precision interleaved buffer */
+			void(*Interleave64)(double *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride);
+			void(*DeInterleave64)(const double *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride);
+
+			/* the same conversions with gain, routing and dither applied in registers */
+			void(*InterleaveFused)(float *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages);
+			void(*DeInterleaveFused)(const float *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages);
+			void(*InterleaveFused64)(double *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages);
+			void(*DeInterleaveFused64)(const double *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages);
+
+			/* transposition to and from integer interleaved buffers, left justified to the full
+			   width of the type; integer hosts are only byte swapped and shifted */
+			void(*InterleaveInt32)(int32_t *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride);
+			void(*DeInterleaveInt32)(const int32_t *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride);
+			void(*InterleaveInt16)(int16_t *interleavedBuffer, const void **blockBuffers, unsigned frames, unsigned channels, unsigned stride);
+			void(*DeInterleaveInt16)(const int16_t *interleavedBuffer, void **blockBuffers, unsigned frames, unsigned channels, unsigned stride);
+		};
+
+		const char* GetName(HostFormat);
+		const char* GetName(ConverterISA);
+
+		/* destination size in bytes from which the plain DeInterleave entries use streaming
+		   stores to aligned block buffers; the fused and fixed layout entries never stream.
+		   Device buffers are written once per cycle and not read back, so caching them would
+		   only evict the working set of the audio callback. The crossover depends on the
+		   memory system, so streaming is off unless a threshold is set here or with
+		   PAD_STREAMING_THRESHOLD at build time; pad_bench_streaming measures it */
+		void SetStreamingThreshold(size_t bytes);
+		size_t GetStreamingThreshold( );
+
+		/* working set in bytes, interleaved rows plus block buffers, from which the converters
+		   traverse a buffer in frame tiles, one tile across every channel bundle at a time.
+		   Tiling only pays off where the passes of the bundles over the interleaved buffer fall
+		   out of cache. A threshold set here or with PAD_TILING_THRESHOLD at build time applies
+		   to every pass; AutomaticTiling, the default, picks one per ISA and direction from
+		   pad_bench_tiling: the baseline interleave passes tile from 384 KiB, AVX2 interleave
+		   from 1.5 MiB, and AVX-512 and deinterleave never tile */
+		static const size_t AutomaticTiling = ~size_t(0) - 1;
+		void SetTilingThreshold(size_t bytes);
+		size_t GetTilingThreshold( );
+
+		/* the threshold in effect for the passes of an ISA in one direction */
+		size_t GetTilingThreshold(ConverterISA, bool interleave);
+
+		/* channels transposed together in registers by the kernels of an ISA */
+		unsigned GetBundleWidth(ConverterISA);
+
+		/* ISA is compiled into this build and supported by the running cpu */
+		bool IsSupported(ConverterISA);
+
+		/* the widest supported ISA, detected once with cpuid */
+		ConverterISA GetConverterISA( );
+
+		/* unsupported ISAs fall back to the baseline kernels */
+		const ChannelKernels& GetChannelKernels(HostFormat, ConverterISA);
+		const ChannelKernels& GetChannelKernels(HostFormat);
+
+		/* kernels to be selected once per stream for a known channel count; for FixedLayoutFormat
+		   and the counts in PAD_FIXED_LAYOUTS the plain float entries are straight-line code that
+		   must be called with exactly that many channels, other cases get the generic kernels */
+		const ChannelKernels& GetChannelKernels(HostFormat, ConverterISA, unsigned channels);
+		const ChannelKernels& GetChannelKernels(HostFormat, unsigned channels);
+
+		/* per-ISA kernel tables, indexed by HostFormat */
+		extern const ChannelKernels BaselineChannelKernels[];
+		extern const ChannelKernels AVX2ChannelKernels[];
+		extern const ChannelKernels AVX512ChannelKernels[];
+
+		/* per-ISA fixed layout tables of FixedLayoutFormat, indexed by PAD_FIXED_LAYOUTS */
+		extern const ChannelKernels* const BaselineFixedChannelKernels;
+		extern const ChannelKernels* const AVX2FixedChannelKernels;
+		extern const ChannelKernels* const AVX512FixedChannelKernels;
+	}
+}
@@ -9,6 +9,7 @@
 #include <mach/mach_time.h>
 
 #include <string>
+#include <cstring>
 #include <vector>
 #include <list>
 
@@ -196,6 +197,7 @@ namespace {
 		OSStatus AUHALProc(AudioUnitRenderActionFlags* ioFlags, const AudioTimeStamp *timeStamp, UInt32 Bus, UInt32 frames, AudioBufferList *io) {
             
             if (callbackBus != Bus) return noErr;
+            BeginCycle( );
             
             if (delegateInputBuffer.size( ) < frames * currentConfiguration.GetNumStreamInputs( )) {
                 delegateInputBuffer.resize(frames*currentConfiguration.GetNumStreamInputs( ));
@@ -228,10 +230,15 @@ namespace {
             }
             
             IO ioData{currentConfiguration, delegateInputBuffer.data(), outputBuffer, frames, inputTime, outputTime};
-            if (GetBufferSwitchLock( )) {
-                std::lock_guard<recursive_mutex> lock(*GetBufferSwitchLock( ));
-                BufferSwitch(ioData);
-            } else BufferSwitch(ioData);
+            BufferSwitchGate::Entry entry(GetBufferSwitchGate( ).get( ));
+            if (entry) {
+                DispatchBufferSwitch(ioData);
+                EndCycle( );
+            }
+            else if (io) {
+                /* a control thread holds the gate: the cycle is counted and rendered silent */
+                for (UInt32 i = 0; i < io->mNumberBuffers; ++i) memset(io->mBuffers[i].mData, 0, io->mBuffers[i].mDataByteSize);
+            }
 
             return noErr;
 		}
@@ -260,6 +267,7 @@ namespace {
 		const AudioStreamConfiguration& Open(const AudioStreamConfiguration& c) override {
 
 			currentConfiguration = c;
+			LimitToDeviceBuffers(currentConfiguration);
 
 			AudioComponentDescription desc = {kAudioUnitType_Output, kAudioUnitSubType_HALOutput, kAudioUnitManufacturer_Apple, 0, 0};
 			AudioComponent comp = AudioComponentFindNext(NULL, &desc);
@@ -367,6 +375,7 @@ namespace {
 		}
 
 		void Resume( ) override {
+			ResetXrunDetector( );
 			THROW_ERROR(DeviceStartStreamFailure, AudioOutputUnitStart(AUHAL));
 		}
 
@@ -387,8 +396,6 @@ namespace {
         }
 
 		bool Supports(const AudioStreamConfiguration&) const override { return false; }
-
-		double CPU_Load( ) const override { return 0.0; }
 	};
 
     AudioObjectPropertySelector mSelector;
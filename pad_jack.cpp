@@ -8,8 +8,7 @@
 #include "HostAPI.h"
 
 #include "pad_samples.h"
-#include "pad_samples_sse2.h"
-#include "pad_channels.h"
+#include "pad_converters.h"
 #include "pad_errors.h"
 
 #pragma warning(disable: 4267)
@@ -74,8 +73,6 @@ namespace{
 		virtual const char *GetName() const {return "jack";}
 		virtual const char *GetHostAPI() const {return "jack";}
 
-		double CPU_Load() const { throw "Not implemented"; }
-
 		void Init()
 		{
 			if (currentState < Initialized)
@@ -84,6 +81,7 @@ namespace{
 				client = jack_client_open(name.c_str(),JackNullOption,&status);
 				if (!client) throw PAD::HardError(PAD::DeviceDriverFailure, "Could not initialize JACK Audio Connection Kit");
 				jack_set_process_callback(client,JackDevice::Process,this);
+				jack_set_xrun_callback(client,JackDevice::Xrun,this);
 				jack_on_shutdown(client,JackDevice::Shutdown,this);
 				currentState = Initialized;
 			}
@@ -112,6 +110,25 @@ namespace{
 		JackPortList inputPorts;
 		JackPortList outputPorts;
 		vector<float> clientInputBuffer, clientOutputBuffer;
+		vector<double> clientInputBuffer64, clientOutputBuffer64;
+		vector<int32_t> clientInputBuffer32, clientOutputBuffer32;
+		vector<int16_t> clientInputBuffer16, clientOutputBuffer16;
+		vector<const float*> clientInputChannels;
+		vector<float*> clientOutputChannels;
+		vector<const double*> clientInputChannels64;
+		vector<double*> clientOutputChannels64;
+		StreamMix inputMix, outputMix;
+		static const Converter::HostFormat portFormat = SYSTEM_BIGENDIAN ? Converter::HostFormat::Float32MSB : Converter::HostFormat::Float32LSB;
+
+		/* interleaved streams convert up to channelPackage ports per kernel call; the kernels of
+		   full packages and of the last, partial one are selected for their port counts. The
+		   BlockStream of the virtual devices converts all channels in one call, which is why
+		   JACK keeps its own conversion */
+		static const unsigned channelPackage = 64;
+		const Converter::ChannelKernels *inputConverter = &Converter::GetChannelKernels(portFormat);
+		const Converter::ChannelKernels *outputConverter = &Converter::GetChannelKernels(portFormat);
+		const Converter::ChannelKernels *inputTailConverter = &Converter::GetChannelKernels(portFormat);
+		const Converter::ChannelKernels *outputTailConverter = &Converter::GetChannelKernels(portFormat);
 
 		jack_nframes_t inputLatency, outputLatency;
 
@@ -162,10 +179,38 @@ namespace{
 			currentConf.SetDeviceChannelLimits(inputPorts.size(),outputPorts.size());
 			currentConf.SetSampleRate(jack_get_sample_rate(client));
 			currentConf.SetBufferSize(jack_get_buffer_size(client));
+			LimitToConverters(currentConf);
 			currentState = Prepared;
 
-			clientInputBuffer.resize(inputPorts.size() * currentConf.GetBufferSize());
-			clientOutputBuffer.resize(outputPorts.size() * currentConf.GetBufferSize());
+			auto canon = currentConf.GetCanonicalFormat();
+			bool f64 = canon == CanonicalFormat::Float64;
+			bool planar = currentConf.IsPlanar();
+			clientInputBuffer.resize(canon == CanonicalFormat::Float32 ? inputPorts.size() * currentConf.GetBufferSize() : 0);
+			clientOutputBuffer.resize(canon == CanonicalFormat::Float32 ? outputPorts.size() * currentConf.GetBufferSize() : 0);
+			clientInputBuffer64.resize(f64 ? inputPorts.size() * currentConf.GetBufferSize() : 0);
+			clientOutputBuffer64.resize(f64 ? outputPorts.size() * currentConf.GetBufferSize() : 0);
+			clientInputBuffer32.resize(canon == CanonicalFormat::Int32 ? inputPorts.size() * currentConf.GetBufferSize() : 0);
+			clientOutputBuffer32.resize(canon == CanonicalFormat::Int32 ? outputPorts.size() * currentConf.GetBufferSize() : 0);
+			clientInputBuffer16.resize(canon == CanonicalFormat::Int16 ? inputPorts.size() * currentConf.GetBufferSize() : 0);
+			clientOutputBuffer16.resize(canon == CanonicalFormat::Int16 ? outputPorts.size() * currentConf.GetBufferSize() : 0);
+			clientInputChannels.resize(planar && !f64 ? inputPorts.size() : 0);
+			clientOutputChannels.resize(planar && !f64 ? outputPorts.size() : 0);
+			clientInputChannels64.resize(planar && f64 ? inputPorts.size() : 0);
+			clientOutputChannels64.resize(planar && f64 ? outputPorts.size() : 0);
+
+			/* kernels specialized for the port counts, if there are any; planar streams convert
+			   one port at a time */
+			inputConverter = &Converter::GetChannelKernels(portFormat, planar ? 1 : min<unsigned>(inputPorts.size(),channelPackage));
+			outputConverter = &Converter::GetChannelKernels(portFormat, planar ? 1 : min<unsigned>(outputPorts.size(),channelPackage));
+			inputTailConverter = &Converter::GetChannelKernels(portFormat, planar ? 1 : inputPorts.size() % channelPackage);
+			outputTailConverter = &Converter::GetChannelKernels(portFormat, planar ? 1 : outputPorts.size() % channelPackage);
+
+			/* an input package converts without the ports of the others, while an output package
+			   reads the whole client buffer */
+			vector<unsigned> packageBegins;
+			for(unsigned done(0);done<inputPorts.size();done+=channelPackage) packageBegins.push_back(done);
+			inputMix.Compile(currentConf.GetInputGains(), currentConf.GetInputRoutes(), inputPorts.size(), planar ? PlanarCalls(inputPorts.size()) : packageBegins);
+			outputMix.Compile(currentConf.GetOutputGains(), currentConf.GetOutputRoutes(), outputPorts.size(), planar ? PlanarCalls(outputPorts.size()) : vector<unsigned>());
 
 			if (currentConf.HasSuspendOnStartup() == false) Resume();
 			return currentConf;
@@ -173,6 +218,7 @@ namespace{
 
 		void Run() 
 		{
+			ResetXrunDetector();
 			auto err = jack_activate(client);
 			if (err) throw SoftError(DeviceStartStreamFailure,"Can't activate jack client");
 		}
@@ -208,46 +254,139 @@ namespace{
 			Unwind(Idle);
 		};
 
+		/* planar float streams use the port buffers in place unless they are mixed; everything
+		   else is converted one port at a time to and from the client buffers */
+		void PlanarInputs(jack_nframes_t frames, bool f64)
+		{
+			for(unsigned c(0);c<inputPorts.size();++c)
+			{
+				const void *port = jack_port_get_buffer(inputPorts[c],frames);
+				auto stages = inputMix.Stages(c);
+				if (f64)
+				{
+					double *channel = clientInputBuffer64.data() + c * frames;
+					if (inputMix.Empty()) inputConverter->Interleave64(channel,&port,frames,1,1);
+					else inputConverter->InterleaveFused64(channel,&port,frames,1,1,stages);
+					clientInputChannels64[c] = channel;
+				}
+				else if (inputMix.Empty()) clientInputChannels[c] = (const float*)port;
+				else
+				{
+					float *channel = clientInputBuffer.data() + c * frames;
+					inputConverter->InterleaveFused(channel,&port,frames,1,1,stages);
+					clientInputChannels[c] = channel;
+				}
+			}
+			if (f64) inputMix.MixAcrossCalls(clientInputBuffer64.data(),frames,1,frames);
+			else inputMix.MixAcrossCalls(clientInputBuffer.data(),frames,1,frames);
+		}
+
+		void PlanarOutputBuffers(jack_nframes_t frames, bool f64)
+		{
+			for(unsigned c(0);c<outputPorts.size();++c)
+			{
+				if (f64) clientOutputChannels64[c] = clientOutputBuffer64.data() + c * frames;
+				else if (outputMix.Empty()) clientOutputChannels[c] = (float*)jack_port_get_buffer(outputPorts[c],frames);
+				else clientOutputChannels[c] = clientOutputBuffer.data() + c * frames;
+			}
+		}
+
+		void PlanarOutputs(jack_nframes_t frames, bool f64)
+		{
+			if (f64 == false && outputMix.Empty()) return;
+			if (f64) outputMix.MixAcrossCalls(clientOutputBuffer64.data(),frames,1,frames);
+			else outputMix.MixAcrossCalls(clientOutputBuffer.data(),frames,1,frames);
+			for(unsigned c(0);c<outputPorts.size();++c)
+			{
+				void *port = jack_port_get_buffer(outputPorts[c],frames);
+				auto stages = outputMix.Stages(c);
+				if (f64 == false) outputConverter->DeInterleaveFused(clientOutputChannels[c],&port,frames,1,1,stages);
+				else if (outputMix.Empty()) outputConverter->DeInterleave64(clientOutputChannels64[c],&port,frames,1,1);
+				else outputConverter->DeInterleaveFused64(clientOutputChannels64[c],&port,frames,1,1,stages);
+			}
+		}
+
 		int Process(jack_nframes_t frames)
 		{
+			BeginCycle();
 			jack_nframes_t current_frames;
 			jack_time_t current_usecs, next_usecs;
 			float period_usecs;
 			jack_get_cycle_times(client, &current_frames, &current_usecs, &next_usecs, &period_usecs);
 
-			typedef Converter::HostSample<float,float,-1,1,0,SYSTEM_BIGENDIAN> jack_smp_t;
-			static const unsigned channelPackage = 32;
-			auto todo = inputPorts.size();
-			while(todo>0)
+			auto canon = currentConf.GetCanonicalFormat();
+			bool f32 = canon == CanonicalFormat::Float32;
+			bool f64 = canon == CanonicalFormat::Float64;
+			bool planar = currentConf.IsPlanar();
+			if (planar)
+			{
+				PlanarInputs(frames,f64);
+				PlanarOutputBuffers(frames,f64);
+			}
+			else for(unsigned done(0);done<inputPorts.size();done+=channelPackage)
+			{
+				const void *buffer[channelPackage];
+				unsigned now = min<unsigned>(inputPorts.size()-done,channelPackage);
+				for(unsigned i(0);i<now;++i) buffer[i] = jack_port_get_buffer(inputPorts[done + i],frames);
+				auto& converter(now == channelPackage ? *inputConverter : *inputTailConverter);
+				if (inputMix.Empty()==false)
+				{
+					auto stages = inputMix.Stages(done);
+					if (f64) converter.InterleaveFused64(clientInputBuffer64.data() + done,buffer,frames,now,inputPorts.size(),stages);
+					else converter.InterleaveFused(clientInputBuffer.data() + done,buffer,frames,now,inputPorts.size(),stages);
+				}
+				else if (f64) converter.Interleave64(clientInputBuffer64.data() + done,buffer,frames,now,inputPorts.size());
+				else if (canon == CanonicalFormat::Int32) converter.InterleaveInt32(clientInputBuffer32.data() + done,buffer,frames,now,inputPorts.size());
+				else if (canon == CanonicalFormat::Int16) converter.InterleaveInt16(clientInputBuffer16.data() + done,buffer,frames,now,inputPorts.size());
+				else converter.Interleave(clientInputBuffer.data() + done,buffer,frames,now,inputPorts.size());
+			}
+			if (planar == false)
 			{
-				const jack_smp_t *buffer[channelPackage];
-				unsigned now = min<unsigned>(todo,channelPackage);
-				for(unsigned i(0);i<now;++i) buffer[i] = (const jack_smp_t*)jack_port_get_buffer(inputPorts[i],frames);
-				ChannelConverter<jack_smp_t>::Interleave(clientInputBuffer.data(),(const jack_smp_t**)buffer,frames,inputPorts.size(),inputPorts.size());
-				todo-=now;
+				if (f64) inputMix.MixAcrossCalls(clientInputBuffer64.data(),frames,inputPorts.size(),1);
+				else inputMix.MixAcrossCalls(clientInputBuffer.data(),frames,inputPorts.size(),1);
 			}
 
 			std::uint64_t inputTime = current_usecs - (inputLatency * 1000000 / currentConf.GetSampleRate());
 			std::uint64_t outputTime = current_usecs + (outputLatency * 1000000 / currentConf.GetSampleRate());
 
-			BufferSwitch(PAD::IO { 
+			DispatchBufferSwitch(PAD::IO { 
 				currentConf,
-				clientInputBuffer.data(),
-				clientOutputBuffer.data(),
+				f32 && !planar ? clientInputBuffer.data() : nullptr,
+				f32 && !planar ? clientOutputBuffer.data() : nullptr,
 				frames, 
 				std::chrono::microseconds(inputTime),
-				std::chrono::microseconds(outputTime)
+				std::chrono::microseconds(outputTime),
+				f64 && !planar ? clientInputBuffer64.data() : nullptr,
+				f64 && !planar ? clientOutputBuffer64.data() : nullptr,
+				planar && f32 ? clientInputChannels.data() : nullptr,
+				planar && f32 ? clientOutputChannels.data() : nullptr,
+				planar && f64 ? clientInputChannels64.data() : nullptr,
+				planar && f64 ? clientOutputChannels64.data() : nullptr,
+				clientInputBuffer32.empty() ? nullptr : clientInputBuffer32.data(),
+				clientOutputBuffer32.empty() ? nullptr : clientOutputBuffer32.data(),
+				clientInputBuffer16.empty() ? nullptr : clientInputBuffer16.data(),
+				clientOutputBuffer16.empty() ? nullptr : clientOutputBuffer16.data()
 			});
 
-			todo = outputPorts.size();
-			while(todo>0)
+			if (planar) PlanarOutputs(frames,f64);
+			else for(unsigned done(0);done<outputPorts.size();done+=channelPackage)
 			{
-				jack_smp_t *buffer[channelPackage];
-				unsigned now = min<unsigned>(todo,channelPackage);
-				for(unsigned i(0);i<now;++i) buffer[i] = (jack_smp_t*)jack_port_get_buffer(outputPorts[i],frames);
-				ChannelConverter<jack_smp_t>::DeInterleave(clientOutputBuffer.data(),(jack_smp_t**)buffer,frames,outputPorts.size(),outputPorts.size());
-				todo-=now;
+				void *buffer[channelPackage];
+				unsigned now = min<unsigned>(outputPorts.size()-done,channelPackage);
+				for(unsigned i(0);i<now;++i) buffer[i] = jack_port_get_buffer(outputPorts[done + i],frames);
+				auto& converter(now == channelPackage ? *outputConverter : *outputTailConverter);
+				if (outputMix.Empty()==false)
+				{
+					auto stages = outputMix.Stages(done);
+					if (f64) converter.DeInterleaveFused64(clientOutputBuffer64.data() + done,buffer,frames,now,outputPorts.size(),stages);
+					else converter.DeInterleaveFused(clientOutputBuffer.data() + done,buffer,frames,now,outputPorts.size(),stages);
+				}
+				else if (f64) converter.DeInterleave64(clientOutputBuffer64.data() + done,buffer,frames,now,outputPorts.size());
+				else if (canon == CanonicalFormat::Int32) converter.DeInterleaveInt32(clientOutputBuffer32.data() + done,buffer,frames,now,outputPorts.size());
+				else if (canon == CanonicalFormat::Int16) converter.DeInterleaveInt16(clientOutputBuffer16.data() + done,buffer,frames,now,outputPorts.size());
+				else converter.DeInterleave(clientOutputBuffer.data() + done,buffer,frames,now,outputPorts.size());
 			}
+			EndCycle();
 			return 0;
 		}
 
@@ -263,6 +402,15 @@ namespace{
 			return GetTime;
 		}
 
+		/* JACK measures how late the cycle was */
+		static int Xrun(void *arg)
+		{
+			auto dev = (JackDevice*)arg;
+			double delayed = jack_get_xrun_delayed_usecs(dev->client);
+			dev->ReportXrun(XrunStage::Device,uint64_t(delayed * dev->currentConf.GetSampleRate() * 1e-6 + 0.5));
+			return 0;
+		}
+
 		static int Process(jack_nframes_t frames, void *arg)
 		{
 			JackDevice *jdev = (JackDevice*)arg;
@@ -0,0 +1,274 @@
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "pad.h"
+#include "pad_virtual.h"
+#include "pad_errors.h"
+
+namespace {
+	using namespace PAD;
+	using namespace std;
+
+	struct LoopbackPairSpec {
+		string first, second;
+		unsigned numChannels, latency;
+		double sampleRate;
+		unsigned bufferSize;
+		LoopbackClock clock;
+	};
+
+	static mutex& SpecMutex( ) {
+		static mutex m;
+		return m;
+	}
+
+	static vector<LoopbackPairSpec>& Specs( ) {
+		static vector<LoopbackPairSpec> specs{ { "loopback a", "loopback b", 2, 64, 48000.0, 64, LoopbackClock::RealTime } };
+		return specs;
+	}
+
+	/**
+	 * The clock and the two cables of a pair. A cable is a ring of latency plus one buffer
+	 * of frames per channel, written a latency ahead of where the other end reads it. With
+	 * at least a buffer of latency the two ends touch different frames of a cable within a
+	 * tick, and the clock waits for both ends between ticks
+	 ***/
+	class LoopbackLink {
+		const unsigned numChannels, bufferSize, latency, ringFrames;
+		const double sampleRate;
+		const LoopbackClock mode;
+		vector<float> cables[2];
+
+		mutable mutex lock;
+		condition_variable changed;
+		thread clock;
+		/* a clock runs until the generation changes, when the last end leaves it or the
+		   first end starts a new one */
+		uint64_t generation = 0;
+		unsigned attached = 0, pending = 0;
+		int64_t tick = -1;
+		chrono::steady_clock::time_point start;
+
+		void Clock(uint64_t own) {
+			bool realTime = mode == LoopbackClock::RealTime;
+			if (realTime) RequestRealtimeScheduling( );
+			double secondsPerBuffer = bufferSize / sampleRate;
+
+			unique_lock<mutex> hold(lock);
+			PeriodicDeadline deadline(secondsPerBuffer);
+			start = deadline.GetStart( );
+			auto stopped = [&]( ) { return generation != own; };
+
+			for (uint64_t next(0);; ++next) {
+				if (realTime) {
+					hold.unlock( );
+					SleepUntil(deadline(next + 1));
+					hold.lock( );
+					deadline.SkipLost(next);
+				} else changed.wait(hold, [&]( ) { return attached == 3 || stopped( ); });
+				if (stopped( )) break;
+
+				tick = int64_t(next);
+				pending = attached;
+				changed.notify_all( );
+				changed.wait(hold, [&]( ) { return pending == 0 || stopped( ); });
+			}
+		}
+
+		/* the frames of a buffer in a ring, in one or two spans */
+		template <typename FN> void Spans(uint64_t frame, FN span) const {
+			unsigned at = unsigned(frame % ringFrames), first = min(bufferSize, ringFrames - at);
+			span(at, 0u, first);
+			if (first < bufferSize) span(0u, first, bufferSize - first);
+		}
+
+	public:
+		LoopbackLink(const LoopbackPairSpec& s)
+			:numChannels(s.numChannels), bufferSize(s.bufferSize), latency(max(s.latency, s.bufferSize)), ringFrames(latency + s.bufferSize), sampleRate(s.sampleRate), mode(s.clock) {
+			for (auto& c : cables) c.assign(numChannels * ringFrames, 0.f);
+		}
+
+		~LoopbackLink( ) {
+			if (clock.joinable( )) clock.join( );
+		}
+
+		bool IsRealTime( ) const { return mode == LoopbackClock::RealTime; }
+		unsigned GetLatency( ) const { return latency; }
+
+		chrono::microseconds Time(uint64_t frame) const {
+			return chrono::microseconds(int64_t(frame * 1e6 / sampleRate + 0.5));
+		}
+
+		chrono::microseconds Now( ) const {
+			lock_guard<mutex> hold(lock);
+			if (tick < 0) return chrono::microseconds(0);
+			if (IsRealTime( ) && attached) return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now( ) - start);
+			return Time(uint64_t(tick) * bufferSize);
+		}
+
+		/* an end joins the clock at the next tick; the first one starts it from zero */
+		int64_t Attach(unsigned end) {
+			thread previous;
+			unique_lock<mutex> hold(lock);
+			if (attached == 0) {
+				for (auto& c : cables) fill(c.begin( ), c.end( ), 0.f);
+				tick = -1;
+				previous = move(clock);
+				auto own = ++generation;
+				clock = thread([this, own]( ) { Clock(own); });
+			}
+			attached |= 1u << end;
+			changed.notify_all( );
+			auto last = tick;
+			hold.unlock( );
+
+			/* the clock the last end left may still be on its way out */
+			if (previous.joinable( )) previous.join( );
+			return last;
+		}
+
+		void Detach(unsigned end) {
+			lock_guard<mutex> hold(lock);
+			attached &= ~(1u << end);
+			pending &= ~(1u << end);
+			if (attached == 0) ++generation;
+			changed.notify_all( );
+		}
+
+		/* waits for a tick after the last one, or for running to turn false */
+		template <typename PRED> bool Await(int64_t& last, PRED running) {
+			unique_lock<mutex> hold(lock);
+			changed.wait(hold, [&]( ) { return tick > last || running( ) == false; });
+			if (running( ) == false) return false;
+			last = tick;
+			return true;
+		}
+
+		void Done(unsigned end) {
+			lock_guard<mutex> hold(lock);
+			pending &= ~(1u << end);
+			if (pending == 0) changed.notify_all( );
+		}
+
+		void Wake( ) {
+			lock_guard<mutex> hold(lock);
+			changed.notify_all( );
+		}
+
+		/* reads the buffer of a tick from the cable into an end, leaving silence behind */
+		void Receive(unsigned end, int64_t at, const vector<unsigned>& channels, float *blocks) {
+			auto& cable = cables[end ^ 1];
+			Spans(uint64_t(at) * bufferSize, [&](unsigned pos, unsigned offset, unsigned frames) {
+				for (unsigned c(0); c < channels.size( ); ++c) {
+					auto src = cable.data( ) + channels[c] * ringFrames + pos;
+					copy(src, src + frames, blocks + c * bufferSize + offset);
+				}
+				for (unsigned c(0); c < numChannels; ++c) fill_n(cable.data( ) + c * ringFrames + pos, frames, 0.f);
+			});
+		}
+
+		void Send(unsigned end, int64_t at, const vector<unsigned>& channels, const float *blocks) {
+			auto& cable = cables[end];
+			Spans(uint64_t(at) * bufferSize + latency, [&](unsigned pos, unsigned offset, unsigned frames) {
+				for (unsigned c(0); c < channels.size( ); ++c) {
+					auto src = blocks + c * bufferSize + offset;
+					copy(src, src + frames, cable.data( ) + channels[c] * ringFrames + pos);
+				}
+			});
+		}
+	};
+
+	class LoopbackDevice : public VirtualDevice {
+		LoopbackLink& link;
+		unsigned end;
+		/* the cable channel of each stream channel */
+		vector<unsigned> inputChannels, outputChannels;
+
+		void Prepare( ) {
+			inputChannels.clear( );
+			outputChannels.clear( );
+			for (unsigned c(0); c < numInputs; ++c) if (currentConfiguration.IsInputEnabled(c)) inputChannels.push_back(c);
+			for (unsigned c(0); c < numOutputs; ++c) if (currentConfiguration.IsOutputEnabled(c)) outputChannels.push_back(c);
+		}
+
+		void Run( ) {
+			if (link.IsRealTime( )) RequestRealtimeScheduling( );
+			int64_t tick = link.Attach(end);
+			while (link.Await(tick, [this]( ) { return IsRunning( ); })) {
+				auto frame = uint64_t(tick) * bufferSize;
+				link.Receive(end, tick, inputChannels, inputBuffer.data( ));
+				/* a buffer turned away by the gate leaves silence on the cable */
+				if (Cycle(bufferSize, link.Time(frame), link.Time(frame + link.GetLatency( )))) {
+					link.Send(end, tick, outputChannels, outputBuffer.data( ));
+				}
+				link.Done(end);
+			}
+			link.Detach(end);
+		}
+
+		void Interrupt( ) {
+			link.Wake( );
+		}
+
+	public:
+		LoopbackDevice(LoopbackLink& l, unsigned e, const string& name, const LoopbackPairSpec& s)
+			:VirtualDevice(name, "loopback", s.numChannels, s.numChannels, s.sampleRate, s.bufferSize), link(l), end(e) { }
+
+		~LoopbackDevice( ) {
+			Shutdown( );
+		}
+
+		const AudioStreamConfiguration& Open(const AudioStreamConfiguration& conf) {
+			if (conf.GetSampleRate( ) != defaultRate) throw SoftError(DeviceOpenStreamFailure, GetName( ) + string(" runs at the sample rate of its pair"));
+			return VirtualDevice::Open(conf);
+		}
+
+		/* the clock of the pair has no device to read without a context */
+		GetDeviceTime GetDeviceTimeCallback( ) const { return nullptr; }
+		chrono::microseconds DeviceTimeNow( ) const { return link.Now( ); }
+	};
+
+	/* the link outlives the devices, whose streams leave it before it stops the clock */
+	struct LoopbackPair {
+		LoopbackLink link;
+		LoopbackDevice first, second;
+		LoopbackPair(const LoopbackPairSpec& s) :link(s), first(link, 0, s.first, s), second(link, 1, s.second, s) { }
+	};
+
+	class LoopbackPublisher : public HostAPIPublisher {
+		list<LoopbackPair> pairs;
+	public:
+		const char *GetName( ) const { return "loopback"; }
+
+		void Publish(Session& padInstance, DeviceErrorDelegate&) {
+			lock_guard<mutex> lock(SpecMutex( ));
+			for (auto& spec : Specs( )) {
+				pairs.emplace_back(spec);
+				padInstance.Register(&pairs.back( ).first);
+				padInstance.Register(&pairs.back( ).second);
+			}
+		}
+
+		void Cleanup(Session&) {
+			pairs.clear( );
+		}
+	} publisher;
+}
+
+namespace PAD {
+	void AddLoopbackPair(const char *first, const char *second, unsigned numChannels, unsigned latencyFrames, double sampleRate, unsigned bufferSize, LoopbackClock clock) {
+		if (sampleRate <= 0 || bufferSize == 0) throw SoftError(DeviceInitializationFailure, "loopback pair needs a sample rate and a buffer size");
+		lock_guard<mutex> lock(SpecMutex( ));
+		Specs( ).push_back(LoopbackPairSpec{ first, second, numChannels, latencyFrames, sampleRate, bufferSize, clock });
+	}
+
+	IHostAPI* LinkLoopback( ) {
+		return &publisher;
+	}
+}
@@ -0,0 +1,118 @@
+#include <list>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+#include "pad.h"
+#include "pad_virtual.h"
+#include "pad_errors.h"
+
+namespace {
+	using namespace PAD;
+	using namespace std;
+
+	struct NullDeviceSpec {
+		string name;
+		unsigned numInputs, numOutputs;
+		double sampleRate;
+		unsigned bufferSize;
+		NullSignal input;
+	};
+
+	static mutex& SpecMutex( ) {
+		static mutex m;
+		return m;
+	}
+
+	static vector<NullDeviceSpec>& Specs( ) {
+		static vector<NullDeviceSpec> specs{ { "null", 2, 2, 48000.0, 64, NullSignal::Silence } };
+		return specs;
+	}
+
+	class NullDevice : public VirtualDevice {
+		NullSignal signal;
+		double phase = 0;
+
+		/* the device side of a cycle, outside of its timing */
+		void Generate(unsigned frames) {
+			if (signal != NullSignal::Sine || inputBlocks.empty( )) return;
+			const double pi = 3.14159265358979323846;
+			double step = 2 * pi * 997.0 / currentConfiguration.GetSampleRate( );
+			for (unsigned i(0); i < frames; ++i) {
+				inputBuffer[i] = float(0.5 * sin(phase));
+				phase += step;
+			}
+			phase = fmod(phase, 2 * pi);
+			for (unsigned c(1); c < inputBlocks.size( ); ++c) copy(inputBuffer.begin( ), inputBuffer.begin( ) + frames, inputBuffer.begin( ) + c * frames);
+		}
+
+		void Prepare( ) {
+			phase = 0;
+		}
+
+		void Run( ) {
+			RequestRealtimeScheduling( );
+			double secondsPerBuffer = bufferSize / currentConfiguration.GetSampleRate( );
+			auto period = chrono::duration_cast<chrono::microseconds>(chrono::duration<double>(secondsPerBuffer));
+			PeriodicDeadline deadline(secondsPerBuffer);
+
+			for (uint64_t cycle(1); IsRunning( ); ++cycle) {
+				SleepUntil(deadline(cycle));
+				if (IsRunning( ) == false) break;
+
+				/* the input buffer completes at the deadline and the output plays a period later */
+				Generate(bufferSize);
+				auto time = chrono::duration_cast<chrono::microseconds>(deadline(cycle).time_since_epoch( ));
+				Cycle(bufferSize, time - period, time + period);
+				deadline.SkipLost(cycle);
+			}
+		}
+
+	public:
+		NullDevice(const NullDeviceSpec& s) :VirtualDevice(s.name, "null", s.numInputs, s.numOutputs, s.sampleRate, s.bufferSize), signal(s.input) { }
+
+		~NullDevice( ) {
+			Shutdown( );
+		}
+
+		static chrono::microseconds GetTime( ) {
+			return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now( ).time_since_epoch( ));
+		}
+
+		GetDeviceTime GetDeviceTimeCallback( ) const { return GetTime; }
+		chrono::microseconds DeviceTimeNow( ) const { return GetTime( ); }
+	};
+
+	class NullPublisher : public HostAPIPublisher {
+		list<NullDevice> devices;
+	public:
+		const char *GetName( ) const { return "null"; }
+
+		void Publish(Session& padInstance, DeviceErrorDelegate&) {
+			lock_guard<mutex> lock(SpecMutex( ));
+			for (auto& spec : Specs( )) {
+				devices.emplace_back(spec);
+				padInstance.Register(&devices.back( ));
+			}
+		}
+
+		void Cleanup(Session&) {
+			devices.clear( );
+		}
+	} publisher;
+}
+
+namespace PAD {
+	void AddNullDevice(const char *name, unsigned numInputs, unsigned numOutputs, double sampleRate, unsigned bufferSize, NullSignal input) {
+		if (sampleRate <= 0 || bufferSize == 0) throw SoftError(DeviceInitializationFailure, "null device needs a sample rate and a buffer size");
+		lock_guard<mutex> lock(SpecMutex( ));
+		Specs( ).push_back(NullDeviceSpec{ name, numInputs, numOutputs, sampleRate, bufferSize, input });
+	}
+
+	IHostAPI* LinkNull( ) {
+		return &publisher;
+	}
+}
@@ -0,0 +1,344 @@
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "pad.h"
+#include "pad_virtual.h"
+#include "pad_errors.h"
+
+namespace {
+	using namespace PAD;
+	using namespace std;
+
+	struct OfflineDeviceSpec {
+		string name;
+		unsigned numInputs, numOutputs;
+		double sampleRate;
+		unsigned bufferSize;
+	};
+
+	static mutex& SpecMutex( ) {
+		static mutex m;
+		return m;
+	}
+
+	static vector<OfflineDeviceSpec>& Specs( ) {
+		static vector<OfflineDeviceSpec> specs{ { "offline", 2, 2, 48000.0, 512 } };
+		return specs;
+	}
+
+	class OfflineDevice : public VirtualDevice {
+		OfflineSource source;
+		OfflineSink sink;
+		uint64_t length = 0;
+		vector<float*> inputChannels;
+		vector<const float*> outputChannels;
+		atomic<uint64_t> position;
+
+		void Prepare( ) {
+			PlanarChannels(inputChannels, inputBuffer.data( ), currentConfiguration.GetNumStreamInputs( ), bufferSize);
+			PlanarChannels(outputChannels, outputBuffer.data( ), currentConfiguration.GetNumStreamOutputs( ), bufferSize);
+			position.store(0);
+		}
+
+		/* a stream suspended before the render runs out resumes where it stopped */
+		void Run( ) {
+			double rate = currentConfiguration.GetSampleRate( );
+			unsigned ins = unsigned(inputChannels.size( )), outs = unsigned(outputChannels.size( ));
+			for (bool last = false; IsRunning( ) && last == false;) {
+				uint64_t frame = position.load( );
+				unsigned frames = bufferSize;
+				if (length) frames = unsigned(min<uint64_t>(frames, length - min(frame, length)));
+				if (source && frames) {
+					unsigned filled = min(frames, source(inputChannels.data( ), ins, frames));
+					last = filled < frames;
+					frames = filled;
+				}
+				if (frames == 0) break;
+
+				/* nothing is lost offline: a buffer turned away by the gate waits for it */
+				auto time = chrono::microseconds(int64_t(frame * 1e6 / rate + 0.5));
+				bool done;
+				while ((done = Cycle(frames, time, time)) == false && IsRunning( )) this_thread::yield( );
+				if (done == false) break;
+
+				if (sink) sink(outputChannels.data( ), outs, frames);
+				position.store(frame + frames);
+			}
+			if (sink) sink(outputChannels.data( ), outs, 0);
+			EndStream( );
+		}
+
+	public:
+		OfflineDevice(const OfflineDeviceSpec& s) :VirtualDevice(s.name, "offline", s.numInputs, s.numOutputs, s.sampleRate, s.bufferSize), position(0) { }
+
+		~OfflineDevice( ) {
+			Shutdown( );
+		}
+
+		void SetRender(OfflineSource newSource, OfflineSink newSink, uint64_t numFrames) {
+			if (IsRunning( )) throw SoftError(DeviceOpenStreamFailure, GetName( ) + string(" is streaming"));
+			source = move(newSource);
+			sink = move(newSink);
+			length = numFrames;
+		}
+
+		/* the sample clock has no device to read without a context */
+		GetDeviceTime GetDeviceTimeCallback( ) const { return nullptr; }
+
+		chrono::microseconds DeviceTimeNow( ) const {
+			return chrono::microseconds(int64_t(position.load( ) * 1e6 / currentConfiguration.GetSampleRate( ) + 0.5));
+		}
+	};
+
+	class OfflinePublisher : public HostAPIPublisher {
+		list<OfflineDevice> devices;
+	public:
+		const char *GetName( ) const { return "offline"; }
+
+		void Publish(Session& padInstance, DeviceErrorDelegate&) {
+			lock_guard<mutex> lock(SpecMutex( ));
+			for (auto& spec : Specs( )) {
+				devices.emplace_back(spec);
+				padInstance.Register(&devices.back( ));
+			}
+		}
+
+		void Cleanup(Session&) {
+			devices.clear( );
+		}
+
+		OfflineDevice* Find(AudioDevice& dev) {
+			for (auto& d : devices) if (&d == &dev) return &d;
+			return nullptr;
+		}
+	} publisher;
+
+	/* little endian fields of the wave format */
+	static uint32_t Get(const uint8_t *bytes, unsigned count) {
+		uint32_t v = 0;
+		for (unsigned i(0); i < count; ++i) v |= uint32_t(bytes[i]) << (8 * i);
+		return v;
+	}
+
+	static void Put(uint8_t *bytes, uint32_t v, unsigned count) {
+		for (unsigned i(0); i < count; ++i) bytes[i] = uint8_t(v >> (8 * i));
+	}
+
+	struct FileCloser {
+		void operator()(FILE *f) const { fclose(f); }
+	};
+
+	class WaveReader {
+		unique_ptr<FILE, FileCloser> file;
+		unsigned format, numChannels, bytesPerSample;
+		uint64_t remaining;
+		vector<uint8_t> bytes;
+
+		float Sample(const uint8_t *s) const {
+			if (format == 3 && bytesPerSample == 4) {
+				uint32_t u = Get(s, 4);
+				float f;
+				memcpy(&f, &u, 4);
+				return f;
+			}
+			if (format == 3) {
+				uint64_t u = Get(s, 4) | (uint64_t(Get(s + 4, 4)) << 32);
+				double d;
+				memcpy(&d, &u, 8);
+				return float(d);
+			}
+			/* integers are left justified to 32 bits */
+			int32_t i = int32_t(Get(s, bytesPerSample) << (32 - 8 * bytesPerSample));
+			return float(i * (1.0 / 2147483648.0));
+		}
+
+	public:
+		WaveReader(const char *path) :file(fopen(path, "rb")) {
+			auto fail = [path](const char *why) { return SoftError(DeviceInitializationFailure, string(path) + ": " + why); };
+			if (!file) throw fail("can not open");
+
+			uint8_t header[40];
+			if (fread(header, 1, 12, file.get( )) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) throw fail("not a wave file");
+
+			format = 0;
+			for (;;) {
+				if (fread(header, 1, 8, file.get( )) != 8) throw fail("no data chunk");
+				uint32_t size = Get(header + 4, 4);
+				if (memcmp(header, "data", 4) == 0) {
+					remaining = size;
+					break;
+				}
+				long skip = long(size + (size & 1));
+				if (memcmp(header, "fmt ", 4) == 0 && size >= 16) {
+					unsigned read = min(size, 40u);
+					if (fread(header, 1, read, file.get( )) != read) throw fail("truncated format");
+					skip -= long(read);
+					format = Get(header, 2);
+					numChannels = Get(header + 2, 2);
+					bytesPerSample = Get(header + 14, 2) / 8;
+					/* the extensible format names the actual one in its subformat */
+					if (format == 0xfffe && read >= 26) format = Get(header + 24, 2);
+				}
+				if (fseek(file.get( ), skip, SEEK_CUR)) throw fail("truncated chunk");
+			}
+
+			bool pcm = format == 1 && bytesPerSample >= 2 && bytesPerSample <= 4;
+			bool ieee = format == 3 && (bytesPerSample == 4 || bytesPerSample == 8);
+			if ((pcm || ieee) == false || numChannels == 0) throw fail("unsupported sample format");
+		}
+
+		unsigned Read(float* const* channels, unsigned count, unsigned frames) {
+			unsigned frameBytes = numChannels * bytesPerSample;
+			frames = unsigned(min<uint64_t>(frames, remaining / frameBytes));
+			bytes.resize(size_t(frames) * frameBytes);
+			frames = unsigned(fread(bytes.data( ), frameBytes, frames, file.get( )));
+			remaining -= uint64_t(frames) * frameBytes;
+
+			for (unsigned c(0); c < count; ++c) {
+				for (unsigned i(0); i < frames; ++i) {
+					channels[c][i] = c < numChannels ? Sample(bytes.data( ) + i * frameBytes + c * bytesPerSample) : 0.f;
+				}
+			}
+			return frames;
+		}
+	};
+
+	/* 32 bit float; as a non-PCM format it has the extended fmt chunk and a fact chunk holding
+	   the frame count. The sizes and the count are brought up to date whenever a render ends */
+	class WaveWriter {
+		static const unsigned headerBytes = 58;
+		unique_ptr<FILE, FileCloser> file;
+		unsigned numChannels;
+		uint32_t dataBytes = 0;
+		vector<uint8_t> bytes;
+
+		void Patch(long offset, uint32_t v) {
+			uint8_t field[4];
+			Put(field, v, 4);
+			fseek(file.get( ), offset, SEEK_SET);
+			fwrite(field, 1, 4, file.get( ));
+		}
+
+		void Finish( ) {
+			Patch(4, headerBytes - 8 + dataBytes);
+			Patch(46, dataBytes / (numChannels * 4));
+			Patch(54, dataBytes);
+			fseek(file.get( ), 0, SEEK_END);
+			fflush(file.get( ));
+		}
+
+	public:
+		WaveWriter(const char *path, unsigned channels, double sampleRate) :file(fopen(path, "wb")), numChannels(channels) {
+			if (!file) throw SoftError(DeviceInitializationFailure, string(path) + ": can not create");
+			uint8_t header[headerBytes];
+			memcpy(header, "RIFF", 4);
+			Put(header + 4, headerBytes - 8, 4);
+			memcpy(header + 8, "WAVEfmt ", 8);
+			Put(header + 16, 18, 4);
+			Put(header + 20, 3, 2);
+			Put(header + 22, numChannels, 2);
+			Put(header + 24, uint32_t(sampleRate), 4);
+			Put(header + 28, uint32_t(sampleRate) * numChannels * 4, 4);
+			Put(header + 32, numChannels * 4, 2);
+			Put(header + 34, 32, 2);
+			Put(header + 36, 0, 2);
+			memcpy(header + 38, "fact", 4);
+			Put(header + 42, 4, 4);
+			Put(header + 46, 0, 4);
+			memcpy(header + 50, "data", 4);
+			Put(header + 54, 0, 4);
+			fwrite(header, 1, headerBytes, file.get( ));
+		}
+
+		~WaveWriter( ) {
+			Finish( );
+		}
+
+		void Write(const float* const* channels, unsigned count, unsigned frames) {
+			if (frames == 0) {
+				Finish( );
+				return;
+			}
+			bytes.resize(size_t(frames) * numChannels * 4);
+			uint8_t *out = bytes.data( );
+			for (unsigned i(0); i < frames; ++i) {
+				for (unsigned c(0); c < numChannels; ++c, out += 4) {
+					float f = c < count ? channels[c][i] : 0.f;
+					uint32_t u;
+					memcpy(&u, &f, 4);
+					Put(out, u, 4);
+				}
+			}
+			dataBytes += uint32_t(fwrite(bytes.data( ), 1, bytes.size( ), file.get( )));
+		}
+	};
+}
+
+namespace PAD {
+	void AddOfflineDevice(const char *name, unsigned numInputs, unsigned numOutputs, double sampleRate, unsigned bufferSize) {
+		if (sampleRate <= 0 || bufferSize == 0) throw SoftError(DeviceInitializationFailure, "offline device needs a sample rate and a buffer size");
+		lock_guard<mutex> lock(SpecMutex( ));
+		Specs( ).push_back(OfflineDeviceSpec{ name, numInputs, numOutputs, sampleRate, bufferSize });
+	}
+
+	void SetOfflineRender(AudioDevice& dev, OfflineSource source, OfflineSink sink, uint64_t numFrames) {
+		auto offline = publisher.Find(dev);
+		if (offline == nullptr) throw SoftError(UnknownApiIdentifier, dev.GetName( ) + string(" is not an offline device"));
+		offline->SetRender(move(source), move(sink), numFrames);
+	}
+
+	OfflineSource MemorySource(vector<float> interleaved, unsigned numChannels) {
+		struct State {
+			vector<float> samples;
+			unsigned numChannels;
+			size_t frame;
+		};
+		auto state = make_shared<State>(State{ move(interleaved), numChannels, 0 });
+		return [state](float* const* channels, unsigned count, unsigned frames) {
+			auto available = state->numChannels ? state->samples.size( ) / state->numChannels - state->frame : 0;
+			frames = unsigned(min<size_t>(frames, available));
+			const float *in = state->samples.data( ) + state->frame * state->numChannels;
+			for (unsigned c(0); c < count; ++c) {
+				for (unsigned i(0); i < frames; ++i) channels[c][i] = c < state->numChannels ? in[i * state->numChannels + c] : 0.f;
+			}
+			state->frame += frames;
+			return frames;
+		};
+	}
+
+	OfflineSink MemorySink(vector<float>& interleaved, unsigned numChannels) {
+		auto target = &interleaved;
+		return [target, numChannels](const float* const* channels, unsigned count, unsigned frames) {
+			auto out = target->size( );
+			target->resize(out + size_t(frames) * numChannels);
+			for (unsigned i(0); i < frames; ++i) {
+				for (unsigned c(0); c < numChannels; ++c) (*target)[out++] = c < count ? channels[c][i] : 0.f;
+			}
+		};
+	}
+
+	OfflineSource WaveFileSource(const char *path) {
+		auto reader = make_shared<WaveReader>(path);
+		return [reader](float* const* channels, unsigned count, unsigned frames) {
+			return reader->Read(channels, count, frames);
+		};
+	}
+
+	OfflineSink WaveFileSink(const char *path, unsigned numChannels, double sampleRate) {
+		auto writer = make_shared<WaveWriter>(path, numChannels, sampleRate);
+		return [writer](const float* const* channels, unsigned count, unsigned frames) {
+			writer->Write(channels, count, frames);
+		};
+	}
+
+	IHostAPI* LinkOffline( ) {
+		return &publisher;
+	}
+}
@@ -3,9 +3,11 @@
 #include <cstdint>
 #include <cstring>
 #include <cmath>
+#include <math.h>
 #include <cassert>
 #include <numeric>
 #include <algorithm>
+#include <type_traits>
 
 #ifdef HAS_BIG_ENDIAN
 #define SYSTEM_BIGENDIAN true
@@ -13,62 +15,72 @@
 #define SYSTEM_BIGENDIAN false
 #endif
 
+#if defined(_MSC_VER)
+#define PAD_FORCEINLINE __forceinline
+#else
+#define PAD_FORCEINLINE inline __attribute__((always_inline))
+#endif
+
+/* the converters are compiled once per instruction set; the inline namespace
+   keeps the instantiations of each ISA translation unit apart at link time */
+#ifndef PAD_CONVERTER_ISA
+#define PAD_CONVERTER_ISA baseline
+#endif
+
 namespace PAD{
 	namespace Converter{
+	inline namespace PAD_CONVERTER_ISA{
 		using namespace std;
 
+		/* clipping, rounding and swapping of the converters. The std templates would be
+		   instantiated out of line in every ISA translation unit under one name, and the
+		   linker could keep a copy compiled for an instruction set the host lacks */
+		template <typename T> static inline T Min(T a, T b) { return b < a ? b : a; }
+		template <typename T> static inline T Max(T a, T b) { return a < b ? b : a; }
+		template <typename T> static inline void Exchange(T& a, T& b) { T t = a; a = b; b = t; }
+
+#if defined(_MSC_VER)
+		static inline float Round(float x) { return nearbyintf(x); }
+		static inline double Round(double x) { return ::nearbyint(x); }
+#else
+		static inline float Round(float x) { return __builtin_nearbyintf(x); }
+		static inline double Round(double x) { return __builtin_nearbyint(x); }
+#endif
+
+		/* packed 3-byte sample in host byte order; converts to and from sign-extended int32 */
 		class int24_t{
 			uint8_t bytes[3];
-			operator int32_t()
+		public:
+			int24_t() = default;
+
+			int24_t(int32_t v)
 			{
-				union{
-					uint8_t bytes[4];
-					int32_t dword;
-				} tmp;
-				tmp.dword = 0x01020304;
-				if (tmp.bytes[0] == 1)
+				if (SYSTEM_BIGENDIAN)
 				{
-					tmp.bytes[0]=bytes[0];
-					tmp.bytes[1]=bytes[1];
-					tmp.bytes[2]=bytes[2];
-					tmp.bytes[3]=0;
+					bytes[0] = uint8_t(v >> 16);
+					bytes[1] = uint8_t(v >> 8);
+					bytes[2] = uint8_t(v);
 				}
-				else if (tmp.bytes[0] == 4)
+				else
 				{
-					tmp.bytes[0]=0;
-					tmp.bytes[1]=bytes[0];
-					tmp.bytes[2]=bytes[1];
-					tmp.bytes[3]=bytes[2];
+					bytes[0] = uint8_t(v);
+					bytes[1] = uint8_t(v >> 8);
+					bytes[2] = uint8_t(v >> 16);
 				}
-				else assert(0 && "Endian check failed");
-				return tmp.dword;
 			}
 
-			int24_t(int32_t v)
+			operator int32_t() const
 			{
-				union{
-					uint8_t bytes[4];
-					int32_t dword;
-				} tmp;
-				tmp.dword=0x01020304;
-				if (tmp.bytes[0] == 1)
-				{
-					tmp.dword = v;
-					bytes[0] = tmp.bytes[1];
-					bytes[1] = tmp.bytes[2];
-					bytes[2] = tmp.bytes[3];
-				}
-				else if (tmp.bytes[0] == 4)
-				{
-					tmp.dword = v;
-					bytes[0] = tmp.bytes[0];
-					bytes[1] = tmp.bytes[1];
-					bytes[2] = tmp.bytes[2];
-				}
-				else assert(0 && "Endian check failed");
+				uint32_t u = SYSTEM_BIGENDIAN ?
+					(uint32_t(bytes[0]) << 16) | (uint32_t(bytes[1]) << 8) | bytes[2] :
+					(uint32_t(bytes[2]) << 16) | (uint32_t(bytes[1]) << 8) | bytes[0];
+				/* sign extend from bit 23 */
+				return int32_t(u << 8) >> 8;
 			}
 		};
 
+		static_assert(sizeof(int24_t) == 3, "int24_t must be packed");
+
 		template <typename S, int N> struct SampleVector{
 			S data[N];
 			SampleVector(){}
@@ -87,19 +99,30 @@ namespace PAD{
 			template <bool ALIGNED> void Write(S* dest) { std::memcpy(dest,data,sizeof(S)*N); }
 			template <bool ALIGNED> void Load(const S* from) { std::memcpy(data,from,sizeof(S)*N); }
 
+			/* converting access, used for double precision canonical buffers */
+			template <bool ALIGNED, typename T> void Write(T* dest) { for(unsigned i(0);i<N;++i) dest[i] = T(data[i]); }
+			template <bool ALIGNED, typename T> void Load(const T* from) { for(unsigned i(0);i<N;++i) data[i] = S(from[i]); }
+
 			SampleVector<S,N> operator*(SampleVector<S,N> b) const
 			{
 				for(unsigned i(0);i<N;++i) b[i]*=data[i];
 				return b;
 			}
+
+			SampleVector<S,N> operator+(SampleVector<S,N> b) const
+			{
+				for(unsigned i(0);i<N;++i) b[i]+=data[i];
+				return b;
+			}
 		};
 
-		/* generic clip & round */
+		/* generic clip & round to nearest, ties to even like cvtps2dq in the default rounding mode.
+		   The bound is the first operand of min, so that NaN clips to it like minps does */
 		template <typename HOST, typename CANON> struct SampleToHost {
 			static void RoundAndClip(HOST& dst, CANON src, CANON high_bound, CANON low_bound)
 			{
-				src = max(min(CANON(src + 0.5),high_bound),low_bound);
-				dst = static_cast<HOST>(src);
+				src = Max(Min(high_bound,src),low_bound);
+				dst = static_cast<HOST>(Round(src));
 			}
 		};
 
@@ -107,14 +130,14 @@ namespace PAD{
 		template <> struct SampleToHost<float,float> {
 			static void RoundAndClip(float& dst, float src, float hi, float lo)
 			{
-				dst = max(min(src,hi),lo);
+				dst = Max(Min(hi,src),lo);
 			}
 		};
 
 		template <> struct SampleToHost<double,float> {
 			static void RoundAndClip(double& dst, float src, float hi, float lo)
 			{
-				dst = max(min((double)src,(double)hi),(double)lo);
+				dst = Max(Min((double)hi,(double)src),(double)lo);
 			}
 		};
 
@@ -138,7 +161,7 @@ namespace PAD{
 				tmp.word = x;
 
 				for(unsigned i(0);i<sizeof(DATA)/2;++i)
-					swap(tmp.bytes[i],tmp.bytes[sizeof(DATA)-1-i]);
+					Exchange(tmp.bytes[i],tmp.bytes[sizeof(DATA)-1-i]);
 
 				return tmp.word;
 			}
@@ -147,18 +170,89 @@ namespace PAD{
 		template <typename E, int N> struct Bytes<SampleVector<E,N>> {
 			static SampleVector<E,N> Swap(const SampleVector<E,N>& _x)
 			{
-				SampleVector<E,N> x;
+				SampleVector<E,N> x(_x);
 				for(unsigned i(0);i<N;++i) x[i] = Bytes<E>::Swap(x[i]);
 				return x;
 			}
 		};
 
+		/* VEC host samples only fill half a register and the ISA provides vectors of 2*VEC
+		   host and float lanes; the channel converters then process two blocks of frames at once */
+		template <typename HOST, int VEC> struct PairFrames { static const bool value = false; };
+
+		static inline uint32_t XorShift(uint32_t x)
+		{
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			return x;
+		}
+
+		/* TPDF dither with optional first order error feedback for N channels. Lanes are
+		   channels, and Apply quantizes one frame to the host resolution, so that the
+		   rounding in SampleToHost receives exact integers. Per-channel generator and
+		   error states are loaded in the constructor and written back by Store. This scalar
+		   generator serves instruction sets without a specialization; SSE2 and up provide
+		   vector ones for every bundle width */
+		template <int N> struct DitherVector {
+			uint32_t seed[N];
+			float error[N];
+			float shape, resolution, inverse;
+
+			DitherVector(const uint32_t *s, const float *e, bool shaped, float res):shape(shaped ? 1.f : 0.f),resolution(res),inverse(1.f / res)
+			{
+				for(unsigned i(0);i<N;++i) {seed[i] = s[i];error[i] = e[i];}
+			}
+
+			void Store(uint32_t *s, float *e) const
+			{
+				for(unsigned i(0);i<N;++i) {s[i] = seed[i];e[i] = error[i];}
+			}
+
+			void Apply(SampleVector<float,N>& x)
+			{
+				for(unsigned i(0);i<N;++i)
+				{
+					uint32_t a = XorShift(seed[i]), b = XorShift(a);
+					seed[i] = b;
+					/* the sum of two uniform variates in [-1/2,1/2) lsb */
+					float tpdf = (float(int32_t(a)) + float(int32_t(b))) * (1.f / 4294967296.f);
+					float v = Max(Min(x[i] * resolution,resolution),-resolution) - error[i] * shape;
+					float y = Round(v + tpdf);
+					error[i] = y - v;
+					/* exact, the resolution is a power of two */
+					x[i] = y * inverse;
+				}
+			}
+		};
+
+		template <typename T> struct InRegister { static const bool value = false; };
+		template <typename E, int N> struct InRegister<SampleVector<E,N>> { static const bool value = true; };
+
+		/* formats that are not shifted never need to multiply, which packed types can not do */
+		template <int SHIFT> struct ShiftLeft {
+			template <typename T> static T Apply(const T& x) { return x * T(1 << SHIFT); }
+		};
+
+		template <> struct ShiftLeft<0> {
+			template <typename T> static const T& Apply(const T& x) { return x; }
+		};
+
 		template <typename HOST_FORMAT, typename CANONICAL_FORMAT, int NOMINAL_MINUS, int NOMINAL_PLUS, int SHIFT_LEFT, bool BIGENDIAN> struct HostSample {
 			typedef HostSample<HOST_FORMAT,CANONICAL_FORMAT,NOMINAL_MINUS,NOMINAL_PLUS,SHIFT_LEFT,BIGENDIAN> _myt;
 			typedef HOST_FORMAT smp_t;
 			HOST_FORMAT data;
 			HostSample(){}
 
+			/* scalar samples overlay host memory and stay in host byte order, while vectors
+			   are kept in system byte order and swapped as they are loaded and stored */
+			static const bool swapBytes = BIGENDIAN != SYSTEM_BIGENDIAN;
+			static const bool swapOnConvert = swapBytes && !InRegister<HOST_FORMAT>::value;
+
+			/* integer formats are quantized to NOMINAL_MINUS steps per unit and can be dithered */
+			static const bool quantized = !std::is_floating_point<HOST_FORMAT>::value;
+			static float Resolution() { return float(-NOMINAL_MINUS); }
+
 			HostSample(const CANONICAL_FORMAT& convertFrom)
 			{
 				*this = convertFrom;
@@ -170,12 +264,9 @@ namespace PAD{
 				SampleToHost<HOST_FORMAT,CANONICAL_FORMAT>::RoundAndClip(
 					data, convertFrom * CANONICAL_FORMAT(-NOMINAL_MINUS), CANONICAL_FORMAT(NOMINAL_PLUS), CANONICAL_FORMAT(NOMINAL_MINUS));
 
-				if (SHIFT_LEFT)
-				{
-					data = data * HOST_FORMAT(1 << SHIFT_LEFT);
-				}
+				data = ShiftLeft<SHIFT_LEFT>::Apply(data);
 
-				if (BIGENDIAN != SYSTEM_BIGENDIAN)
+				if (swapOnConvert)
 				{
 					data = Bytes<HOST_FORMAT>::Swap(data);
 				}
@@ -186,7 +277,7 @@ namespace PAD{
 			{
 				/* int -> float */
 				HOST_FORMAT tmp(data);
-				if (BIGENDIAN != SYSTEM_BIGENDIAN)
+				if (swapOnConvert)
 				{
 					tmp = Bytes<HOST_FORMAT>::Swap(tmp);
 				}
@@ -206,19 +297,91 @@ namespace PAD{
 				HostSample<SampleVector<HOST_FORMAT,N>,SampleVector<CANONICAL_FORMAT,N>,NOMINAL_MINUS,NOMINAL_PLUS,SHIFT_LEFT,BIGENDIAN> tmp;
 				assert((const void*)&ptr->data == (const void*)ptr);
 				tmp.data.template Load<ALIGNED>(&ptr->data);
-				if (BIGENDIAN != SYSTEM_BIGENDIAN)
+				if (swapBytes)
 				{
 					tmp.data=Bytes<decltype(tmp.data)>::Swap(tmp.data);
 				}
 				return tmp;
 			}
+
+			template <bool ALIGNED, bool STREAM = false, typename SMP> void Store(SMP* mem) const
+			{
+				static_assert(InRegister<HOST_FORMAT>::value, "Store is only meaningful for vectors");
+				HOST_FORMAT tmp(data);
+				if (swapBytes)
+				{
+					tmp = Bytes<HOST_FORMAT>::Swap(tmp);
+				}
+				if (STREAM && ALIGNED) StreamVector(tmp,mem);
+				else tmp.template Write<ALIGNED>(mem);
+			}
 		};
 
+		/* non-temporal store of a vector to an aligned, write-once destination; instruction
+		   sets with streaming stores overload this for their register types */
+		template <typename VEC, typename SMP> static void StreamVector(VEC& v, SMP* mem) { v.template Write<true>(mem); }
+
+		/* orders streaming stores before the stores that follow */
+		template <typename T = void> static void StreamFence( ) {}
+
 		template <int N, typename SMP> static void Transpose(SampleVector<SMP,N> *v)
 		{
 			for(unsigned i(0);i<N;++i)
 				for(unsigned j(i+1);j<N;++j)
-					swap(v[i][j],v[j][i]);
+					Exchange(v[i][j],v[j][i]);
+		}
+
+		/* lane operations of the integer canonical kernels, which keep samples in 32-bit lanes:
+		   constant shifts, clipping, rounding of float lanes, the float view that the transposes
+		   take, and 16-bit samples widened to lanes and narrowed back from lanes that hold 16-bit
+		   values. Instruction sets overload them for their register types */
+		template <int BITS, int N> static SampleVector<int32_t,N> ShiftLanesLeft(SampleVector<int32_t,N> x)
+		{
+			for(unsigned i(0);i<N;++i) x[i] = int32_t(uint32_t(x[i]) << BITS);
+			return x;
+		}
+
+		template <int BITS, int N> static SampleVector<int32_t,N> ShiftLanesRight(SampleVector<int32_t,N> x)
+		{
+			for(unsigned i(0);i<N;++i) x[i] = x[i] >> BITS;
+			return x;
 		}
+
+		template <int N> static SampleVector<int32_t,N> ClipLanes(SampleVector<int32_t,N> x, int32_t lo, int32_t hi)
+		{
+			for(unsigned i(0);i<N;++i) x[i] = Max(Min(x[i],hi),lo);
+			return x;
+		}
+
+		/* clipped to lo .. hi with NaN going to hi, then rounded to nearest even; a bound of
+		   2^31 saturates to the largest int32 */
+		template <int N> static SampleVector<int32_t,N> RoundLanes(const SampleVector<float,N>& x, float lo, float hi)
+		{
+			SampleVector<int32_t,N> r;
+			for(unsigned i(0);i<N;++i)
+			{
+				float c = Max(Min(hi,x[i]),lo);
+				r[i] = c >= 2147483648.f ? 2147483647 : int32_t(Round(c));
+			}
+			return r;
+		}
+
+		template <int N> static SampleVector<float,N> AsFloatLanes(const SampleVector<int32_t,N>& x)
+		{
+			SampleVector<float,N> f;
+			std::memcpy(&f,&x,sizeof(f));
+			return f;
+		}
+
+		template <int N> static SampleVector<int32_t,N> AsIntLanes(const SampleVector<float,N>& f)
+		{
+			SampleVector<int32_t,N> x;
+			std::memcpy(&x,&f,sizeof(x));
+			return x;
+		}
+
+		template <int N> static SampleVector<int32_t,N> WidenLanes(const SampleVector<int16_t,N>& x) { return SampleVector<int32_t,N>(x); }
+		template <int N> static SampleVector<int16_t,N> NarrowLanes(const SampleVector<int32_t,N>& x) { return SampleVector<int16_t,N>(x); }
+	}
 	}
 }
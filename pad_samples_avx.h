@@ -1,35 +1,98 @@
+#pragma once
 #include "pad_samples_sse2.h"
 #include <smmintrin.h>
 #include <immintrin.h>
 
 #ifdef HAS_BIG_ENDIAN
-#error AVX and big endian probably shouldn't coexist in a build :)
+#error AVX and big endian probably shouldnt coexist in a build :)
+#endif
+
+#ifndef __AVX2__
+#error pad_samples_avx.h must be compiled with AVX2 code generation enabled
 #endif
 
 #define PAD_SAMPLES_AVX
 
 namespace PAD{
 	namespace Converter{
+	inline namespace PAD_CONVERTER_ISA{
+		/* the alignment predicate in ChannelConverter only guarantees 16 byte boundaries,
+		   so the 256-bit types always use unaligned moves; they run at full speed on aligned data */
 		template <> struct SampleVector<int32_t,8>{
 			__m256i data;
 			SampleVector(){}
 			SampleVector(__m256i d):data(d){}
-			SampleVector(const int32_t* mem):data(_mm256_loadu_si256((__m256i*)(mem))){}
-			SampleVector(int32_t b) {data = _mm256_set_epi32(b,b,b,b,b,b,b,b);}
-			void Write(int32_t* mem) {_mm256_storeu_si256((__m256i*)mem,data);}
+			SampleVector(int32_t b) {data = _mm256_set1_epi32(b);}
+
+			template <bool ALIGNED> void Write(int32_t* mem) {_mm256_storeu_si256((__m256i*)mem,data);}
+			template <bool ALIGNED> void Load(const int32_t* mem) {data = _mm256_loadu_si256((const __m256i*)mem);}
+
+#ifdef _MSC_VER
 			int32_t& operator[](unsigned i) {return data.m256i_i32[i];}
 			int32_t operator[](unsigned i) const {return data.m256i_i32[i];}
+#else
+			int32_t& operator[](unsigned i) {return ((int32_t*)&data)[i];}
+			int32_t operator[](unsigned i) const {return ((const int32_t*)&data)[i];}
+#endif
+			SampleVector<int32_t,8> operator*(const SampleVector<int32_t,8>& b) const {return _mm256_mullo_epi32(data,b.data);}
+		};
+
+		template <> struct SampleVector<int24_t,8> : public SampleVector<int32_t,8>{
+			SampleVector(){}
+			SampleVector(__m256i d):SampleVector<int32_t,8>(d){}
+			SampleVector(const SampleVector<int32_t,8>& d):SampleVector<int32_t,8>(d){}
+			SampleVector(int32_t b):SampleVector<int32_t,8>(b){}
+
+			template <bool ALIGNED> void Load(const int24_t* mem)
+			{
+				/* the 24 bytes are covered by two overlapping 16 byte loads at offsets 0 and 8 */
+				const uint8_t *bytes = (const uint8_t*)mem;
+				__m256i packed = _mm256_inserti128_si256(
+					_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)bytes)),
+					_mm_loadu_si128((const __m128i*)(bytes + 8)),1);
+				data = _mm256_srai_epi32(_mm256_shuffle_epi8(packed,_mm256_setr_epi8(
+					-1,0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,
+					-1,4,5,6,-1,7,8,9,-1,10,11,12,-1,13,14,15)),8);
+			}
+
+			template <bool ALIGNED> void Write(int24_t* mem)
+			{
+				__m256i packed = _mm256_shuffle_epi8(data,_mm256_setr_epi8(
+					0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1,
+					0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1));
+				__m128i lo = _mm256_castsi256_si128(packed), hi = _mm256_extracti128_si256(packed,1);
+				uint8_t *bytes = (uint8_t*)mem;
+				_mm_storeu_si128((__m128i*)bytes,_mm_or_si128(lo,_mm_slli_si128(hi,12)));
+				_mm_storel_epi64((__m128i*)(bytes + 16),_mm_srli_si128(hi,4));
+			}
+		};
+
+		template <> struct Bytes<SampleVector<int24_t,8>> {
+			static SampleVector<int24_t,8> Swap(const SampleVector<int24_t,8>& x)
+			{
+				return _mm256_srai_epi32(_mm256_shuffle_epi8(x.data,_mm256_setr_epi8(
+					-1,2,1,0,-1,6,5,4,-1,10,9,8,-1,14,13,12,
+					-1,2,1,0,-1,6,5,4,-1,10,9,8,-1,14,13,12)),8);
+			}
 		};
 
 		template <> struct SampleVector<int16_t,8>{
 			__m128i data;
 			SampleVector(){}
 			SampleVector(__m128i d):data(d){}
-			SampleVector(const int16_t* mem) {data = _mm_set_epi16(mem[7],mem[6],mem[5],mem[4],mem[3],mem[2],mem[1],mem[0]);}
-			SampleVector(int16_t b) {data = _mm_set_epi16(b,b,b,b,b,b,b,b);}
-			void Write(int16_t *mem) {_mm_store_si128((__m128i*)mem,data);}
+			SampleVector(int16_t b) {data = _mm_set1_epi16(b);}
+
+			template <bool ALIGNED> void Write(int16_t *mem) {_mm_storeu_si128((__m128i*)mem,data);}
+			template <bool ALIGNED> void Load(const int16_t *mem) {data = _mm_loadu_si128((const __m128i*)mem);}
+
+#ifdef _MSC_VER
 			int16_t& operator[](unsigned i) {return data.m128i_i16[i];}
 			int16_t operator[](unsigned i) const {return data.m128i_i16[i];}
+#else
+			int16_t& operator[](unsigned i) {return ((int16_t*)&data)[i];}
+			int16_t operator[](unsigned i) const {return ((const int16_t*)&data)[i];}
+#endif
+			SampleVector<int16_t,8> operator*(const SampleVector<int16_t,8>& b) const {return _mm_mullo_epi16(data,b.data);}
 		};
 
 		template <> struct SampleVector<float,8>{
@@ -37,70 +100,257 @@ namespace PAD{
 			SampleVector(__m256 d):data(d){}
 			SampleVector(const SampleVector<int32_t,8>& d):data(_mm256_cvtepi32_ps(d.data)){}
 			SampleVector(const SampleVector<int16_t,8>& d):data(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(d.data))){}
+			SampleVector(const SampleVector<float,4>& l, const SampleVector<float,4>& h):data(_mm256_insertf128_ps(_mm256_castps128_ps256(l.data),h.data,1)){}
 			__m256 data;
-			SampleVector(float b) {data = _mm256_set_ps(b,b,b,b,b,b,b,b);}
-			SampleVector(const float* mem):data(_mm256_loadu_ps(mem)){}
+			SampleVector<float,4> Low() const {return _mm256_castps256_ps128(data);}
+			SampleVector<float,4> High() const {return _mm256_extractf128_ps(data,1);}
+			float *AsFloat() {return (float*)&data;}
+			SampleVector(float b) {data = _mm256_set1_ps(b);}
 			template <typename CVT> operator SampleVector<CVT,8>()
 			{
 				SampleVector<CVT,8> tmp;
-				for(unsigned i(0);i<4;++i) tmp[i]=data.m256_f32[i];
+				for(unsigned i(0);i<8;++i) tmp[i]=AsFloat()[i];
 				return tmp;
 			}
 
 			SampleVector<float,8> operator*(const SampleVector<float,8>& b) const { return _mm256_mul_ps(data,b.data); }
+			SampleVector<float,8> operator+(const SampleVector<float,8>& b) const { return _mm256_add_ps(data,b.data); }
 			SampleVector<float,8> operator/(const SampleVector<float,8>& b) const { return _mm256_div_ps(data,b.data); }
 
 			operator SampleVector<int32_t,8>() { return _mm256_cvtps_epi32(data); }
-			//			operator SampleVector<int16_t,8>() { return _mm256_cvtepi32_epi1 _mm256_cvtps_epi32(data); }
 
+#ifdef _MSC_VER
 			float& operator[](unsigned i) {return data.m256_f32[i];}
 			float operator[](unsigned i) const {return data.m256_f32[i];}
-			void Write(float* mem) {_mm256_storeu_ps(mem,data);}
+#else
+			float& operator[](unsigned i) {return ((float*)&data)[i];}
+			float operator[](unsigned i) const {return ((const float*)&data)[i];}
+#endif
+			template <bool ALIGNED> void Write(float* mem) {_mm256_storeu_ps(mem,data);}
+			template <bool ALIGNED> void Load(const float* mem) {data = _mm256_loadu_ps(mem);}
+
+			template <bool ALIGNED> void Write(double* mem)
+			{
+				_mm256_storeu_pd(mem,_mm256_cvtps_pd(_mm256_castps256_ps128(data)));
+				_mm256_storeu_pd(mem + 4,_mm256_cvtps_pd(_mm256_extractf128_ps(data,1)));
+			}
+
+			template <bool ALIGNED> void Load(const double* mem)
+			{
+				data = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_loadu_pd(mem))),
+					_mm256_cvtpd_ps(_mm256_loadu_pd(mem + 4)),1);
+			}
+		};
+
+		template <> struct SampleVector<double,8>{
+			__m256d lo, hi;
+			SampleVector(){}
+			SampleVector(__m256d l, __m256d h):lo(l),hi(h){}
+			SampleVector(double b) {lo = hi = _mm256_set1_pd(b);}
+
+			operator SampleVector<float,8>() const
+			{
+				return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)),_mm256_cvtpd_ps(hi),1);
+			}
+
+			template <bool ALIGNED> void Write(double* mem) {_mm256_storeu_pd(mem,lo);_mm256_storeu_pd(mem + 4,hi);}
+			template <bool ALIGNED> void Load(const double* mem) {lo = _mm256_loadu_pd(mem);hi = _mm256_loadu_pd(mem + 4);}
+		};
+
+		/* destinations are only known to be 16 byte aligned, so the 256-bit registers are
+		   streamed in halves; the write combining buffers merge them again */
+		static inline void Stream256(void *mem, __m256i x)
+		{
+			_mm_stream_si128((__m128i*)mem,_mm256_castsi256_si128(x));
+			_mm_stream_si128((__m128i*)mem + 1,_mm256_extracti128_si256(x,1));
+		}
+
+		static inline void StreamVector(SampleVector<int32_t,8>& v, int32_t *mem) {Stream256(mem,v.data);}
+		static inline void StreamVector(SampleVector<int16_t,8>& v, int16_t *mem) {_mm_stream_si128((__m128i*)mem,v.data);}
+		static inline void StreamVector(SampleVector<float,8>& v, float *mem) {Stream256(mem,_mm256_castps_si256(v.data));}
+		static inline void StreamVector(SampleVector<double,8>& v, double *mem) {Stream256(mem,_mm256_castpd_si256(v.lo));Stream256(mem + 4,_mm256_castpd_si256(v.hi));}
+
+		static inline __m256i ByteSwap32(__m256i x)
+		{
+			return _mm256_shuffle_epi8(x,_mm256_setr_epi8(
+				3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12,
+				3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12));
+		}
+
+		static inline __m256i ByteSwap16(__m256i x)
+		{
+			return _mm256_shuffle_epi8(x,_mm256_setr_epi8(
+				1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14,
+				1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14));
+		}
+
+		static inline __m256i ByteSwap64(__m256i x)
+		{
+			return _mm256_shuffle_epi8(x,_mm256_setr_epi8(
+				7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,
+				7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8));
+		}
+
+		template <> struct Bytes<SampleVector<int32_t,8>> {
+			static SampleVector<int32_t,8> Swap(const SampleVector<int32_t,8>& x) {return ByteSwap32(x.data);}
+		};
+
+		template <> struct Bytes<SampleVector<int16_t,8>> {
+			static SampleVector<int16_t,8> Swap(const SampleVector<int16_t,8>& x) {return ByteSwap16(x.data);}
 		};
 
+		template <> struct Bytes<SampleVector<float,8>> {
+			static SampleVector<float,8> Swap(const SampleVector<float,8>& x) {return _mm256_castsi256_ps(ByteSwap32(_mm256_castps_si256(x.data)));}
+		};
+
+		template <> struct Bytes<SampleVector<double,8>> {
+			static SampleVector<double,8> Swap(const SampleVector<double,8>& x)
+			{
+				return SampleVector<double,8>(
+					_mm256_castsi256_pd(ByteSwap64(_mm256_castpd_si256(x.lo))),
+					_mm256_castsi256_pd(ByteSwap64(_mm256_castpd_si256(x.hi))));
+			}
+		};
+
+		template <int BITS> static inline SampleVector<int32_t,8> ShiftLanesLeft(const SampleVector<int32_t,8>& x) {return _mm256_slli_epi32(x.data,BITS);}
+		template <int BITS> static inline SampleVector<int32_t,8> ShiftLanesRight(const SampleVector<int32_t,8>& x) {return _mm256_srai_epi32(x.data,BITS);}
+
+		static inline SampleVector<int32_t,8> ClipLanes(const SampleVector<int32_t,8>& x, int32_t lo, int32_t hi)
+		{
+			return _mm256_max_epi32(_mm256_min_epi32(x.data,_mm256_set1_epi32(hi)),_mm256_set1_epi32(lo));
+		}
+
+		static inline SampleVector<int32_t,8> RoundLanes(const SampleVector<float,8>& x, float lo, float hi)
+		{
+			__m256 c = _mm256_max_ps(_mm256_min_ps(x.data,_mm256_set1_ps(hi)),_mm256_set1_ps(lo));
+			__m256i over = _mm256_castps_si256(_mm256_cmp_ps(c,_mm256_set1_ps(2147483648.f),_CMP_GE_OQ));
+			return _mm256_xor_si256(_mm256_cvtps_epi32(c),over);
+		}
+
+		static inline SampleVector<float,8> AsFloatLanes(const SampleVector<int32_t,8>& x) {return _mm256_castsi256_ps(x.data);}
+		static inline SampleVector<int32_t,8> AsIntLanes(const SampleVector<float,8>& f) {return _mm256_castps_si256(f.data);}
+		static inline SampleVector<int32_t,8> WidenLanes(const SampleVector<int16_t,8>& x) {return _mm256_cvtepi16_epi32(x.data);}
+
+		/* packs work within 128-bit lanes, so the halves are packed together */
+		static inline SampleVector<int16_t,8> NarrowLanes(const SampleVector<int32_t,8>& x)
+		{
+			return _mm_packs_epi32(_mm256_castsi256_si128(x.data),_mm256_extracti128_si256(x.data,1));
+		}
+
 		template <> struct SampleToHost<SampleVector<int32_t,8>,SampleVector<float,8>>{
 			static void RoundAndClip(SampleVector<int32_t,8>& dst, const SampleVector<float,8>& src, const SampleVector<float,8>& hi, const SampleVector<float,8>& lo)
 			{
-				dst.data = _mm256_cvttps_epi32(
+				dst.data = _mm256_cvtps_epi32(
 					_mm256_max_ps(
 					_mm256_min_ps(
-					_mm256_add_ps(src.data,_mm256_set_ps(0.5f,0.5f,0.5f,0.5f,0.5f,0.5f,0.5f,0.5f)),
+					src.data,
 					hi.data),
 					lo.data));
 			}
 		};
 
-		template <> void Transpose<>(SampleVector<float,8> *v)
+		template <> struct SampleToHost<SampleVector<int24_t,8>,SampleVector<float,8>>{
+			static void RoundAndClip(SampleVector<int24_t,8>& dst, const SampleVector<float,8>& src, const SampleVector<float,8>& hi, const SampleVector<float,8>& lo)
+			{
+				SampleToHost<SampleVector<int32_t,8>,SampleVector<float,8>>::RoundAndClip(dst,src,hi,lo);
+			}
+		};
+
+		template <> struct SampleToHost<SampleVector<int16_t,8>,SampleVector<float,8>>{
+			static void RoundAndClip(SampleVector<int16_t,8>& dst, const SampleVector<float,8>& src, const SampleVector<float,8>& hi, const SampleVector<float,8>& lo)
+			{
+				__m256i wide = _mm256_cvtps_epi32(
+					_mm256_max_ps(_mm256_min_ps(src.data,hi.data),
+					lo.data));
+				dst.data = _mm_packs_epi32(_mm256_castsi256_si128(wide),_mm256_extracti128_si256(wide,1));
+			}
+		};
+
+		template <> struct DitherVector<8> {
+			__m256i seed;
+			__m256 error, shape, resolution, inverse;
+
+			DitherVector(const uint32_t *s, const float *e, bool shaped, float res)
+				:seed(_mm256_loadu_si256((const __m256i*)s)),error(_mm256_loadu_ps(e)),shape(_mm256_set1_ps(shaped ? 1.f : 0.f)),resolution(_mm256_set1_ps(res)),inverse(_mm256_set1_ps(1.f / res)) {}
+
+			void Store(uint32_t *s, float *e) const
+			{
+				_mm256_storeu_si256((__m256i*)s,seed);
+				_mm256_storeu_ps(e,error);
+			}
+
+			static __m256i XorShift(__m256i x)
+			{
+				x = _mm256_xor_si256(x,_mm256_slli_epi32(x,13));
+				x = _mm256_xor_si256(x,_mm256_srli_epi32(x,17));
+				return _mm256_xor_si256(x,_mm256_slli_epi32(x,5));
+			}
+
+			PAD_FORCEINLINE void Apply(SampleVector<float,8>& x)
+			{
+				__m256i a = XorShift(seed);
+				seed = XorShift(a);
+				__m256 tpdf = _mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(a),_mm256_cvtepi32_ps(seed)),_mm256_set1_ps(1.f / 4294967296.f));
+				__m256 v = _mm256_sub_ps(
+					_mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(x.data,resolution),resolution),_mm256_sub_ps(_mm256_setzero_ps(),resolution)),
+					_mm256_mul_ps(error,shape));
+				__m256 y = _mm256_cvtepi32_ps(_mm256_cvtps_epi32(_mm256_add_ps(v,tpdf)));
+				error = _mm256_sub_ps(y,v);
+				x.data = _mm256_mul_ps(y,inverse);
+			}
+		};
+
+		/* the 4-channel remainder bundles convert int16 eight frames at a time as well */
+		template <> struct PairFrames<int16_t,4> { static const bool value = true; };
+
+		template <> struct SampleToHost<SampleVector<float,8>,SampleVector<float,8>>{
+			static void RoundAndClip(SampleVector<float,8>& dst, const SampleVector<float,8>& src, const SampleVector<float,8>& hi, const SampleVector<float,8>& lo)
+			{
+				dst.data = _mm256_max_ps(_mm256_min_ps(src.data,hi.data),lo.data);
+			}
+		};
+
+		template <> struct SampleToHost<SampleVector<double,8>,SampleVector<float,8>>{
+			static void RoundAndClip(SampleVector<double,8>& dst, const SampleVector<float,8>& src, const SampleVector<float,8>& hi, const SampleVector<float,8>& lo)
+			{
+				__m256 clipped = _mm256_max_ps(_mm256_min_ps(src.data,hi.data),lo.data);
+				dst.lo = _mm256_cvtps_pd(_mm256_castps256_ps128(clipped));
+				dst.hi = _mm256_cvtps_pd(_mm256_extractf128_ps(clipped,1));
+			}
+		};
+
+		static PAD_FORCEINLINE void Transpose(SampleVector<float,8> *v)
 		{
-			__m256 __t0, __t1, __t2, __t3, __t4, __t5, __t6, __t7;
-			__m256 __tt0, __tt1, __tt2, __tt3, __tt4, __tt5, __tt6, __tt7;
-
-			__t0 = _mm256_unpacklo_ps(v[0].data, v[1].data);
-			__t1 = _mm256_unpackhi_ps(v[0].data, v[1].data);
-			__t2 = _mm256_unpacklo_ps(v[2].data, v[3].data);
-			__t3 = _mm256_unpackhi_ps(v[2].data, v[3].data);
-			__t4 = _mm256_unpacklo_ps(v[4].data, v[5].data);
-			__t5 = _mm256_unpackhi_ps(v[4].data, v[5].data);
-			__t6 = _mm256_unpacklo_ps(v[6].data, v[7].data);
-			__t7 = _mm256_unpackhi_ps(v[6].data, v[7].data);
-
-			__tt0 = _mm256_shuffle_ps(__t0,__t2,_MM_SHUFFLE(1,0,1,0));
-			__tt1 = _mm256_shuffle_ps(__t0,__t2,_MM_SHUFFLE(3,2,3,2));
-			__tt2 = _mm256_shuffle_ps(__t1,__t3,_MM_SHUFFLE(1,0,1,0));
-			__tt3 = _mm256_shuffle_ps(__t1,__t3,_MM_SHUFFLE(3,2,3,2));
-			__tt4 = _mm256_shuffle_ps(__t4,__t6,_MM_SHUFFLE(1,0,1,0));
-			__tt5 = _mm256_shuffle_ps(__t4,__t6,_MM_SHUFFLE(3,2,3,2));
-			__tt6 = _mm256_shuffle_ps(__t5,__t7,_MM_SHUFFLE(1,0,1,0));
-			__tt7 = _mm256_shuffle_ps(__t5,__t7,_MM_SHUFFLE(3,2,3,2));
-
-			v[0].data = _mm256_permute2f128_ps(__tt0, __tt4, 0x20);
-			v[1].data = _mm256_permute2f128_ps(__tt1, __tt5, 0x20);
-			v[2].data = _mm256_permute2f128_ps(__tt2, __tt6, 0x20);
-			v[3].data = _mm256_permute2f128_ps(__tt3, __tt7, 0x20);
-			v[4].data = _mm256_permute2f128_ps(__tt0, __tt4, 0x31);
-			v[5].data = _mm256_permute2f128_ps(__tt1, __tt5, 0x31);
-			v[6].data = _mm256_permute2f128_ps(__tt2, __tt6, 0x31);
-			v[7].data = _mm256_permute2f128_ps(__tt3, __tt7, 0x31);
+			__m256 t0, t1, t2, t3, t4, t5, t6, t7;
+			__m256 tt0, tt1, tt2, tt3, tt4, tt5, tt6, tt7;
+
+			t0 = _mm256_unpacklo_ps(v[0].data, v[1].data);
+			t1 = _mm256_unpackhi_ps(v[0].data, v[1].data);
+			t2 = _mm256_unpacklo_ps(v[2].data, v[3].data);
+			t3 = _mm256_unpackhi_ps(v[2].data, v[3].data);
+			t4 = _mm256_unpacklo_ps(v[4].data, v[5].data);
+			t5 = _mm256_unpackhi_ps(v[4].data, v[5].data);
+			t6 = _mm256_unpacklo_ps(v[6].data, v[7].data);
+			t7 = _mm256_unpackhi_ps(v[6].data, v[7].data);
+
+			tt0 = _mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(1,0,1,0));
+			tt1 = _mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(3,2,3,2));
+			tt2 = _mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(1,0,1,0));
+			tt3 = _mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(3,2,3,2));
+			tt4 = _mm256_shuffle_ps(t4,t6,_MM_SHUFFLE(1,0,1,0));
+			tt5 = _mm256_shuffle_ps(t4,t6,_MM_SHUFFLE(3,2,3,2));
+			tt6 = _mm256_shuffle_ps(t5,t7,_MM_SHUFFLE(1,0,1,0));
+			tt7 = _mm256_shuffle_ps(t5,t7,_MM_SHUFFLE(3,2,3,2));
+
+			v[0].data = _mm256_permute2f128_ps(tt0, tt4, 0x20);
+			v[1].data = _mm256_permute2f128_ps(tt1, tt5, 0x20);
+			v[2].data = _mm256_permute2f128_ps(tt2, tt6, 0x20);
+			v[3].data = _mm256_permute2f128_ps(tt3, tt7, 0x20);
+			v[4].data = _mm256_permute2f128_ps(tt0, tt4, 0x31);
+			v[5].data = _mm256_permute2f128_ps(tt1, tt5, 0x31);
+			v[6].data = _mm256_permute2f128_ps(tt2, tt6, 0x31);
+			v[7].data = _mm256_permute2f128_ps(tt3, tt7, 0x31);
 		}
 	}
-}
\ No newline at end of file
+	}
+}
@@ -0,0 +1,17 @@
+/* compiled with AVX-512F code generation; only reached through the cpuid dispatch in pad_converters.cpp */
+#define PAD_CONVERTER_ISA avx512
+
+#include "pad_samples.h"
+#include "pad_samples_avx512.h"
+#include "pad_channels.h"
+#include "pad_converters.h"
+
+namespace PAD{
+	namespace Converter{
+		const ChannelKernels AVX512ChannelKernels[] = {
+			PAD_HOST_FORMATS(PAD_CHANNEL_KERNEL)
+		};
+
+		const ChannelKernels* const AVX512FixedChannelKernels = PAD_FIXED_LAYOUT_FORMAT(PAD_FIXED_CHANNEL_KERNELS);
+	}
+}
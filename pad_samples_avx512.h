@@ -0,0 +1,336 @@
+#pragma once
+#include "pad_samples_avx.h"
+#include <immintrin.h>
+
+#ifndef __AVX512F__
+#error pad_samples_avx512.h must be compiled with AVX-512F code generation enabled
+#endif
+
+#define PAD_SAMPLES_AVX512
+
+namespace PAD{
+	namespace Converter{
+	inline namespace PAD_CONVERTER_ISA{
+		template <> struct SampleVector<int32_t,16>{
+			__m512i data;
+			SampleVector(){}
+			SampleVector(__m512i d):data(d){}
+			SampleVector(int32_t b) {data = _mm512_set1_epi32(b);}
+
+			template <bool ALIGNED> void Write(int32_t* mem) {_mm512_storeu_si512(mem,data);}
+			template <bool ALIGNED> void Load(const int32_t* mem) {data = _mm512_loadu_si512(mem);}
+
+#ifdef _MSC_VER
+			int32_t& operator[](unsigned i) {return data.m512i_i32[i];}
+			int32_t operator[](unsigned i) const {return data.m512i_i32[i];}
+#else
+			int32_t& operator[](unsigned i) {return ((int32_t*)&data)[i];}
+			int32_t operator[](unsigned i) const {return ((const int32_t*)&data)[i];}
+#endif
+			SampleVector<int32_t,16> operator*(const SampleVector<int32_t,16>& b) const {return _mm512_mullo_epi32(data,b.data);}
+		};
+
+		/* AVX-512F has no byte shuffle, so the packed 24-bit halves go through the AVX2 kernels */
+		template <> struct SampleVector<int24_t,16> : public SampleVector<int32_t,16>{
+			SampleVector(){}
+			SampleVector(__m512i d):SampleVector<int32_t,16>(d){}
+			SampleVector(const SampleVector<int32_t,16>& d):SampleVector<int32_t,16>(d){}
+			SampleVector(int32_t b):SampleVector<int32_t,16>(b){}
+
+			template <bool ALIGNED> void Load(const int24_t* mem)
+			{
+				SampleVector<int24_t,8> lo, hi;
+				lo.Load<false>(mem);
+				hi.Load<false>(mem + 8);
+				data = _mm512_inserti64x4(_mm512_castsi256_si512(lo.data),hi.data,1);
+			}
+
+			template <bool ALIGNED> void Write(int24_t* mem)
+			{
+				SampleVector<int24_t,8> lo(_mm512_castsi512_si256(data)), hi(_mm512_extracti64x4_epi64(data,1));
+				lo.Write<false>(mem);
+				hi.Write<false>(mem + 8);
+			}
+		};
+
+		template <> struct Bytes<SampleVector<int24_t,16>> {
+			static SampleVector<int24_t,16> Swap(const SampleVector<int24_t,16>& x)
+			{
+				/* reverse the low three bytes of each lane and sign extend the result */
+				__m512i lo = _mm512_srai_epi32(_mm512_slli_epi32(x.data,24),8);
+				__m512i mid = _mm512_and_si512(x.data,_mm512_set1_epi32(0xff00));
+				__m512i hi = _mm512_and_si512(_mm512_srli_epi32(x.data,16),_mm512_set1_epi32(0xff));
+				return _mm512_or_si512(lo,_mm512_or_si512(mid,hi));
+			}
+		};
+
+		template <> struct SampleVector<int16_t,16>{
+			__m256i data;
+			SampleVector(){}
+			SampleVector(__m256i d):data(d){}
+			SampleVector(int16_t b) {data = _mm256_set1_epi16(b);}
+
+			template <bool ALIGNED> void Write(int16_t *mem) {_mm256_storeu_si256((__m256i*)mem,data);}
+			template <bool ALIGNED> void Load(const int16_t *mem) {data = _mm256_loadu_si256((const __m256i*)mem);}
+
+#ifdef _MSC_VER
+			int16_t& operator[](unsigned i) {return data.m256i_i16[i];}
+			int16_t operator[](unsigned i) const {return data.m256i_i16[i];}
+#else
+			int16_t& operator[](unsigned i) {return ((int16_t*)&data)[i];}
+			int16_t operator[](unsigned i) const {return ((const int16_t*)&data)[i];}
+#endif
+			SampleVector<int16_t,16> operator*(const SampleVector<int16_t,16>& b) const {return _mm256_mullo_epi16(data,b.data);}
+		};
+
+		template <> struct SampleVector<float,16>{
+			SampleVector(){}
+			SampleVector(__m512 d):data(d){}
+			SampleVector(const SampleVector<int32_t,16>& d):data(_mm512_cvtepi32_ps(d.data)){}
+			SampleVector(const SampleVector<int16_t,16>& d):data(_mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(d.data))){}
+			__m512 data;
+			float *AsFloat() {return (float*)&data;}
+			SampleVector(float b) {data = _mm512_set1_ps(b);}
+			template <typename CVT> operator SampleVector<CVT,16>()
+			{
+				SampleVector<CVT,16> tmp;
+				for(unsigned i(0);i<16;++i) tmp[i]=AsFloat()[i];
+				return tmp;
+			}
+
+			SampleVector<float,16> operator*(const SampleVector<float,16>& b) const { return _mm512_mul_ps(data,b.data); }
+			SampleVector<float,16> operator+(const SampleVector<float,16>& b) const { return _mm512_add_ps(data,b.data); }
+			SampleVector<float,16> operator/(const SampleVector<float,16>& b) const { return _mm512_div_ps(data,b.data); }
+
+			operator SampleVector<int32_t,16>() { return _mm512_cvtps_epi32(data); }
+
+#ifdef _MSC_VER
+			float& operator[](unsigned i) {return data.m512_f32[i];}
+			float operator[](unsigned i) const {return data.m512_f32[i];}
+#else
+			float& operator[](unsigned i) {return ((float*)&data)[i];}
+			float operator[](unsigned i) const {return ((const float*)&data)[i];}
+#endif
+			template <bool ALIGNED> void Write(float* mem) {_mm512_storeu_ps(mem,data);}
+			template <bool ALIGNED> void Load(const float* mem) {data = _mm512_loadu_ps(mem);}
+
+			/* AVX-512F can only split and join the 256-bit halves of a float vector through the double domain */
+			__m256 Low( ) const {return _mm512_castps512_ps256(data);}
+			__m256 High( ) const {return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(data),1));}
+			static __m512 Join(__m256 lo, __m256 hi)
+			{
+				return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_castps_pd(lo)),_mm256_castps_pd(hi),1));
+			}
+
+			template <bool ALIGNED> void Write(double* mem)
+			{
+				_mm512_storeu_pd(mem,_mm512_cvtps_pd(Low( )));
+				_mm512_storeu_pd(mem + 8,_mm512_cvtps_pd(High( )));
+			}
+
+			template <bool ALIGNED> void Load(const double* mem)
+			{
+				data = Join(_mm512_cvtpd_ps(_mm512_loadu_pd(mem)),_mm512_cvtpd_ps(_mm512_loadu_pd(mem + 8)));
+			}
+		};
+
+		template <> struct SampleVector<double,16>{
+			__m512d lo, hi;
+			SampleVector(){}
+			SampleVector(__m512d l, __m512d h):lo(l),hi(h){}
+			SampleVector(double b) {lo = hi = _mm512_set1_pd(b);}
+
+			operator SampleVector<float,16>() const {return SampleVector<float,16>::Join(_mm512_cvtpd_ps(lo),_mm512_cvtpd_ps(hi));}
+
+			template <bool ALIGNED> void Write(double* mem) {_mm512_storeu_pd(mem,lo);_mm512_storeu_pd(mem + 8,hi);}
+			template <bool ALIGNED> void Load(const double* mem) {lo = _mm512_loadu_pd(mem);hi = _mm512_loadu_pd(mem + 8);}
+		};
+
+		/* destinations are only known to be 16 byte aligned, so the registers are streamed in
+		   128-bit quarters; the write combining buffers merge them again */
+		static inline void Stream512(void *mem, __m512i x)
+		{
+			_mm_stream_si128((__m128i*)mem,_mm512_castsi512_si128(x));
+			_mm_stream_si128((__m128i*)mem + 1,_mm512_extracti32x4_epi32(x,1));
+			_mm_stream_si128((__m128i*)mem + 2,_mm512_extracti32x4_epi32(x,2));
+			_mm_stream_si128((__m128i*)mem + 3,_mm512_extracti32x4_epi32(x,3));
+		}
+
+		static inline void StreamVector(SampleVector<int32_t,16>& v, int32_t *mem) {Stream512(mem,v.data);}
+		static inline void StreamVector(SampleVector<int16_t,16>& v, int16_t *mem)
+		{
+			_mm_stream_si128((__m128i*)mem,_mm256_castsi256_si128(v.data));
+			_mm_stream_si128((__m128i*)mem + 1,_mm256_extracti128_si256(v.data,1));
+		}
+		static inline void StreamVector(SampleVector<float,16>& v, float *mem) {Stream512(mem,_mm512_castps_si512(v.data));}
+		static inline void StreamVector(SampleVector<double,16>& v, double *mem) {Stream512(mem,_mm512_castpd_si512(v.lo));Stream512(mem + 8,_mm512_castpd_si512(v.hi));}
+
+		/* no byte shuffle in AVX-512F: rotate each lane both ways and keep alternate bytes */
+		static inline __m512i ByteSwap32(__m512i x)
+		{
+			return _mm512_ternarylogic_epi32(
+				_mm512_rol_epi32(x,8),_mm512_rol_epi32(x,24),_mm512_set1_epi32(0x00ff00ff),0xe4);
+		}
+
+		template <> struct Bytes<SampleVector<int32_t,16>> {
+			static SampleVector<int32_t,16> Swap(const SampleVector<int32_t,16>& x) {return ByteSwap32(x.data);}
+		};
+
+		template <> struct Bytes<SampleVector<int16_t,16>> {
+			static SampleVector<int16_t,16> Swap(const SampleVector<int16_t,16>& x) {return ByteSwap16(x.data);}
+		};
+
+		template <> struct Bytes<SampleVector<float,16>> {
+			static SampleVector<float,16> Swap(const SampleVector<float,16>& x) {return _mm512_castsi512_ps(ByteSwap32(_mm512_castps_si512(x.data)));}
+		};
+
+		static inline __m512i ByteSwap64(__m512i x)
+		{
+			return _mm512_rol_epi64(ByteSwap32(x),32);
+		}
+
+		template <> struct Bytes<SampleVector<double,16>> {
+			static SampleVector<double,16> Swap(const SampleVector<double,16>& x)
+			{
+				return SampleVector<double,16>(
+					_mm512_castsi512_pd(ByteSwap64(_mm512_castpd_si512(x.lo))),
+					_mm512_castsi512_pd(ByteSwap64(_mm512_castpd_si512(x.hi))));
+			}
+		};
+
+		template <int BITS> static inline SampleVector<int32_t,16> ShiftLanesLeft(const SampleVector<int32_t,16>& x) {return _mm512_slli_epi32(x.data,BITS);}
+		template <int BITS> static inline SampleVector<int32_t,16> ShiftLanesRight(const SampleVector<int32_t,16>& x) {return _mm512_srai_epi32(x.data,BITS);}
+
+		static inline SampleVector<int32_t,16> ClipLanes(const SampleVector<int32_t,16>& x, int32_t lo, int32_t hi)
+		{
+			return _mm512_max_epi32(_mm512_min_epi32(x.data,_mm512_set1_epi32(hi)),_mm512_set1_epi32(lo));
+		}
+
+		static inline SampleVector<int32_t,16> RoundLanes(const SampleVector<float,16>& x, float lo, float hi)
+		{
+			__m512 c = _mm512_max_ps(_mm512_min_ps(x.data,_mm512_set1_ps(hi)),_mm512_set1_ps(lo));
+			__mmask16 over = _mm512_cmp_ps_mask(c,_mm512_set1_ps(2147483648.f),_CMP_GE_OQ);
+			return _mm512_mask_mov_epi32(_mm512_cvtps_epi32(c),over,_mm512_set1_epi32(2147483647));
+		}
+
+		static inline SampleVector<float,16> AsFloatLanes(const SampleVector<int32_t,16>& x) {return _mm512_castsi512_ps(x.data);}
+		static inline SampleVector<int32_t,16> AsIntLanes(const SampleVector<float,16>& f) {return _mm512_castps_si512(f.data);}
+		static inline SampleVector<int32_t,16> WidenLanes(const SampleVector<int16_t,16>& x) {return _mm512_cvtepi16_epi32(x.data);}
+		static inline SampleVector<int16_t,16> NarrowLanes(const SampleVector<int32_t,16>& x) {return _mm512_cvtepi32_epi16(x.data);}
+
+		template <> struct SampleToHost<SampleVector<int32_t,16>,SampleVector<float,16>>{
+			static void RoundAndClip(SampleVector<int32_t,16>& dst, const SampleVector<float,16>& src, const SampleVector<float,16>& hi, const SampleVector<float,16>& lo)
+			{
+				dst.data = _mm512_cvtps_epi32(
+					_mm512_max_ps(
+					_mm512_min_ps(
+					src.data,
+					hi.data),
+					lo.data));
+			}
+		};
+
+		template <> struct SampleToHost<SampleVector<int24_t,16>,SampleVector<float,16>>{
+			static void RoundAndClip(SampleVector<int24_t,16>& dst, const SampleVector<float,16>& src, const SampleVector<float,16>& hi, const SampleVector<float,16>& lo)
+			{
+				SampleToHost<SampleVector<int32_t,16>,SampleVector<float,16>>::RoundAndClip(dst,src,hi,lo);
+			}
+		};
+
+		template <> struct SampleToHost<SampleVector<int16_t,16>,SampleVector<float,16>>{
+			static void RoundAndClip(SampleVector<int16_t,16>& dst, const SampleVector<float,16>& src, const SampleVector<float,16>& hi, const SampleVector<float,16>& lo)
+			{
+				/* vpmovsdw narrows all sixteen lanes in order, no cross-lane fixup needed */
+				dst.data = _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(
+					_mm512_max_ps(_mm512_min_ps(src.data,hi.data),
+					lo.data)));
+			}
+		};
+
+		template <> struct DitherVector<16> {
+			__m512i seed;
+			__m512 error, shape, resolution, inverse;
+
+			DitherVector(const uint32_t *s, const float *e, bool shaped, float res)
+				:seed(_mm512_loadu_si512(s)),error(_mm512_loadu_ps(e)),shape(_mm512_set1_ps(shaped ? 1.f : 0.f)),resolution(_mm512_set1_ps(res)),inverse(_mm512_set1_ps(1.f / res)) {}
+
+			void Store(uint32_t *s, float *e) const
+			{
+				_mm512_storeu_si512(s,seed);
+				_mm512_storeu_ps(e,error);
+			}
+
+			static __m512i XorShift(__m512i x)
+			{
+				x = _mm512_xor_si512(x,_mm512_slli_epi32(x,13));
+				x = _mm512_xor_si512(x,_mm512_srli_epi32(x,17));
+				return _mm512_xor_si512(x,_mm512_slli_epi32(x,5));
+			}
+
+			PAD_FORCEINLINE void Apply(SampleVector<float,16>& x)
+			{
+				__m512i a = XorShift(seed);
+				seed = XorShift(a);
+				__m512 tpdf = _mm512_mul_ps(_mm512_add_ps(_mm512_cvtepi32_ps(a),_mm512_cvtepi32_ps(seed)),_mm512_set1_ps(1.f / 4294967296.f));
+				__m512 v = _mm512_sub_ps(
+					_mm512_max_ps(_mm512_min_ps(_mm512_mul_ps(x.data,resolution),resolution),_mm512_sub_ps(_mm512_setzero_ps(),resolution)),
+					_mm512_mul_ps(error,shape));
+				__m512 y = _mm512_cvtepi32_ps(_mm512_cvtps_epi32(_mm512_add_ps(v,tpdf)));
+				error = _mm512_sub_ps(y,v);
+				x.data = _mm512_mul_ps(y,inverse);
+			}
+		};
+
+		template <> struct SampleToHost<SampleVector<float,16>,SampleVector<float,16>>{
+			static void RoundAndClip(SampleVector<float,16>& dst, const SampleVector<float,16>& src, const SampleVector<float,16>& hi, const SampleVector<float,16>& lo)
+			{
+				dst.data = _mm512_max_ps(_mm512_min_ps(src.data,hi.data),lo.data);
+			}
+		};
+
+		template <> struct SampleToHost<SampleVector<double,16>,SampleVector<float,16>>{
+			static void RoundAndClip(SampleVector<double,16>& dst, const SampleVector<float,16>& src, const SampleVector<float,16>& hi, const SampleVector<float,16>& lo)
+			{
+				SampleVector<float,16> clipped(_mm512_max_ps(_mm512_min_ps(src.data,hi.data),lo.data));
+				dst.lo = _mm512_cvtps_pd(clipped.Low( ));
+				dst.hi = _mm512_cvtps_pd(clipped.High( ));
+			}
+		};
+
+		static PAD_FORCEINLINE void Transpose(SampleVector<float,16> *v)
+		{
+			__m512 t[16], r[16];
+
+			/* 2x2 and 4x4 blocks within each 128-bit lane */
+			for(unsigned i(0);i<16;i+=2)
+			{
+				t[i] = _mm512_unpacklo_ps(v[i].data, v[i+1].data);
+				t[i+1] = _mm512_unpackhi_ps(v[i].data, v[i+1].data);
+			}
+
+			for(unsigned i(0);i<16;i+=4)
+			{
+				r[i] = _mm512_shuffle_ps(t[i],t[i+2],_MM_SHUFFLE(1,0,1,0));
+				r[i+1] = _mm512_shuffle_ps(t[i],t[i+2],_MM_SHUFFLE(3,2,3,2));
+				r[i+2] = _mm512_shuffle_ps(t[i+1],t[i+3],_MM_SHUFFLE(1,0,1,0));
+				r[i+3] = _mm512_shuffle_ps(t[i+1],t[i+3],_MM_SHUFFLE(3,2,3,2));
+			}
+
+			/* exchange 128-bit lanes between the 4x4 blocks */
+			for(unsigned i(0);i<4;++i)
+			{
+				t[i] = _mm512_shuffle_f32x4(r[i],r[i+4],0x88);
+				t[i+4] = _mm512_shuffle_f32x4(r[i],r[i+4],0xdd);
+				t[i+8] = _mm512_shuffle_f32x4(r[i+8],r[i+12],0x88);
+				t[i+12] = _mm512_shuffle_f32x4(r[i+8],r[i+12],0xdd);
+			}
+
+			for(unsigned i(0);i<8;++i)
+			{
+				v[i].data = _mm512_shuffle_f32x4(t[i],t[i+8],0x88);
+				v[i+8].data = _mm512_shuffle_f32x4(t[i],t[i+8],0xdd);
+			}
+		}
+	}
+	}
+}
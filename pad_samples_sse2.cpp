@@ -1,8 +1,16 @@
 #include "pad_samples.h"
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
 #include "pad_samples_sse2.h"
-#include <emmintrin.h>
+#endif
+#include "pad_channels.h"
+#include "pad_converters.h"
 
 namespace PAD{
 	namespace Converter{
+		const ChannelKernels BaselineChannelKernels[] = {
+			PAD_HOST_FORMATS(PAD_CHANNEL_KERNEL)
+		};
+
+		const ChannelKernels* const BaselineFixedChannelKernels = PAD_FIXED_LAYOUT_FORMAT(PAD_FIXED_CHANNEL_KERNELS);
 	}
 }
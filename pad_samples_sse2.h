@@ -1,4 +1,11 @@
+#pragma once
 #include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
 #ifdef HAS_BIG_ENDIAN
 #error SSE2 and big endian probably shouldnt coexist in a build :)
 #endif
@@ -10,6 +17,7 @@
 
 namespace PAD{
 	namespace Converter{
+	inline namespace PAD_CONVERTER_ISA{
 		template <> struct SampleVector<int32_t,4>{
 			__m128i data;
 			SampleVector(){}
@@ -27,9 +35,94 @@ namespace PAD{
 			int32_t& operator[](unsigned i) { return  ((int32_t*)&data)[i]; }
 			int32_t operator[](unsigned i) const {return  ((int32_t*)&data)[i];}
 #endif
-			SampleVector<int32_t,4> operator*(const SampleVector<int32_t,4>& b) {return _mm_mul_epu32(data,b.data);}
+			SampleVector<int32_t,4> operator*(const SampleVector<int32_t,4>& b) const
+			{
+				/* SSE2 has no 32-bit mullo: multiply even and odd lanes separately and merge the low halves */
+				__m128i even = _mm_mul_epu32(data,b.data);
+				__m128i odd = _mm_mul_epu32(_mm_srli_si128(data,4),_mm_srli_si128(b.data,4));
+				return _mm_unpacklo_epi32(_mm_shuffle_epi32(even,_MM_SHUFFLE(0,0,2,0)),_mm_shuffle_epi32(odd,_MM_SHUFFLE(0,0,2,0)));
+			}
+		};
+
+		/* packed 24-bit samples are widened to sign-extended int32 lanes in registers;
+		   memory accesses touch exactly three bytes per sample */
+		template <> struct SampleVector<int24_t,4> : public SampleVector<int32_t,4>{
+			SampleVector(){}
+			SampleVector(__m128i d):SampleVector<int32_t,4>(d){}
+			SampleVector(const SampleVector<int32_t,4>& d):SampleVector<int32_t,4>(d){}
+			SampleVector(int32_t b):SampleVector<int32_t,4>(b){}
+
+#ifdef __SSSE3__
+			template <bool ALIGNED> void Load(const int24_t* mem)
+			{
+				int32_t tail;
+				std::memcpy(&tail,(const uint8_t*)mem + 8,4);
+				__m128i packed = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)mem),_mm_cvtsi32_si128(tail));
+				/* move each sample to the top three bytes of its lane, then shift back with sign */
+				data = _mm_srai_epi32(_mm_shuffle_epi8(packed,_mm_setr_epi8(-1,0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11)),8);
+			}
+
+			template <bool ALIGNED> void Write(int24_t* mem)
+			{
+				__m128i packed = _mm_shuffle_epi8(data,_mm_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1));
+				int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed,8));
+				_mm_storel_epi64((__m128i*)mem,packed);
+				std::memcpy((uint8_t*)mem + 8,&tail,4);
+			}
+#else
+			/* without pshufb, pairs of samples are split and joined with 64-bit shifts */
+			template <bool ALIGNED> void Load(const int24_t* mem)
+			{
+				int32_t tail;
+				std::memcpy(&tail,(const uint8_t*)mem + 8,4);
+				__m128i packed = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)mem),_mm_cvtsi32_si128(tail));
+				__m128i pairs = _mm_unpacklo_epi64(packed,_mm_srli_si128(packed,6));
+				__m128i lanes = _mm_or_si128(
+					_mm_and_si128(pairs,_mm_setr_epi32(-1,0,-1,0)),
+					_mm_and_si128(_mm_slli_epi64(pairs,8),_mm_setr_epi32(0,-1,0,-1)));
+				data = _mm_srai_epi32(_mm_slli_epi32(lanes,8),8);
+			}
+
+			template <bool ALIGNED> void Write(int24_t* mem)
+			{
+				__m128i lanes = _mm_and_si128(data,_mm_set1_epi32(0xffffff));
+				__m128i pairs = _mm_or_si128(
+					_mm_and_si128(lanes,_mm_setr_epi32(-1,0,-1,0)),
+					_mm_srli_epi64(_mm_and_si128(lanes,_mm_setr_epi32(0,-1,0,-1)),8));
+				__m128i packed = _mm_or_si128(_mm_move_epi64(pairs),_mm_slli_si128(_mm_srli_si128(pairs,8),6));
+				int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed,8));
+				_mm_storel_epi64((__m128i*)mem,packed);
+				std::memcpy((uint8_t*)mem + 8,&tail,4);
+			}
+#endif
+		};
+
+		template <> struct Bytes<SampleVector<int24_t,4>> {
+			static SampleVector<int24_t,4> Swap(const SampleVector<int24_t,4>& x)
+			{
+				/* reverse the low three bytes of each lane and sign extend the result */
+#ifdef __SSSE3__
+				return _mm_srai_epi32(_mm_shuffle_epi8(x.data,_mm_setr_epi8(-1,2,1,0,-1,6,5,4,-1,10,9,8,-1,14,13,12)),8);
+#else
+				__m128i lo = _mm_srai_epi32(_mm_slli_epi32(x.data,24),8);
+				__m128i mid = _mm_and_si128(x.data,_mm_set1_epi32(0xff00));
+				__m128i hi = _mm_and_si128(_mm_srli_epi32(x.data,16),_mm_set1_epi32(0xff));
+				return _mm_or_si128(lo,_mm_or_si128(mid,hi));
+#endif
+			}
 		};
 
+		/* sign extend the low four 16-bit lanes to 32 bits */
+		static inline __m128i WidenInt16(__m128i x)
+		{
+#ifdef __SSE4_1__
+			return _mm_cvtepi16_epi32(x);
+#else
+			return _mm_srai_epi32(_mm_unpacklo_epi16(x,x),16);
+#endif
+		}
+
+		/* four samples in the low half of the register */
 		template <> struct SampleVector<int16_t,4>{
 			__m128i data;
 			SampleVector(){}
@@ -54,7 +147,7 @@ namespace PAD{
 			SampleVector(){}
 			SampleVector(__m128 d):data(d){}
 			SampleVector(const SampleVector<int32_t,4>& d):data(_mm_cvtepi32_ps(d.data)){}
-			SampleVector(const SampleVector<int16_t,4>& d):data(_mm_set_ps(d[3],d[2],d[1],d[0])) {}
+			SampleVector(const SampleVector<int16_t,4>& d):data(_mm_cvtepi32_ps(WidenInt16(d.data))) {}
 			__m128 data;
             float *AsFloat() {return (float*)&data;}
 			SampleVector(float b) {data = _mm_set_ps(b,b,b,b);}
@@ -67,9 +160,10 @@ namespace PAD{
 			}
 
 			SampleVector<float,4> operator*(const SampleVector<float,4>& b) const { return _mm_mul_ps(data,b.data); }
+			SampleVector<float,4> operator+(const SampleVector<float,4>& b) const { return _mm_add_ps(data,b.data); }
 
 			operator SampleVector<int32_t,4>() { return _mm_cvtps_epi32(data); }
-			operator SampleVector<int16_t,4>() { return _mm_cvtps_epi32(data); }
+			operator SampleVector<int16_t,4>() { __m128i wide = _mm_cvtps_epi32(data); return _mm_packs_epi32(wide,wide); }
 
 #ifdef _MSC_VER
 			float& operator[](unsigned i) { return data.m128_f32[i]; }
@@ -80,29 +174,290 @@ namespace PAD{
 #endif
 			template <bool ALIGNED> void Write(float* mem) {if (ALIGNED) _mm_store_ps(mem,data); else _mm_storeu_ps(mem,data);}
 			template <bool ALIGNED> void Load(const float* mem) { data = ALIGNED?_mm_load_ps(mem):_mm_loadu_ps(mem);}
+
+			template <bool ALIGNED> void Write(double* mem)
+			{
+				__m128d lo = _mm_cvtps_pd(data), hi = _mm_cvtps_pd(_mm_movehl_ps(data,data));
+				if (ALIGNED) {_mm_store_pd(mem,lo);_mm_store_pd(mem + 2,hi);}
+				else {_mm_storeu_pd(mem,lo);_mm_storeu_pd(mem + 2,hi);}
+			}
+
+			template <bool ALIGNED> void Load(const double* mem)
+			{
+				__m128d lo = ALIGNED?_mm_load_pd(mem):_mm_loadu_pd(mem), hi = ALIGNED?_mm_load_pd(mem + 2):_mm_loadu_pd(mem + 2);
+				data = _mm_movelh_ps(_mm_cvtpd_ps(lo),_mm_cvtpd_ps(hi));
+			}
+		};
+
+		template <> struct SampleVector<double,4>{
+			__m128d lo, hi;
+			SampleVector(){}
+			SampleVector(__m128d l, __m128d h):lo(l),hi(h){}
+			SampleVector(double b) {lo = hi = _mm_set1_pd(b);}
+
+			operator SampleVector<float,4>() const {return _mm_movelh_ps(_mm_cvtpd_ps(lo),_mm_cvtpd_ps(hi));}
+
+			template <bool ALIGNED> void Write(double* mem)
+			{
+				if (ALIGNED) {_mm_store_pd(mem,lo);_mm_store_pd(mem + 2,hi);}
+				else {_mm_storeu_pd(mem,lo);_mm_storeu_pd(mem + 2,hi);}
+			}
+
+			template <bool ALIGNED> void Load(const double* mem)
+			{
+				lo = ALIGNED?_mm_load_pd(mem):_mm_loadu_pd(mem);
+				hi = ALIGNED?_mm_load_pd(mem + 2):_mm_loadu_pd(mem + 2);
+			}
+		};
+
+		/* byte order reversal within 16 and 32-bit lanes */
+		static inline __m128i ByteSwap16(__m128i x)
+		{
+#ifdef __SSSE3__
+			return _mm_shuffle_epi8(x,_mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14));
+#else
+			return _mm_or_si128(_mm_slli_epi16(x,8),_mm_srli_epi16(x,8));
+#endif
+		}
+
+		static inline __m128i ByteSwap32(__m128i x)
+		{
+#ifdef __SSSE3__
+			return _mm_shuffle_epi8(x,_mm_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12));
+#else
+			x = ByteSwap16(x);
+			return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x,_MM_SHUFFLE(2,3,0,1)),_MM_SHUFFLE(2,3,0,1));
+#endif
+		}
+
+		static inline __m128i ByteSwap64(__m128i x)
+		{
+#ifdef __SSSE3__
+			return _mm_shuffle_epi8(x,_mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8));
+#else
+			return _mm_shuffle_epi32(ByteSwap32(x),_MM_SHUFFLE(2,3,0,1));
+#endif
+		}
+
+		template <> struct Bytes<SampleVector<int32_t,4>> {
+			static SampleVector<int32_t,4> Swap(const SampleVector<int32_t,4>& x) {return ByteSwap32(x.data);}
+		};
+
+		template <> struct Bytes<SampleVector<int16_t,4>> {
+			static SampleVector<int16_t,4> Swap(const SampleVector<int16_t,4>& x) {return ByteSwap16(x.data);}
+		};
+
+		template <> struct Bytes<SampleVector<float,4>> {
+			static SampleVector<float,4> Swap(const SampleVector<float,4>& x) {return _mm_castsi128_ps(ByteSwap32(_mm_castps_si128(x.data)));}
+		};
+
+		template <> struct Bytes<SampleVector<double,4>> {
+			static SampleVector<double,4> Swap(const SampleVector<double,4>& x)
+			{
+				return SampleVector<double,4>(
+					_mm_castsi128_pd(ByteSwap64(_mm_castpd_si128(x.lo))),
+					_mm_castsi128_pd(ByteSwap64(_mm_castpd_si128(x.hi))));
+			}
 		};
 
+		template <int BITS> static inline SampleVector<int32_t,4> ShiftLanesLeft(const SampleVector<int32_t,4>& x) {return _mm_slli_epi32(x.data,BITS);}
+		template <int BITS> static inline SampleVector<int32_t,4> ShiftLanesRight(const SampleVector<int32_t,4>& x) {return _mm_srai_epi32(x.data,BITS);}
+
+		static inline SampleVector<int32_t,4> ClipLanes(const SampleVector<int32_t,4>& x, int32_t lo, int32_t hi)
+		{
+#ifdef __SSE4_1__
+			return _mm_max_epi32(_mm_min_epi32(x.data,_mm_set1_epi32(hi)),_mm_set1_epi32(lo));
+#else
+			/* SSE2 has no 32-bit min and max: select the bounds with compare masks */
+			__m128i h = _mm_set1_epi32(hi), l = _mm_set1_epi32(lo);
+			__m128i above = _mm_cmpgt_epi32(x.data,h), below = _mm_cmplt_epi32(x.data,l);
+			__m128i y = _mm_or_si128(_mm_andnot_si128(above,x.data),_mm_and_si128(above,h));
+			return _mm_or_si128(_mm_andnot_si128(below,y),_mm_and_si128(below,l));
+#endif
+		}
+
+		/* cvtps2dq returns 0x80000000 from 2^31 on, which the compare mask flips to the largest int32 */
+		static inline SampleVector<int32_t,4> RoundLanes(const SampleVector<float,4>& x, float lo, float hi)
+		{
+			__m128 c = _mm_max_ps(_mm_min_ps(x.data,_mm_set1_ps(hi)),_mm_set1_ps(lo));
+			__m128i over = _mm_castps_si128(_mm_cmpge_ps(c,_mm_set1_ps(2147483648.f)));
+			return _mm_xor_si128(_mm_cvtps_epi32(c),over);
+		}
+
+		static inline SampleVector<float,4> AsFloatLanes(const SampleVector<int32_t,4>& x) {return _mm_castsi128_ps(x.data);}
+		static inline SampleVector<int32_t,4> AsIntLanes(const SampleVector<float,4>& f) {return _mm_castps_si128(f.data);}
+		static inline SampleVector<int32_t,4> WidenLanes(const SampleVector<int16_t,4>& x) {return WidenInt16(x.data);}
+		static inline SampleVector<int16_t,4> NarrowLanes(const SampleVector<int32_t,4>& x) {return _mm_packs_epi32(x.data,x.data);}
+
 		template <> struct SampleToHost<SampleVector<int32_t,4>,SampleVector<float,4>>{
 			static void RoundAndClip(SampleVector<int32_t,4>& dst, const SampleVector<float,4> &src, const SampleVector<float,4> &hi, const SampleVector<float,4> &lo)
 			{
-				dst.data = _mm_cvttps_epi32(
+				/* cvtps2dq rounds to nearest even in the default MXCSR mode, negative samples included */
+				dst.data = _mm_cvtps_epi32(
 					_mm_max_ps(
 					_mm_min_ps(
-					_mm_add_ps(src.data,_mm_set_ps(0.5f,0.5f,0.5f,0.5f)),
+					src.data,
 					hi.data),
 					lo.data));
 			}
 		};
 
+		template <> struct SampleToHost<SampleVector<int24_t,4>,SampleVector<float,4>>{
+			static void RoundAndClip(SampleVector<int24_t,4>& dst, const SampleVector<float,4> &src, const SampleVector<float,4> &hi, const SampleVector<float,4> &lo)
+			{
+				SampleToHost<SampleVector<int32_t,4>,SampleVector<float,4>>::RoundAndClip(dst,src,hi,lo);
+			}
+		};
+
 		template <> struct SampleToHost<SampleVector<int16_t,4>,SampleVector<float,4>>{
 			static void RoundAndClip(SampleVector<int16_t,4>& dst, const SampleVector<float,4> &src, const SampleVector<float,4> &hi, const SampleVector<float,4> &lo)
 			{
-				/* todo: check rounding mode in outer scope */
-				dst.data = _mm_cvttps_epi32(
-					_mm_max_ps(_mm_min_ps(_mm_add_ps(src.data,_mm_set_ps(0.5f,0.5f,0.5f,0.5f)),hi.data),
+				__m128i wide = _mm_cvtps_epi32(
+					_mm_max_ps(_mm_min_ps(src.data,hi.data),
 					lo.data));
+				dst.data = _mm_packs_epi32(wide,wide);
+			}
+		};
+		template <> struct SampleToHost<SampleVector<float,4>,SampleVector<float,4>>{
+			static void RoundAndClip(SampleVector<float,4>& dst, const SampleVector<float,4> &src, const SampleVector<float,4> &hi, const SampleVector<float,4> &lo)
+			{
+				dst.data = _mm_max_ps(_mm_min_ps(src.data,hi.data),lo.data);
+			}
+		};
+
+		template <> struct SampleToHost<SampleVector<double,4>,SampleVector<float,4>>{
+			static void RoundAndClip(SampleVector<double,4>& dst, const SampleVector<float,4> &src, const SampleVector<float,4> &hi, const SampleVector<float,4> &lo)
+			{
+				__m128 clipped = _mm_max_ps(_mm_min_ps(src.data,hi.data),lo.data);
+				dst.lo = _mm_cvtps_pd(clipped);
+				dst.hi = _mm_cvtps_pd(_mm_movehl_ps(clipped,clipped));
 			}
 		};
+
+		template <> struct DitherVector<4> {
+			__m128i seed;
+			__m128 error, shape, resolution, inverse;
+
+			DitherVector(const uint32_t *s, const float *e, bool shaped, float res)
+				:seed(_mm_loadu_si128((const __m128i*)s)),error(_mm_loadu_ps(e)),shape(_mm_set1_ps(shaped ? 1.f : 0.f)),resolution(_mm_set1_ps(res)),inverse(_mm_set1_ps(1.f / res)) {}
+
+			void Store(uint32_t *s, float *e) const
+			{
+				_mm_storeu_si128((__m128i*)s,seed);
+				_mm_storeu_ps(e,error);
+			}
+
+			static __m128i XorShift(__m128i x)
+			{
+				x = _mm_xor_si128(x,_mm_slli_epi32(x,13));
+				x = _mm_xor_si128(x,_mm_srli_epi32(x,17));
+				return _mm_xor_si128(x,_mm_slli_epi32(x,5));
+			}
+
+			PAD_FORCEINLINE void Apply(SampleVector<float,4>& x)
+			{
+				__m128i a = XorShift(seed);
+				seed = XorShift(a);
+				__m128 tpdf = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(a),_mm_cvtepi32_ps(seed)),_mm_set1_ps(1.f / 4294967296.f));
+				__m128 v = _mm_sub_ps(
+					_mm_max_ps(_mm_min_ps(_mm_mul_ps(x.data,resolution),resolution),_mm_sub_ps(_mm_setzero_ps(),resolution)),
+					_mm_mul_ps(error,shape));
+				__m128 y = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_add_ps(v,tpdf)));
+				error = _mm_sub_ps(y,v);
+				x.data = _mm_mul_ps(y,inverse);
+			}
+		};
+
+		/* the stereo and single channel remainder bundles run the four lane generator with
+		   the lanes of missing channels idle; their seeds are zero, which xorshift keeps */
+		template <int N> struct NarrowDitherVector {
+			template <typename T> struct Padded {
+				T data[4];
+				Padded(const T *from) { for(unsigned i(0);i<4;++i) data[i] = i < N ? from[i] : T(0); }
+			};
+
+			DitherVector<4> lanes;
+
+			NarrowDitherVector(const uint32_t *s, const float *e, bool shaped, float res)
+				:lanes(Padded<uint32_t>(s).data,Padded<float>(e).data,shaped,res) {}
+
+			void Store(uint32_t *s, float *e) const
+			{
+				uint32_t seed[4];
+				float error[4];
+				lanes.Store(seed,error);
+				for(unsigned i(0);i<N;++i) {s[i] = seed[i];e[i] = error[i];}
+			}
+
+			static __m128 Load(const SampleVector<float,2>& x) { return _mm_castpd_ps(_mm_load_sd((const double*)x.data)); }
+			static __m128 Load(const SampleVector<float,1>& x) { return _mm_load_ss(x.data); }
+			static void Write(SampleVector<float,2>& x, __m128 v) { _mm_store_sd((double*)x.data,_mm_castps_pd(v)); }
+			static void Write(SampleVector<float,1>& x, __m128 v) { _mm_store_ss(x.data,v); }
+
+			PAD_FORCEINLINE void Apply(SampleVector<float,N>& x)
+			{
+				SampleVector<float,4> v(Load(x));
+				lanes.Apply(v);
+				Write(x,v.data);
+			}
+		};
+
+		template <> struct DitherVector<2> : public NarrowDitherVector<2> { using NarrowDitherVector<2>::NarrowDitherVector; };
+		template <> struct DitherVector<1> : public NarrowDitherVector<1> { using NarrowDitherVector<1>::NarrowDitherVector; };
+
+#ifndef __AVX2__
+		/* eight 16-bit samples fill a register, so the int16 formats convert two blocks of four
+		   frames at a time; the float side is a pair of registers. AVX2 builds use the types
+		   from pad_samples_avx.h instead */
+		template <> struct SampleVector<int16_t,8>{
+			__m128i data;
+			SampleVector(){}
+			SampleVector(__m128i d):data(d){}
+			SampleVector(int16_t b) {data = _mm_set1_epi16(b);}
+
+			template <bool ALIGNED> void Write(int16_t* mem) {if (ALIGNED) _mm_store_si128((__m128i*)mem,data); else _mm_storeu_si128((__m128i*)mem,data);}
+			template <bool ALIGNED> void Load(const int16_t* mem) { data = ALIGNED?_mm_load_si128((const __m128i*)mem):_mm_loadu_si128((const __m128i*)mem);}
+		};
+
+		template <> struct SampleVector<float,8>{
+			__m128 lo, hi;
+			SampleVector(){}
+			SampleVector(const SampleVector<float,4>& l, const SampleVector<float,4>& h):lo(l.data),hi(h.data){}
+			SampleVector(const SampleVector<int16_t,8>& d)
+				:lo(_mm_cvtepi32_ps(WidenInt16(d.data)))
+				,hi(_mm_cvtepi32_ps(WidenInt16(_mm_unpackhi_epi64(d.data,d.data)))){}
+			SampleVector(float b) {lo = hi = _mm_set1_ps(b);}
+
+			SampleVector<float,4> Low() const {return lo;}
+			SampleVector<float,4> High() const {return hi;}
+
+			SampleVector<float,8> operator*(const SampleVector<float,8>& b) const {return SampleVector<float,8>(_mm_mul_ps(lo,b.lo),_mm_mul_ps(hi,b.hi));}
+		};
+
+		template <> struct Bytes<SampleVector<int16_t,8>> {
+			static SampleVector<int16_t,8> Swap(const SampleVector<int16_t,8>& x) {return ByteSwap16(x.data);}
+		};
+
+		template <> struct SampleToHost<SampleVector<int16_t,8>,SampleVector<float,8>>{
+			static void RoundAndClip(SampleVector<int16_t,8>& dst, const SampleVector<float,8> &src, const SampleVector<float,8> &hi, const SampleVector<float,8> &lo)
+			{
+				__m128i l = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(src.lo,hi.lo),lo.lo));
+				__m128i h = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(src.hi,hi.hi),lo.hi));
+				dst.data = _mm_packs_epi32(l,h);
+			}
+		};
+
+		template <> struct PairFrames<int16_t,4> { static const bool value = true; };
+
+		static inline void StreamVector(SampleVector<int16_t,8>& v, int16_t *mem) {_mm_stream_si128((__m128i*)mem,v.data);}
+#endif
+
+		/* streaming stores bypass the cache for destinations that are not read back */
+		static inline void StreamVector(SampleVector<int32_t,4>& v, int32_t *mem) {_mm_stream_si128((__m128i*)mem,v.data);}
+		static inline void StreamVector(SampleVector<float,4>& v, float *mem) {_mm_stream_ps(mem,v.data);}
+		static inline void StreamVector(SampleVector<double,4>& v, double *mem) {_mm_stream_pd(mem,v.lo);_mm_stream_pd(mem + 2,v.hi);}
+		static inline void StreamFence( ) {_mm_sfence();}
+
 		static void Transpose(SampleVector<float, 4> *v) {
 			__m128i t0 = _mm_castps_si128(_mm_unpacklo_ps(v[0].data, v[1].data));
 			__m128i t1 = _mm_castps_si128(_mm_unpacklo_ps(v[2].data, v[3].data));
@@ -115,4 +470,5 @@ namespace PAD{
 			v[3] = _mm_castsi128_ps(_mm_unpackhi_epi64(t2, t3));
 		}
 	}
+	}
 }
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cerrno>
+
+#include "pad_virtual.h"
+#include "pad_errors.h"
+
+#ifndef WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+namespace PAD {
+	using namespace std;
+
+	void RequestRealtimeScheduling( ) {
+#ifndef WIN32
+		sched_param param = { };
+		param.sched_priority = max(sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO) - 10);
+		pthread_setschedparam(pthread_self( ), SCHED_FIFO, &param);
+#endif
+	}
+
+	/* the steady clock is CLOCK_MONOTONIC on Linux */
+	void SleepUntil(chrono::steady_clock::time_point deadline) {
+#ifdef __linux__
+		auto ns = chrono::duration_cast<chrono::nanoseconds>(deadline.time_since_epoch( )).count( );
+		timespec ts;
+		ts.tv_sec = time_t(ns / 1000000000);
+		ts.tv_nsec = long(ns % 1000000000);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) { }
+#else
+		this_thread::sleep_until(deadline);
+#endif
+	}
+
+	chrono::steady_clock::time_point PeriodicDeadline::operator()(uint64_t tick) const {
+		return start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(tick * period));
+	}
+
+	void PeriodicDeadline::SkipLost(uint64_t& tick) const {
+		while (chrono::steady_clock::now( ) >= (*this)(tick + 2)) ++tick;
+	}
+
+	VirtualDevice::VirtualDevice(const string& n, const char *api, unsigned ins, unsigned outs, double rate, unsigned frames)
+		:name(n), hostAPI(api), streamThreadId(thread::id( )), running(false), numInputs(ins), numOutputs(outs), bufferSize(frames), defaultRate(rate) { }
+
+	VirtualDevice::~VirtualDevice( ) {
+		Shutdown( );
+	}
+
+	void VirtualDevice::Shutdown( ) {
+		Stop( );
+		/* destroyed from its own stream thread */
+		if (streamThread.joinable( )) streamThread.detach( );
+	}
+
+	/* a stream suspended from its own buffer switch ends when the switch returns */
+	bool VirtualDevice::Stop( ) {
+		bool wasRunning = running.exchange(false);
+		Interrupt( );
+		if (streamThreadId.load( ) != this_thread::get_id( ) && streamThread.joinable( )) {
+			streamThread.join( );
+			streamThreadId.store(thread::id( ));
+		}
+		return wasRunning;
+	}
+
+	void VirtualDevice::EndStream( ) {
+		if (running.exchange(false)) StreamDidEnd( );
+	}
+
+	bool VirtualDevice::Cycle(unsigned frames, chrono::microseconds inputTime, chrono::microseconds outputTime) {
+		BufferSwitchGate::Entry entry(GetBufferSwitchGate( ).get( ));
+		if (!entry) return false;
+
+		BeginCycle( );
+		DispatchBufferSwitch(stream.Interleave(inputBlocks.data( ), outputBlocks.data( ), frames, inputTime, outputTime));
+		stream.DeInterleave(outputBlocks.data( ), frames);
+		EndCycle( );
+		return true;
+	}
+
+	bool VirtualDevice::Supports(const AudioStreamConfiguration& conf) const {
+		return conf.GetNumDeviceInputs( ) <= numInputs && conf.GetNumDeviceOutputs( ) <= numOutputs;
+	}
+
+	static AudioStreamConfiguration Default(double rate, unsigned channels, unsigned numInputs, unsigned numOutputs) {
+		AudioStreamConfiguration cfg(rate, true);
+		if (numInputs) cfg.AddDeviceInputs(ChannelRange(0, min(channels, numInputs)));
+		if (numOutputs) cfg.AddDeviceOutputs(ChannelRange(0, min(channels, numOutputs)));
+		return cfg;
+	}
+
+	AudioStreamConfiguration VirtualDevice::DefaultMono( ) const {
+		return Default(defaultRate, 1, numInputs, numOutputs);
+	}
+
+	AudioStreamConfiguration VirtualDevice::DefaultStereo( ) const {
+		return Default(defaultRate, 2, numInputs, numOutputs);
+	}
+
+	AudioStreamConfiguration VirtualDevice::DefaultAllChannels( ) const {
+		return Default(defaultRate, max(numInputs, numOutputs), numInputs, numOutputs);
+	}
+
+	const AudioStreamConfiguration& VirtualDevice::Open(const AudioStreamConfiguration& conf) {
+		Close( );
+		if (conf.GetSampleRate( ) <= 0) throw SoftError(DeviceOpenStreamFailure, name + ": invalid sample rate");
+
+		currentConfiguration = conf;
+		currentConfiguration.SetDeviceChannelLimits(numInputs, numOutputs);
+		currentConfiguration.SetBufferSize(bufferSize);
+		LimitToConverters(currentConfiguration);
+
+		auto ins = currentConfiguration.GetNumStreamInputs( ), outs = currentConfiguration.GetNumStreamOutputs( );
+		inputBuffer.assign(ins * bufferSize, 0.f);
+		outputBuffer.assign(outs * bufferSize, 0.f);
+		PlanarChannels(inputBlocks, inputBuffer.data( ), ins, bufferSize);
+		PlanarChannels(outputBlocks, outputBuffer.data( ), outs, bufferSize);
+		stream.Prepare(currentConfiguration);
+		prepared = true;
+		Prepare( );
+
+		AboutToBeginStream(currentConfiguration);
+
+		if (conf.HasSuspendOnStartup( ) == false) Resume( );
+		return currentConfiguration;
+	}
+
+	void VirtualDevice::Resume( ) {
+		if (prepared == false) throw SoftError(DeviceStartStreamFailure, name + " is not opened to stream");
+		if (streamThreadId.load( ) == this_thread::get_id( )) {
+			/* resumed from the buffer switch that suspended it */
+			running.store(true);
+			return;
+		}
+		Stop( );
+		ResetXrunDetector( );
+		running.store(true);
+		streamThread = thread([this]( ) {
+			streamThreadId.store(this_thread::get_id( ));
+			Run( );
+		});
+	}
+
+	void VirtualDevice::Suspend( ) {
+		if (Stop( )) StreamDidEnd( );
+	}
+
+	void VirtualDevice::Close( ) {
+		bool didEnd = Stop( );
+		prepared = false;
+		if (didEnd) StreamDidEnd( );
+	}
+}
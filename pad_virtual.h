@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "pad.h"
+#include "HostAPI.h"
+
+namespace PAD {
+	/* asks for SCHED_FIFO on the calling thread; without the privilege it keeps running under
+	   the default policy */
+	void RequestRealtimeScheduling( );
+
+	/* sleeps to an absolute deadline, so that a late wakeup does not push back the ones after it */
+	void SleepUntil(std::chrono::steady_clock::time_point deadline);
+
+	/* deadlines of a clock ticking every period from its start, computed from the start so
+	   that rounding does not accumulate */
+	class PeriodicDeadline {
+		std::chrono::steady_clock::time_point start;
+		double period;
+	public:
+		PeriodicDeadline(double periodSeconds) :start(std::chrono::steady_clock::now( )), period(periodSeconds) { }
+		std::chrono::steady_clock::time_point GetStart( ) const { return start; }
+		std::chrono::steady_clock::time_point operator()(uint64_t tick) const;
+
+		/* skips the ticks after tick whose deadline passed a whole period ago; they are lost,
+		   as with hardware */
+		void SkipLost(uint64_t& tick) const;
+	};
+
+	/**
+	 * Device of a host API without hardware: the stream runs on a thread of its own over
+	 * native float blocks in memory, one per stream channel, and each cycle goes through the
+	 * same conversions and dispatch as a hardware backend. Subclasses drive the cycles from
+	 * Run and must call Shutdown in their destructors, before their members go away
+	 ***/
+	class VirtualDevice : public AudioDevice {
+		std::string name;
+		const char *hostAPI;
+		BlockStream stream;
+		std::thread streamThread;
+		std::atomic<std::thread::id> streamThreadId;
+		std::atomic<bool> running;
+		bool prepared = false;
+		bool Stop( );
+	protected:
+		unsigned numInputs, numOutputs, bufferSize;
+		double defaultRate;
+
+		AudioStreamConfiguration currentConfiguration;
+		std::vector<float> inputBuffer, outputBuffer;
+		std::vector<const void*> inputBlocks;
+		std::vector<void*> outputBlocks;
+
+		VirtualDevice(const std::string& name, const char *hostAPI, unsigned numInputs, unsigned numOutputs, double sampleRate, unsigned bufferSize);
+
+		/* the body of the stream thread, returning when IsRunning turns false or the stream
+		   ends by itself */
+		virtual void Run( ) = 0;
+
+		/* called by Open once the blocks are sized for the stream */
+		virtual void Prepare( ) { }
+
+		/* called when the stream is stopped, before waiting for the stream thread, to wake
+		   it from waits of its own */
+		virtual void Interrupt( ) { }
+
+		bool IsRunning( ) const { return running.load( ); }
+
+		/* the stream thread ends its stream */
+		void EndStream( );
+
+		/* one buffer of frames from the input blocks to the output blocks; false when the
+		   buffer switch gate turned it away */
+		bool Cycle(unsigned frames, std::chrono::microseconds inputTime, std::chrono::microseconds outputTime);
+
+		void Shutdown( );
+	public:
+		~VirtualDevice( );
+
+		const char *GetName( ) const { return name.c_str( ); }
+		const char *GetHostAPI( ) const { return hostAPI; }
+
+		unsigned GetNumInputs( ) const { return numInputs; }
+		unsigned GetNumOutputs( ) const { return numOutputs; }
+
+		bool Supports(const AudioStreamConfiguration&) const;
+
+		AudioStreamConfiguration DefaultMono( ) const;
+		AudioStreamConfiguration DefaultStereo( ) const;
+		AudioStreamConfiguration DefaultAllChannels( ) const;
+
+		const AudioStreamConfiguration& Open(const AudioStreamConfiguration&);
+		void Resume( );
+		void Suspend( );
+		void Close( );
+	};
+}
@@ -191,6 +191,29 @@ namespace {
 			size_t GetNumChannels() const {
 				return numEpChannels;
 			}
+
+			/* where the previous capture packet ended, to estimate the frames lost over a
+			   discontinuity; cleared when the stream starts */
+			bool positioned = false;
+			UINT64 nextPosition = 0, lastPcTime = 0;
+			UINT32 lastFrames = 0;
+
+			UINT64 FramesLost(UINT64 position, UINT64 pcTime, DWORD flags, double sampleRate) const {
+				if (!positioned) return 0;
+				if ((flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) == 0)
+					return position > nextPosition ? position - nextPosition : 0;
+				/* the performance counter is in 100ns units */
+				if (pcTime <= lastPcTime) return 0;
+				UINT64 elapsed = UINT64(double(pcTime - lastPcTime) * sampleRate * 1e-7);
+				return elapsed > lastFrames ? elapsed - lastFrames : 0;
+			}
+
+			void Advance(UINT64 position, UINT64 pcTime, UINT32 frames) {
+				positioned = true;
+				nextPosition = position + frames;
+				lastPcTime = pcTime;
+				lastFrames = frames;
+			}
 		};
 
 		template <typename PORTMAP>
@@ -302,7 +325,10 @@ namespace {
 						BYTE* data = nullptr;
 						UINT64 streamTime = 0, pcTime = 0;
 						UINT32 frames = 0;
-						ep.second.service->GetBuffer(&data, &frames, &flags, &streamTime, &pcTime);
+						if (FAILED(ep.second.service->GetBuffer(&data, &frames, &flags, &streamTime, &pcTime))) continue;
+						if (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY)
+							dev->ReportXrun(PAD::XrunStage::Device, ep.second.FramesLost(streamTime, pcTime, flags, cfg.GetSampleRate()));
+						ep.second.Advance(streamTime, pcTime, frames);
 						earliestTime = std::min(pcTime, earliestTime);
 
 						if (data) {
@@ -394,6 +420,7 @@ namespace {
 
 						if (io.numFrames) {
 
+							dev->BeginCycle();
 							SplatInput(io);
 							AllocateOutput(io);
 
@@ -411,9 +438,10 @@ namespace {
 
 							auto refTime = dev->DeviceTimeNow();
 
-							dev->BufferSwitch(io);
+							dev->DispatchBufferSwitch(io);
 
 							SplatOutput(io);
+							dev->EndCycle();
 							rendered += io.numFrames;
 						} else {
 							break;
@@ -436,6 +464,8 @@ namespace {
 					InitializeCriticalSection(&audioCS);
 
 					cfg.SetDeviceChannelLimits((unsigned int)dCfg.inputChannel.size(), (unsigned)dCfg.outputChannel.size());
+					/* the mix format is always delivered in single precision, interleaved and unmixed */
+					LimitToDeviceBuffers(cfg);
 
 					for (auto r : cfg.GetInputRanges()) {
 						for (auto c = r.begin();c != r.end();++c) {
@@ -506,6 +536,8 @@ namespace {
 					if (onOff) {
 						if (!streaming.test_and_set()) {
 							dev->AboutToBeginStream(cfg);
+							dev->ResetXrunDetector();
+							for (auto &ep : in) ep.second.positioned = false;
 							for (auto &ep : in) ep.first->Start();
 							for (auto &ep : out) ep.first->Start();
 						}
@@ -541,10 +573,6 @@ namespace {
 			stream.reset();
 		}
 
-		double CPU_Load() const {
-			return 0.0;
-		}
-
 		static std::chrono::microseconds GetTime() {
 			LARGE_INTEGER pc, pcFreq;
 			QueryPerformanceCounter(&pc);
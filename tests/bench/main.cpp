@@ -0,0 +1,160 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include "pad_converters.h"
+#include "pad_samples.h"
+
+using namespace PAD::Converter;
+
+/* converter throughput over every host format, channel count, buffer size and alignment
+   combination, written as JSON to stdout so that two builds can be diffed. Progress goes
+   to stderr. Options: --isa <name>, --format <name>, --min-ms <milliseconds> */
+
+static const unsigned sampleBytes[] = {
+#define PAD_BENCH_SAMPLE_BYTES(NAME, TYPE, ...) sizeof(TYPE),
+	PAD_HOST_FORMATS(PAD_BENCH_SAMPLE_BYTES)
+#undef PAD_BENCH_SAMPLE_BYTES
+};
+
+static const unsigned channelCounts[] = { 1, 2, 6, 8, 16, 32, 64, 128, 256 };
+static const unsigned frameCounts[] = { 16, 64, 256, 1024, 4096, 8192 };
+static const unsigned maxChannels = 256, maxFrames = 8192;
+
+/* every buffer starts on a cache line; unaligned variants are offset by one sample */
+static const size_t lineBytes = 64;
+
+struct Buffers {
+	size_t blockBytes;
+	std::vector<char> interleaved, blocks;
+
+	Buffers( ) :blockBytes(maxFrames * sizeof(double) + lineBytes),
+		interleaved(maxChannels * maxFrames * sizeof(double) + 2 * lineBytes),
+		blocks(maxChannels * blockBytes + lineBytes) { }
+
+	static char* Align(char *ptr) {
+		return (char*)(((uintptr_t)ptr + lineBytes - 1) & ~(uintptr_t)(lineBytes - 1));
+	}
+
+	template <typename CANON> CANON* Interleaved(bool aligned) {
+		return (CANON*)Align(interleaved.data( )) + (aligned ? 0 : 1);
+	}
+
+	void Blocks(std::vector<void*>& ptrs, unsigned channels, unsigned bytes, bool aligned) {
+		ptrs.resize(channels);
+		char *base = Align(blocks.data( ));
+		for (unsigned c = 0; c < channels; ++c) ptrs[c] = base + c * blockBytes + (aligned ? 0 : bytes);
+	}
+};
+
+template <typename CANON> struct Canonical;
+
+template <> struct Canonical<float> {
+	static const char* Name( ) { return "float32"; }
+	static void Run(const ChannelKernels& k, bool interleave, float *buf, void **blocks, unsigned frames, unsigned channels) {
+		if (interleave) k.Interleave(buf, (const void**)blocks, frames, channels, channels);
+		else k.DeInterleave(buf, blocks, frames, channels, channels);
+	}
+};
+
+template <> struct Canonical<double> {
+	static const char* Name( ) { return "float64"; }
+	static void Run(const ChannelKernels& k, bool interleave, double *buf, void **blocks, unsigned frames, unsigned channels) {
+		if (interleave) k.Interleave64(buf, (const void**)blocks, frames, channels, channels);
+		else k.DeInterleave64(buf, blocks, frames, channels, channels);
+	}
+};
+
+template <> struct Canonical<int32_t> {
+	static const char* Name( ) { return "int32"; }
+	static void Run(const ChannelKernels& k, bool interleave, int32_t *buf, void **blocks, unsigned frames, unsigned channels) {
+		if (interleave) k.InterleaveInt32(buf, (const void**)blocks, frames, channels, channels);
+		else k.DeInterleaveInt32(buf, blocks, frames, channels, channels);
+	}
+};
+
+template <> struct Canonical<int16_t> {
+	static const char* Name( ) { return "int16"; }
+	static void Run(const ChannelKernels& k, bool interleave, int16_t *buf, void **blocks, unsigned frames, unsigned channels) {
+		if (interleave) k.InterleaveInt16(buf, (const void**)blocks, frames, channels, channels);
+		else k.DeInterleaveInt16(buf, blocks, frames, channels, channels);
+	}
+};
+
+/* frames per second, calling the kernels in batches until the time budget is spent */
+template <typename CANON> static double Measure(const ChannelKernels& k, bool interleave, CANON *buf, void **blocks, unsigned frames, unsigned channels, double budgetNs) {
+	typedef std::chrono::high_resolution_clock clock;
+	Canonical<CANON>::Run(k, interleave, buf, blocks, frames, channels);
+
+	unsigned batch = 1 + (1 << 16) / (frames * channels);
+	double calls = 0, elapsed = 0;
+	while (elapsed < budgetNs) {
+		auto t0 = clock::now( );
+		for (unsigned i = 0; i < batch; ++i) Canonical<CANON>::Run(k, interleave, buf, blocks, frames, channels);
+		elapsed += std::chrono::duration<double, std::nano>(clock::now( ) - t0).count( );
+		calls += batch;
+	}
+	return calls * frames * 1e9 / elapsed;
+}
+
+static bool first = true;
+
+template <typename CANON> static void Sweep(Buffers& buffers, ConverterISA isa, HostFormat fmt, double budgetNs) {
+	std::vector<void*> blocks;
+	for (unsigned channels : channelCounts) {
+		auto& kernels(GetChannelKernels(fmt, isa, channels));
+		for (unsigned frames : frameCounts) {
+			for (int align = 0; align < 4; ++align) {
+				bool ai = (align & 1) == 0, ab = (align & 2) == 0;
+				CANON *buf = buffers.Interleaved<CANON>(ai);
+				buffers.Blocks(blocks, channels, sampleBytes[(int)fmt], ab);
+				for (bool interleave : { true, false }) {
+					double fps = Measure(kernels, interleave, buf, blocks.data( ), frames, channels, budgetNs);
+					std::printf("%s\n\t\t{\"isa\": \"%s\", \"format\": \"%s\", \"canonical\": \"%s\", \"direction\": \"%s\", "
+						"\"channels\": %u, \"frames\": %u, \"interleaved_aligned\": %s, \"blocks_aligned\": %s, \"frames_per_second\": %.0f}",
+						first ? "" : ",", GetName(isa), GetName(fmt), Canonical<CANON>::Name( ), interleave ? "interleave" : "deinterleave",
+						channels, frames, ai ? "true" : "false", ab ? "true" : "false", fps);
+					first = false;
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	const char *isaFilter = nullptr, *formatFilter = nullptr;
+	double minMs = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--isa") && i + 1 < argc) isaFilter = argv[++i];
+		else if (!strcmp(argv[i], "--format") && i + 1 < argc) formatFilter = argv[++i];
+		else if (!strcmp(argv[i], "--min-ms") && i + 1 < argc) minMs = atof(argv[++i]);
+		else {
+			std::fprintf(stderr, "usage: %s [--isa name] [--format name] [--min-ms milliseconds]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	Buffers buffers;
+	memset(buffers.interleaved.data( ), 0, buffers.interleaved.size( ));
+	memset(buffers.blocks.data( ), 0, buffers.blocks.size( ));
+
+	std::printf("{\n\t\"detected_isa\": \"%s\",\n\t\"streaming_threshold\": %zu,\n\t\"results\": [", GetName(GetConverterISA( )), GetStreamingThreshold( ));
+	for (int i = 0; i < (int)ConverterISA::NumISAs; ++i) {
+		ConverterISA isa = (ConverterISA)i;
+		if (IsSupported(isa) == false) continue;
+		if (isaFilter && strcmp(isaFilter, GetName(isa))) continue;
+		for (int f = 0; f < (int)HostFormat::NumFormats; ++f) {
+			HostFormat fmt = (HostFormat)f;
+			if (formatFilter && strcmp(formatFilter, GetName(fmt))) continue;
+			std::fprintf(stderr, "%s %s\n", GetName(isa), GetName(fmt));
+			Sweep<float>(buffers, isa, fmt, minMs * 1e6);
+			Sweep<double>(buffers, isa, fmt, minMs * 1e6);
+			Sweep<int32_t>(buffers, isa, fmt, minMs * 1e6);
+			Sweep<int16_t>(buffers, isa, fmt, minMs * 1e6);
+		}
+	}
+	std::printf("\n\t]\n}\n");
+	return 0;
+}
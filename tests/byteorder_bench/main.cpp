@@ -0,0 +1,53 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include "pad_converters.h"
+
+using namespace PAD::Converter;
+
+/* compares little and big endian host formats through the same converter kernels */
+
+static const HostFormat pairs[][2] = {
+	{ HostFormat::Int16LSB, HostFormat::Int16MSB },
+	{ HostFormat::Int24LSB, HostFormat::Int24MSB },
+	{ HostFormat::Int32LSB, HostFormat::Int32MSB },
+	{ HostFormat::Int32LSB24, HostFormat::Int32MSB24 },
+	{ HostFormat::Float32LSB, HostFormat::Float32MSB },
+};
+
+static double Measure(const ChannelKernels& kernels, unsigned channels, unsigned frames, bool interleave) {
+	std::vector<float> interleaved(channels * frames, 0.25f);
+	std::vector<std::vector<int32_t>> storage(channels, std::vector<int32_t>(frames));
+	std::vector<void*> blocks(channels);
+	for (unsigned c = 0; c < channels; ++c) blocks[c] = storage[c].data( );
+
+	const unsigned cycles = (1 << 24) / (channels * frames) + 1;
+	auto t0 = std::chrono::high_resolution_clock::now( );
+	for (unsigned i = 0; i < cycles; ++i) {
+		if (interleave) kernels.Interleave(interleaved.data( ), (const void**)blocks.data( ), frames, channels, channels);
+		else kernels.DeInterleave(interleaved.data( ), blocks.data( ), frames, channels, channels);
+	}
+	auto t1 = std::chrono::high_resolution_clock::now( );
+
+	/* samples per nanosecond */
+	return double(cycles) * channels * frames / std::chrono::duration<double, std::nano>(t1 - t0).count( );
+}
+
+int main( ) {
+	const unsigned channels = 16, frames = 256;
+	std::printf("%-8s %-12s %12s %12s %12s %12s\n", "isa", "format", "deint LSB", "deint MSB", "int LSB", "int MSB");
+	for (int i = 0; i < (int)ConverterISA::NumISAs; ++i) {
+		ConverterISA isa = (ConverterISA)i;
+		if (IsSupported(isa) == false) continue;
+		for (auto& p : pairs) {
+			auto& lsb(GetChannelKernels(p[0], isa));
+			auto& msb(GetChannelKernels(p[1], isa));
+			std::printf("%-8s %-12s %12.3f %12.3f %12.3f %12.3f\n", GetName(isa), GetName(p[0]),
+				Measure(lsb, channels, frames, false), Measure(msb, channels, frames, false),
+				Measure(lsb, channels, frames, true), Measure(msb, channels, frames, true));
+		}
+	}
+	std::printf("(samples per nanosecond, %u channels x %u frames)\n", channels, frames);
+	return 0;
+}
@@ -0,0 +1,47 @@
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* cost per buffer of delivering the IO to the client through the BufferSwitch event and
+   through the realtime callback, with a device that only calls DispatchBufferSwitch */
+
+/* touches one sample so that the dispatch, not the processing, is measured */
+static void Process(const IO& io) {
+	io.output[0] += io.input[0];
+}
+
+static void ProcessContext(void*, const IO& io) {
+	Process(io);
+}
+
+/* nanoseconds per buffer, with the processing called in place when dev is null */
+static double Measure(StubDevice* dev) {
+	AudioStreamConfiguration cfg;
+	float input[64] = { 0 }, output[64] = { 0 };
+	IO io{ cfg, input, output, 32, std::chrono::microseconds(0), std::chrono::microseconds(0) };
+
+	const unsigned cycles = 1 << 24;
+	auto t0 = std::chrono::high_resolution_clock::now( );
+	if (dev) for (unsigned i = 0; i < cycles; ++i) dev->DispatchBufferSwitch(io);
+	else for (unsigned i = 0; i < cycles; ++i) Process(io);
+	auto t1 = std::chrono::high_resolution_clock::now( );
+	return std::chrono::duration<double, std::nano>(t1 - t0).count( ) / cycles;
+}
+
+int main( ) {
+	StubDevice event, callback, context;
+	event.BufferSwitch = [](IO io) { Process(io); };
+	callback.SetRealtimeCallback([](const IO& io) { Process(io); });
+	context.SetRealtimeCallback(ProcessContext, nullptr);
+
+	std::printf("%-28s %8.2f\n", "direct call", Measure(nullptr));
+	std::printf("%-28s %8.2f\n", "BufferSwitch event", Measure(&event));
+	std::printf("%-28s %8.2f\n", "SetRealtimeCallback(F&&)", Measure(&callback));
+	std::printf("%-28s %8.2f\n", "SetRealtimeCallback(fn, ctx)", Measure(&context));
+	std::printf("(nanoseconds per buffer)\n");
+	return 0;
+}
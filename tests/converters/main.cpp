@@ -0,0 +1,353 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <random>
+#include <type_traits>
+#include "pad_converters.h"
+#include "pad_samples.h"
+
+using namespace PAD::Converter;
+
+static int failures = 0;
+
+struct FormatInfo {
+	HostFormat fmt;
+	unsigned bytes;
+	bool isFloat;
+	int32_t minus, plus;
+	int shift;
+	bool bigEndian;
+
+	/* float formats are checked on a 24-bit grid, which they represent exactly */
+	double Unit( ) const { return isFloat ? double(1 << 23) : double(-minus); }
+};
+
+static const FormatInfo formats[] = {
+#define PAD_TEST_FORMAT(NAME, HOST, MINUS, PLUS, SHIFT, BIGENDIAN) \
+	{ HostFormat::NAME, sizeof(HOST), std::is_floating_point<HOST>::value, MINUS, PLUS, SHIFT, BIGENDIAN },
+	PAD_HOST_FORMATS(PAD_TEST_FORMAT)
+#undef PAD_TEST_FORMAT
+};
+
+static void Fail(const char *what, HostFormat fmt, ConverterISA isa, const char *canonical, unsigned channels, unsigned frames) {
+	if (failures++ < 20) {
+		std::fprintf(stderr, "FAIL %s: %s/%s from %s, %u channels, %u frames\n", what, GetName(fmt), GetName(isa), canonical, channels, frames);
+	}
+}
+
+/* scalar reference for the host memory layout: integers are sign extended from the sample width */
+static void Encode(const FormatInfo& f, uint8_t *dst, int32_t v) {
+	uint8_t b[8];
+	uint64_t u = f.isFloat ? 0 : uint32_t(v) << f.shift;
+	if (f.isFloat && f.bytes == 8) {
+		double x = v / f.Unit( );
+		std::memcpy(&u, &x, 8);
+	} else if (f.isFloat) {
+		float x = float(v / f.Unit( ));
+		std::memcpy(&u, &x, 4);
+	}
+	for (unsigned i = 0; i < f.bytes; ++i) b[i] = uint8_t(u >> (8 * i));
+	for (unsigned i = 0; i < f.bytes; ++i) dst[i] = f.bigEndian ? b[f.bytes - 1 - i] : b[i];
+}
+
+static int32_t Decode(const FormatInfo& f, const uint8_t *src) {
+	uint64_t u = 0;
+	for (unsigned i = 0; i < f.bytes; ++i) u |= uint64_t(f.bigEndian ? src[f.bytes - 1 - i] : src[i]) << (8 * i);
+	if (f.isFloat && f.bytes == 8) {
+		double x;
+		std::memcpy(&x, &u, 8);
+		return int32_t(std::lround(x * f.Unit( )));
+	} else if (f.isFloat) {
+		float x;
+		uint32_t u32 = uint32_t(u);
+		std::memcpy(&x, &u32, 4);
+		return int32_t(std::lround(x * f.Unit( )));
+	}
+	unsigned unused = 32 - 8 * f.bytes;
+	return (int32_t(uint32_t(u) << unused) >> unused) >> f.shift;
+}
+
+static void TestInt24Scalar( ) {
+	for (int32_t v : { 0, 1, -1, 0x123456, -0x123456, (1 << 23) - 1, -(1 << 23) }) {
+		int24_t packed(v);
+		uint8_t expected[3] = { uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16) };
+		if (SYSTEM_BIGENDIAN) std::swap(expected[0], expected[2]);
+		if (std::memcmp(&packed, expected, 3) || int32_t(packed) != v) {
+			std::fprintf(stderr, "FAIL int24_t round trip of %d\n", v);
+			++failures;
+		}
+	}
+}
+
+static void Convert(const ChannelKernels& k, const float *interleaved, void **blocks, unsigned frames, unsigned channels) {
+	k.DeInterleave(interleaved, blocks, frames, channels, channels);
+}
+
+static void Convert(const ChannelKernels& k, const double *interleaved, void **blocks, unsigned frames, unsigned channels) {
+	k.DeInterleave64(interleaved, blocks, frames, channels, channels);
+}
+
+static void Convert(const ChannelKernels& k, float *interleaved, const void **blocks, unsigned frames, unsigned channels) {
+	k.Interleave(interleaved, blocks, frames, channels, channels);
+}
+
+static void Convert(const ChannelKernels& k, double *interleaved, const void **blocks, unsigned frames, unsigned channels) {
+	k.Interleave64(interleaved, blocks, frames, channels, channels);
+}
+
+static void Convert(const ChannelKernels& k, const float *interleaved, void **blocks, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages) {
+	k.DeInterleaveFused(interleaved, blocks, frames, channels, stride, stages);
+}
+
+static void Convert(const ChannelKernels& k, const double *interleaved, void **blocks, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages) {
+	k.DeInterleaveFused64(interleaved, blocks, frames, channels, stride, stages);
+}
+
+static void Convert(const ChannelKernels& k, float *interleaved, const void **blocks, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages) {
+	k.InterleaveFused(interleaved, blocks, frames, channels, stride, stages);
+}
+
+static void Convert(const ChannelKernels& k, double *interleaved, const void **blocks, unsigned frames, unsigned channels, unsigned stride, const FusedStages& stages) {
+	k.InterleaveFused64(interleaved, blocks, frames, channels, stride, stages);
+}
+
+/* dithered samples stay within one lsb of the input, two when the error is fed back; the
+   shaped noise is the first difference of white noise, with a lag one correlation of -1/2 */
+template <typename CANON> static void TestDither(const FormatInfo& f, ConverterISA isa, bool shaped, std::mt19937& rng) {
+	const char *canonical = sizeof(CANON) == 8 ? "double" : "float";
+	const int32_t bound = f.isFloat ? 0 : shaped ? 2 : 1;
+	std::uniform_int_distribution<int32_t> sampleDist(-1000, 1000);
+	auto& kernels(GetChannelKernels(f.fmt, isa));
+
+	for (unsigned channels : { 1u, 2u, 3u, 4u, 7u, 8u, 16u, 17u, 33u }) {
+		const unsigned frames = 509;
+		std::vector<int32_t> reference(channels * frames);
+		std::vector<CANON> interleaved(channels * frames);
+		std::vector<std::vector<uint8_t>> storage(channels, std::vector<uint8_t>(frames * f.bytes));
+		std::vector<void*> blocks(channels);
+		for (unsigned c = 0; c < channels; ++c) blocks[c] = storage[c].data( );
+
+		for (unsigned i = 0; i < channels * frames; ++i) {
+			reference[i] = sampleDist(rng);
+			interleaved[i] = CANON(reference[i] / f.Unit( ));
+		}
+
+		std::vector<uint32_t> seed(channels), initial(channels);
+		std::vector<float> error(channels);
+		ResetDither(seed.data( ), error.data( ), channels);
+		initial = seed;
+
+		/* two calls, so that the state is carried from one buffer to the next */
+		const unsigned split = frames / 3;
+		DitherState dither{ seed.data( ), error.data( ), shaped };
+		FusedStages stages{ 0, nullptr, nullptr, nullptr, &dither };
+		Convert(kernels, (const CANON*)interleaved.data( ), blocks.data( ), split, channels, channels, stages);
+		std::vector<void*> tail(channels);
+		for (unsigned c = 0; c < channels; ++c) tail[c] = (uint8_t*)blocks[c] + split * f.bytes;
+		Convert(kernels, (const CANON*)interleaved.data( ) + split * channels, tail.data( ), frames - split, channels, channels, stages);
+
+		bool ok = true, noisy = true, stateOk = true;
+		double correlation = 0;
+		for (unsigned c = 0; c < channels; ++c) {
+			const uint8_t *block = (const uint8_t*)blocks[c];
+			double r0 = 0, r1 = 0;
+			int32_t prev = 0;
+			for (unsigned i = 0; i < frames; ++i) {
+				int32_t d = Decode(f, block + i * f.bytes) - reference[i * channels + c];
+				if (d < -bound || d > bound) ok = false;
+				r0 += double(d) * d;
+				r1 += double(d) * prev;
+				prev = d;
+			}
+			if (f.isFloat == false && r0 == 0) noisy = false;
+			correlation += r0 > 0 ? r1 / r0 / channels : 0;
+			if (f.isFloat != (seed[c] == initial[c])) stateOk = false;
+			for (unsigned k = 0; k < c; ++k) if (f.isFloat == false && seed[k] == seed[c]) stateOk = false;
+		}
+		if (f.isFloat == false && (shaped ? correlation > -0.35 : std::fabs(correlation) > 0.15)) noisy = false;
+
+		if (!ok) Fail(shaped ? "shaped dither out of bounds" : "dither out of bounds", f.fmt, isa, canonical, channels, frames);
+		if (!noisy) Fail(shaped ? "shaped dither spectrum" : "dither spectrum", f.fmt, isa, canonical, channels, frames);
+		if (!stateOk) Fail("dither state", f.fmt, isa, canonical, channels, frames);
+	}
+}
+
+/* gains and routes of stream channels first.. of a wider stream, against a scalar reference
+   computed in double; results may differ from it by the rounding of one lsb */
+template <typename CANON> static void TestMix(const FormatInfo& f, ConverterISA isa, std::mt19937& rng) {
+	const char *canonical = sizeof(CANON) == 8 ? "double" : "float";
+	const int32_t range = f.isFloat ? (1 << 19) : -f.minus / 16;
+	const float gains[] = { 1.f, 0.5f, -2.f, 0.25f, 0.f };
+	std::uniform_int_distribution<int32_t> sampleDist(-range, range);
+	auto& kernels(GetChannelKernels(f.fmt, isa));
+
+	for (unsigned channels : { 1u, 3u, 4u, 5u, 8u, 9u, 16u, 17u, 33u }) {
+		for (unsigned frames : { 1u, 7u, 16u, 37u, 64u, 300u }) {
+			for (unsigned mode = 1; mode < 4; ++mode) {
+				const unsigned first = rng( ) % 3, streamChannels = first + channels + rng( ) % 3;
+				unsigned misalign = rng( ) % 4;
+
+				std::vector<float> gain(streamChannels, 1.f);
+				std::vector<unsigned> routeBegin(1, 0);
+				std::vector<RouteTerm> routes;
+				for (unsigned d = 0; d < streamChannels; ++d) {
+					if (mode & 1) gain[d] = gains[rng( ) % 5];
+					if ((mode & 2) && rng( ) % 3 == 0) {
+						for (unsigned t = rng( ) % 2; t < 2; ++t) routes.push_back(RouteTerm{ unsigned(rng( ) % streamChannels), gains[rng( ) % 4] });
+					}
+					routeBegin.push_back(unsigned(routes.size( )));
+				}
+				FusedStages stages{ first, (mode & 1) ? gain.data( ) : nullptr, (mode & 2) ? routeBegin.data( ) : nullptr, routes.data( ), nullptr };
+
+				std::vector<int32_t> reference(streamChannels * frames);
+				std::vector<CANON> interleaved(streamChannels * frames), back(streamChannels * frames, CANON(0));
+				std::vector<std::vector<uint8_t>> storage(channels, std::vector<uint8_t>(misalign + frames * f.bytes));
+				std::vector<void*> blocks(channels);
+				for (unsigned c = 0; c < channels; ++c) blocks[c] = storage[c].data( ) + misalign;
+				for (unsigned i = 0; i < streamChannels * frames; ++i) {
+					reference[i] = sampleDist(rng);
+					interleaved[i] = CANON(reference[i] / f.Unit( ));
+				}
+
+				/* deinterleave routes may read any column of the interleaved stream */
+				Convert(kernels, (const CANON*)interleaved.data( ) + first, blocks.data( ), frames, channels, streamChannels, stages);
+
+				bool ok = true;
+				for (unsigned c = 0; c < channels; ++c) {
+					unsigned d = first + c;
+					for (unsigned i = 0; i < frames; ++i) {
+						const int32_t *row = reference.data( ) + i * streamChannels;
+						double expected = row[d];
+						if ((mode & 2) && routeBegin[d] != routeBegin[d + 1]) {
+							expected = 0;
+							for (unsigned t = routeBegin[d]; t < routeBegin[d + 1]; ++t) expected += routes[t].gain * double(row[routes[t].source]);
+						}
+						expected *= gain[d];
+						if (std::fabs(Decode(f, (const uint8_t*)blocks[c] + i * f.bytes) - expected) > 1.0) ok = false;
+					}
+				}
+				if (!ok) Fail("deinterleave mix", f.fmt, isa, canonical, channels, frames);
+
+				/* interleave routes read the block buffers of the same call only */
+				for (unsigned c = 0; c < channels; ++c) {
+					for (unsigned i = 0; i < frames; ++i) Encode(f, (uint8_t*)blocks[c] + i * f.bytes, reference[i * streamChannels + first + c]);
+				}
+
+				Convert(kernels, back.data( ) + first, (const void**)blocks.data( ), frames, channels, streamChannels, stages);
+
+				ok = true;
+				for (unsigned c = 0; c < channels; ++c) {
+					unsigned d = first + c;
+					for (unsigned i = 0; i < frames; ++i) {
+						const int32_t *row = reference.data( ) + i * streamChannels;
+						double expected = row[d];
+						if ((mode & 2) && routeBegin[d] != routeBegin[d + 1]) {
+							expected = 0;
+							for (unsigned t = routeBegin[d]; t < routeBegin[d + 1]; ++t) {
+								unsigned s = routes[t].source;
+								if (s >= first && s < first + channels) expected += routes[t].gain * double(row[s]);
+							}
+						}
+						expected *= gain[d];
+						if (std::fabs(double(back[i * streamChannels + d]) * f.Unit( ) - expected) > 1.0) ok = false;
+					}
+				}
+				for (unsigned d = 0; d < streamChannels; ++d) {
+					if (d >= first && d < first + channels) continue;
+					for (unsigned i = 0; i < frames; ++i) if (back[i * streamChannels + d] != CANON(0)) ok = false;
+				}
+				if (!ok) Fail("interleave mix", f.fmt, isa, canonical, channels, frames);
+			}
+		}
+	}
+}
+
+template <typename CANON> static void TestKernels(const FormatInfo& f, ConverterISA isa, std::mt19937& rng) {
+	const char *canonical = sizeof(CANON) == 8 ? "double" : "float";
+	const unsigned guard = 32;
+	const int32_t lo = f.isFloat ? -(1 << 23) : f.minus, hi = f.isFloat ? (1 << 23) : f.plus;
+	std::uniform_int_distribution<int32_t> sampleDist(lo, hi);
+	auto& kernels(GetChannelKernels(f.fmt, isa));
+
+	for (unsigned channels : { 1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u, 9u, 15u, 16u, 17u, 24u, 32u, 33u, 64u }) {
+		/* the kernels selected for this channel count, straight-line for the fixed layouts */
+		auto& fixed(GetChannelKernels(f.fmt, isa, channels));
+		for (unsigned frames : { 1u, 2u, 3u, 4u, 7u, 8u, 9u, 16u, 31u, 37u, 64u, 300u }) {
+			auto& k(frames % 2 ? kernels : fixed);
+			/* odd byte offsets keep the block buffers misaligned */
+			unsigned misalign = rng( ) % 4;
+			std::vector<int32_t> reference(channels * frames);
+			std::vector<CANON> interleaved(channels * frames), back(channels * frames);
+			std::vector<std::vector<uint8_t>> storage(channels, std::vector<uint8_t>(misalign + frames * f.bytes + guard, 0xcd));
+			std::vector<void*> blocks(channels);
+			for (unsigned c = 0; c < channels; ++c) blocks[c] = storage[c].data( ) + misalign;
+
+			for (unsigned i = 0; i < channels * frames; ++i) {
+				reference[i] = sampleDist(rng);
+				interleaved[i] = CANON(reference[i] / f.Unit( ));
+			}
+
+			Convert(k, (const CANON*)interleaved.data( ), blocks.data( ), frames, channels);
+
+			bool ok = true, guardOk = true;
+			for (unsigned c = 0; c < channels; ++c) {
+				const uint8_t *block = (const uint8_t*)blocks[c];
+				for (unsigned i = 0; i < frames; ++i) {
+					if (Decode(f, block + i * f.bytes) != reference[i * channels + c]) ok = false;
+				}
+				for (unsigned i = 0; i < guard; ++i) if (block[frames * f.bytes + i] != 0xcd) guardOk = false;
+			}
+			if (!ok) Fail("deinterleave", f.fmt, isa, canonical, channels, frames);
+			if (!guardOk) Fail("deinterleave wrote past the block end", f.fmt, isa, canonical, channels, frames);
+
+			for (unsigned c = 0; c < channels; ++c) {
+				uint8_t *block = (uint8_t*)blocks[c];
+				for (unsigned i = 0; i < frames; ++i) Encode(f, block + i * f.bytes, reference[i * channels + c]);
+			}
+
+			Convert(k, back.data( ), (const void**)blocks.data( ), frames, channels);
+
+			if (std::memcmp(back.data( ), interleaved.data( ), back.size( ) * sizeof(CANON))) {
+				Fail("interleave", f.fmt, isa, canonical, channels, frames);
+			}
+		}
+	}
+}
+
+int main( ) {
+	std::mt19937 rng(1234);
+	TestInt24Scalar( );
+
+	for (int i = 0; i < (int)ConverterISA::NumISAs; ++i) {
+		ConverterISA isa = (ConverterISA)i;
+		if (IsSupported(isa) == false) {
+			std::printf("%s not supported, skipped\n", GetName(isa));
+			continue;
+		}
+		/* once with the default thresholds and once streaming every aligned deinterleave and
+		   tiling every buffer */
+		size_t defaultThreshold = GetStreamingThreshold( ), defaultTiling = GetTilingThreshold( );
+		for (bool forced : { false, true }) {
+			SetStreamingThreshold(forced ? 0 : defaultThreshold);
+			SetTilingThreshold(forced ? 0 : defaultTiling);
+			for (auto& f : formats) {
+				TestKernels<float>(f, isa, rng);
+				TestKernels<double>(f, isa, rng);
+				TestMix<float>(f, isa, rng);
+				TestMix<double>(f, isa, rng);
+				for (bool shaped : { false, true }) {
+					TestDither<float>(f, isa, shaped, rng);
+					TestDither<double>(f, isa, shaped, rng);
+				}
+			}
+		}
+		SetStreamingThreshold(defaultThreshold);
+		SetTilingThreshold(defaultTiling);
+		std::printf("%s checked\n", GetName(isa));
+	}
+
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* reassigns, extends and subscribes to a RealtimeEvent while another thread dispatches it
+   without pause; every handler checks the state it captured, which is only destroyed with
+   the snapshot that holds it. Best run under a sanitizer */
+
+struct Payload {
+	static const unsigned alive = 0x600dcafe;
+	unsigned magic = alive;
+	~Payload( ) { magic = 0xdeadbeef; }
+};
+
+int main( ) {
+	RealtimeEvent<unsigned> evt;
+	std::atomic<bool> running(true);
+	std::atomic<unsigned> calls(0), corrupt(0);
+
+	auto handler = [&]( ) {
+		auto payload = std::make_shared<Payload>( );
+		return [&, payload](unsigned) {
+			if (payload->magic != Payload::alive) corrupt.fetch_add(1);
+			calls.fetch_add(1, std::memory_order_relaxed);
+		};
+	};
+
+	std::thread audio([&]( ) {
+		unsigned cycle = 0;
+		while (running.load( )) evt(cycle++);
+	});
+
+	auto end = std::chrono::steady_clock::now( ) + std::chrono::milliseconds(500);
+	unsigned rounds = 0;
+	while (std::chrono::steady_clock::now( ) < end) {
+		evt = handler( );
+		evt += handler( );
+		{
+			EventSubscriber sub;
+			sub.When(evt, handler( ));
+			std::this_thread::yield( );
+		}
+		evt.Collect( );
+		++rounds;
+	}
+
+	running.store(false);
+	audio.join( );
+
+	Check(corrupt.load( ) == 0, "a handler ran after its snapshot was deleted");
+	Check(calls.load( ) > 0, "the dispatching thread made no calls");
+
+	/* a subscriber removes its handlers from the event when it goes away */
+	std::atomic<unsigned> before(0), after(0);
+	evt = [&](unsigned) { before.fetch_add(1); };
+	{
+		EventSubscriber sub;
+		sub.When(evt, [&](unsigned) { after.fetch_add(1); });
+		evt(0);
+	}
+	evt(1);
+	Check(before.load( ) == 2 && after.load( ) == 1, "subscriber handler outlived the subscriber");
+
+	std::printf("%u rounds, %u calls\n", rounds, calls.load( ));
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}
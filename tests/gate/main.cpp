@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* a simulated audio thread enters the buffer switch gate as fast as it can while a control
+   thread locks it repeatedly, recursively and from inside a buffer switch; no buffer switch
+   may run while the gate is held, and every one that is turned away must be counted. Then
+   the interleavings where a buffer switch locks its gate while a control thread waits for
+   it, and while another buffer switch sharing the gate has come and gone, must not hang */
+
+/* runs an interleaving on its own thread; a hang can not be joined, so it ends the test */
+template <typename FN> static void Watchdog(const char *what, FN fn) {
+	std::atomic<bool> done(false);
+	std::thread t([&]( ) { fn( ); done.store(true); });
+	auto limit = std::chrono::steady_clock::now( ) + std::chrono::seconds(2);
+	while (!done.load( ) && std::chrono::steady_clock::now( ) < limit) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	if (!done.load( )) {
+		std::fprintf(stderr, "FAIL %s: deadlock\n", what);
+		std::_Exit(1);
+	}
+	t.join( );
+}
+
+static void LockInsideWhileControlWaits( ) {
+	BufferSwitchGate gate;
+	std::atomic<bool> controlLocked(false);
+	std::atomic<int> step(0);
+	std::thread control;
+	{
+		BufferSwitchGate::Entry entry(&gate);
+		control = std::thread([&]( ) {
+			step.store(1);
+			std::lock_guard<BufferSwitchGate> lock(gate);
+			controlLocked.store(true);
+		});
+		while (step.load( ) == 0) std::this_thread::yield( );
+		/* let the control thread close the gate and start waiting */
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		Check(!controlLocked.load( ), "the control thread locked the gate with a buffer switch inside");
+		{
+			/* as when the callback closes its own device */
+			std::lock_guard<BufferSwitchGate> lock(gate);
+			Check(!controlLocked.load( ), "the control thread held the gate with the buffer switch");
+		}
+	}
+	control.join( );
+	Check(controlLocked.load( ), "the control thread locked the gate after the buffer switch left");
+}
+
+static void LockInsideSharedGate( ) {
+	BufferSwitchGate gate;
+	std::atomic<int> step(0);
+	std::thread other([&]( ) {
+		while (step.load( ) != 1) std::this_thread::yield( );
+		{
+			/* a second device entering and leaving the shared gate */
+			BufferSwitchGate::Entry entry(&gate);
+			Check((bool)entry, "the second buffer switch entered the open gate");
+		}
+		step.store(2);
+		while (step.load( ) != 3) std::this_thread::yield( );
+		BufferSwitchGate::Entry entry(&gate);
+		Check(!entry, "a buffer switch entered a gate locked from inside another");
+		step.store(4);
+	});
+
+	{
+		BufferSwitchGate::Entry entry(&gate);
+		step.store(1);
+		while (step.load( ) != 2) std::this_thread::yield( );
+		std::lock_guard<BufferSwitchGate> lock(gate);
+		step.store(3);
+		while (step.load( ) != 4) std::this_thread::yield( );
+	}
+	other.join( );
+}
+
+int main( ) {
+	BufferSwitchGate gate;
+	std::atomic<bool> running(true), held(false), lockInside(false);
+	std::atomic<unsigned> entered(0), skipped(0), overlaps(0), lockedInside(0);
+
+	std::thread audio([&]( ) {
+		while (running.load( )) {
+			BufferSwitchGate::Entry entry(&gate);
+			if (!entry) {
+				skipped.fetch_add(1);
+				continue;
+			}
+			entered.fetch_add(1);
+			if (held.load( )) overlaps.fetch_add(1);
+			if (lockInside.exchange(false)) {
+				/* as when a handler closes its own device */
+				std::lock_guard<BufferSwitchGate> lock(gate);
+				lockedInside.fetch_add(1);
+			}
+		}
+	});
+
+	auto end = std::chrono::steady_clock::now( ) + std::chrono::milliseconds(500);
+	unsigned rounds = 0;
+	while (std::chrono::steady_clock::now( ) < end) {
+		{
+			std::lock_guard<BufferSwitchGate> outer(gate);
+			std::lock_guard<BufferSwitchGate> inner(gate);
+			held.store(true);
+			std::this_thread::yield( );
+			held.store(false);
+		}
+		if (rounds++ % 64 == 0) lockInside.store(true);
+		std::this_thread::yield( );
+	}
+
+	running.store(false);
+	audio.join( );
+
+	Check(overlaps.load( ) == 0, "a buffer switch ran while the gate was held");
+	Check(entered.load( ) > 0, "no buffer switch entered the gate");
+	Check(gate.GetMissedBufferSwitches( ) == skipped.load( ), "missed buffer switches were not counted");
+	Check(lockedInside.load( ) > 0, "the gate was never locked from inside a buffer switch");
+
+	std::printf("%u rounds, %u buffer switches, %u missed, %u locked inside\n",
+		rounds, entered.load( ), skipped.load( ), lockedInside.load( ));
+
+	Watchdog("lock inside a buffer switch while a control thread waits", LockInsideWhileControlWaits);
+	Watchdog("lock inside a buffer switch on a shared gate", LockInsideSharedGate);
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "pad.h"
+
+using namespace PAD;
+
+/* process cpu time per JACK cycle of interleaved and planar streams, with a callback that
+   only writes silence. Run against a dummy driver server, for example
+     jackd -p 2048 -d dummy -r 48000 -p 64
+   The planar float stream hands the port buffers to the callback as they are */
+
+static double CpuSeconds( ) {
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double Measure(AudioDevice& dev, unsigned channels, bool planar, double seconds) {
+	std::atomic<unsigned> cycles(0);
+	dev.BufferSwitch = [&](IO io) {
+		unsigned outs = io.config.GetNumStreamOutputs( );
+		if (io.outputChannels) {
+			for (unsigned c = 0; c < outs; ++c) for (unsigned i = 0; i < io.numFrames; ++i) io.outputChannels[c][i] = 0.f;
+		} else {
+			for (unsigned i = 0; i < outs * io.numFrames; ++i) io.output[i] = 0.f;
+		}
+		cycles++;
+	};
+
+	auto conf = AudioStreamConfiguration(dev.DefaultStereo( ).GetSampleRate( )).Inputs(ChannelRange(0, channels)).Outputs(ChannelRange(0, channels));
+	if (planar) conf = conf.Planar( );
+	dev.Open(conf);
+
+	/* let the graph settle before measuring */
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	unsigned c0 = cycles;
+	double t0 = CpuSeconds( );
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+	double t1 = CpuSeconds( );
+	unsigned c1 = cycles;
+	dev.Close( );
+
+	/* microseconds of cpu per cycle */
+	return c1 > c0 ? (t1 - t0) * 1e6 / (c1 - c0) : 0;
+}
+
+int main( ) {
+	Session session(false);
+	try {
+		session.InitializeHostAPI("jack");
+	} catch (Error& e) {
+		std::fprintf(stderr, "%s\n", e.what( ));
+		return 1;
+	}
+	auto dev = session.FindDevice("jack", ".*");
+	if (dev == session.end( )) {
+		std::fprintf(stderr, "no JACK server running\n");
+		return 1;
+	}
+
+	std::printf("%8s %12s %12s\n", "channels", "interleaved", "planar");
+	for (unsigned channels : { 2u, 8u, 32u, 64u, 65u, 128u, 256u }) {
+		double interleaved = Measure(*dev, channels, false, 3);
+		double planar = Measure(*dev, channels, true, 3);
+		std::printf("%8u %12.2f %12.2f\n", channels, interleaved, planar);
+	}
+	std::printf("(process cpu microseconds per cycle)\n");
+	return 0;
+}
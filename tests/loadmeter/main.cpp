@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* feeds known cycle times to the DSP load meter and checks the smoothed load, the peak
+   and the histogram it reports, and the peak while another thread reads it */
+
+int main( ) {
+	DSPLoadMeter meter;
+	const double period = 32 / 48000.0;
+	uint64_t counts[DSPLoadMeter::HistogramBins];
+
+	meter.GetHistogram(counts);
+	for (auto c : counts) Check(c == 0, "a new meter has an empty histogram");
+	Check(meter.GetLoad( ) == 0 && meter.GetPeakLoad( ) == 0, "a new meter reads zero");
+
+	/* a second of cycles at half load converges on it */
+	for (int i = 0; i < 1500; ++i) meter.Record(period * 0.5, period);
+	Check(std::fabs(meter.GetLoad( ) - 0.5) < 1e-3, "smoothed load converges");
+	Check(std::fabs(meter.GetPeakLoad( ) - 0.5) < 1e-9, "peak of constant cycles");
+	Check(meter.GetPeakLoad( ) == 0, "reading the peak clears it");
+
+	/* a single overrun moves the peak but barely the smoothed load */
+	meter.Record(period * 1.5, period);
+	Check(std::fabs(meter.GetPeakLoad( ) - 1.5) < 1e-9, "peak of an overrun");
+	Check(meter.GetLoad( ) < 0.52, "one cycle is smoothed");
+
+	meter.Record(period * 0.02, period);
+	meter.Record(period * 0.99, period);
+	meter.GetHistogram(counts);
+	Check(counts[10] == 1500, "half load cycles fall in the 50% bin");
+	Check(counts[0] == 1, "light cycles fall in the first bin");
+	Check(counts[DSPLoadMeter::HistogramBins - 2] == 1, "cycles just under the period fall in the last regular bin");
+	Check(counts[DSPLoadMeter::HistogramBins - 1] == 1, "overruns fall in the last bin");
+
+	meter.ClearHistogram( );
+	meter.GetHistogram(counts);
+	for (auto c : counts) Check(c == 0, "clearing empties the histogram");
+
+	{
+		/* the audio thread records while a meter display takes the peak */
+		std::atomic<bool> done(false);
+		std::thread audio([&]( ) {
+			for (int i = 0; i < 200000; ++i) meter.Record(period * (i % 1000 == 999 ? 3.0 : (i % 9 + 1) * 0.1), period);
+			done.store(true);
+		});
+		double worst = 0;
+		bool bounded = true;
+		while (done.load( ) == false) {
+			double p = meter.GetPeakLoad( );
+			bounded = bounded && p <= 3.0 + 1e-9;
+			worst = std::max(worst, p);
+		}
+		audio.join( );
+		worst = std::max(worst, meter.GetPeakLoad( ));
+		Check(bounded && std::fabs(worst - 3.0) < 1e-9, "peak read while recording");
+	}
+
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* sends a ramp from one device of a loopback pair, returns it from the other and checks that it
+   comes back exactly two latencies later, in float and in planar double streams, with the
+   buffer times on the clock of the pair; then runs the real time pair and checks that both
+   devices cycle on the same clock */
+
+/* exact in float and double, and never repeating within the latency */
+static float Ramp(uint64_t frame, unsigned channel) {
+	float v = float(frame % 4096 + 1) / 8192.f;
+	return channel ? -v : v;
+}
+
+static int64_t Time(uint64_t frame) {
+	return int64_t(frame * 1e6 / 48000.0 + 0.5);
+}
+
+static void RoundTrip(AudioDevice& a, AudioDevice& b, const AudioStreamConfiguration& returnConfig, unsigned latency, unsigned buffers) {
+	std::atomic<unsigned> sent(0), ended(0);
+	std::atomic<bool> done(false);
+	unsigned returned = 0, received = 0, mistimed = 0, missing = 0;
+	uint64_t aFrame = 0, bFrame = 0;
+
+	a.BufferSwitch = [&](IO io) {
+		if (io.input == nullptr || io.output == nullptr) { missing++; return; }
+		if (done.load( ) == false) {
+			if (io.inputBufferTime.count( ) != Time(aFrame) || io.outputBufferTime.count( ) != Time(aFrame + latency)) mistimed++;
+			for (unsigned i(0); i < io.numFrames; ++i) for (unsigned c(0); c < 2; ++c) {
+				uint64_t frame = aFrame + i;
+				float expected = frame >= 2 * latency ? Ramp(frame - 2 * latency, c) : 0.f;
+				if (io.input[i * 2 + c] == expected) returned++;
+			}
+			if (++sent == buffers) done.store(true);
+		}
+		for (unsigned i(0); i < io.numFrames; ++i) for (unsigned c(0); c < 2; ++c) io.output[i * 2 + c] = Ramp(aFrame + i, c);
+		aFrame += io.numFrames;
+	};
+
+	bool planar = returnConfig.IsPlanar( ), wide = returnConfig.GetCanonicalFormat( ) == CanonicalFormat::Float64;
+	b.BufferSwitch = [&](IO io) {
+		if (done.load( )) return;
+		if (io.inputBufferTime.count( ) != Time(bFrame) || io.outputBufferTime.count( ) != Time(bFrame + latency)) mistimed++;
+		for (unsigned c(0); c < 2; ++c) for (unsigned i(0); i < io.numFrames; ++i) {
+			double in, expected = bFrame + i >= latency ? Ramp(bFrame + i - latency, c) : 0.0;
+			if (planar && wide) {
+				if (io.inputChannels64 == nullptr || io.outputChannels64 == nullptr) { missing++; return; }
+				in = io.outputChannels64[c][i] = io.inputChannels64[c][i];
+			} else {
+				if (io.input == nullptr || io.output == nullptr) { missing++; return; }
+				in = io.output[i * 2 + c] = io.input[i * 2 + c];
+			}
+			if (in == expected) received++;
+		}
+		bFrame += io.numFrames;
+	};
+
+	a.StreamDidEnd = [&]( ) { ended++; };
+	b.StreamDidEnd = [&]( ) { ended++; };
+
+	auto begin = std::chrono::steady_clock::now( );
+	b.Open(returnConfig);
+	a.Open(a.DefaultStereo( ));
+	auto limit = begin + std::chrono::seconds(60);
+	while (done.load( ) == false && std::chrono::steady_clock::now( ) < limit) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now( ) - begin;
+	a.Close( );
+	b.Close( );
+
+	unsigned samples = buffers * 64 * 2;
+	Check(done.load( ), "the free running pair cycles");
+	Check(missing == 0, "stream buffers");
+	Check(mistimed == 0, "buffer times follow the clock of the pair");
+	Check(returned == samples, "the ramp returns after two latencies");
+	Check(received + 64 * 2 >= samples, "the ramp arrives after one latency");
+	Check(ended.load( ) == 2, "StreamDidEnd on Close");
+	Check(a.GetXruns( ).GetCount( ) == 0 && b.GetXruns( ).GetCount( ) == 0, "no xruns on a free running clock");
+	std::printf("%u buffers round trip in %.3f s, %.0fx real time\n", buffers, elapsed.count( ), buffers * 64 / 48000.0 / elapsed.count( ));
+}
+
+int main( ) {
+	AddLoopbackPair("chain a", "chain b", 2, 100, 48000.0, 64, LoopbackClock::FreeRunning);
+	AddLoopbackPair("short a", "short b", 2, 10, 48000.0, 64, LoopbackClock::FreeRunning);
+
+	Session session(false);
+	session.InitializeHostAPI("loopback");
+	auto chainA = session.FindDevice("loopback", "chain a"), chainB = session.FindDevice("loopback", "chain b");
+	auto shortA = session.FindDevice("loopback", "short a"), shortB = session.FindDevice("loopback", "short b");
+	auto rtA = session.FindDevice("loopback", "loopback a"), rtB = session.FindDevice("loopback", "loopback b");
+	Check(chainA != session.end( ) && chainB != session.end( ) && shortA != session.end( ) && shortB != session.end( ) &&
+		  rtA != session.end( ) && rtB != session.end( ), "loopback pairs are published");
+	if (failures) return 1;
+	Check(chainA->GetNumInputs( ) == 2 && chainB->GetNumOutputs( ) == 2, "channels of an added pair");
+	Check(chainA->GetDeviceTimeCallback( ) == nullptr && chainA->DeviceTimeNow( ).count( ) == 0, "the clock of the pair is read through DeviceTimeNow");
+
+	RoundTrip(*chainA, *chainB, chainB->DefaultStereo( ).Canonical(CanonicalFormat::Float64).Planar( ), 100, 4000);
+	RoundTrip(*chainA, *chainB, chainB->DefaultStereo( ), 100, 1000);
+	/* a latency shorter than a buffer is one buffer */
+	RoundTrip(*shortA, *shortB, shortB->DefaultStereo( ), 64, 500);
+
+	bool refused = false;
+	try {
+		chainA->Open(chainA->DefaultStereo( ).SampleRate(44100.0));
+	} catch (SoftError&) {
+		refused = true;
+	}
+	Check(refused, "a pair runs at its own sample rate");
+
+	{
+		/* the real time pair: both devices see the same buffer times while they both stream */
+		std::vector<int64_t> aTimes, bTimes;
+		aTimes.reserve(4096);
+		bTimes.reserve(4096);
+		unsigned mistimed = 0;
+		auto record = [&](std::vector<int64_t>& times, IO io) {
+			/* both times are rounded to microseconds */
+			if (std::abs((io.outputBufferTime - io.inputBufferTime).count( ) - Time(64)) > 1) mistimed++;
+			if (times.size( ) < times.capacity( )) times.push_back(io.inputBufferTime.count( ));
+			if (io.input && io.output) std::copy(io.input, io.input + io.numFrames * 2, io.output);
+		};
+		rtA->BufferSwitch = [&](IO io) { record(aTimes, io); };
+		rtB->BufferSwitch = [&](IO io) { record(bTimes, io); };
+
+		rtA->Open(rtA->DefaultStereo( ));
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		rtB->Open(rtB->DefaultStereo( ));
+		std::this_thread::sleep_for(std::chrono::milliseconds(150));
+		rtB->Close( );
+		rtA->Close( );
+
+		Check(aTimes.size( ) > 20 && bTimes.size( ) > 10, "the real time clock drives both devices");
+		Check(aTimes.size( ) > bTimes.size( ), "a device that starts later joins the running clock");
+		Check(mistimed == 0, "output times are a latency after input times");
+		Check(std::is_sorted(aTimes.begin( ), aTimes.end( )) && std::adjacent_find(aTimes.begin( ), aTimes.end( )) == aTimes.end( ), "buffer times advance");
+		unsigned shared = 0;
+		for (auto t : bTimes) if (std::binary_search(aTimes.begin( ), aTimes.end( ), t)) shared++;
+		Check(shared == bTimes.size( ), "both devices cycle on the clock of the pair");
+		std::printf("%u and %u cycles in real time, %llu xruns\n", unsigned(aTimes.size( )), unsigned(bTimes.size( )), (unsigned long long)rtA->GetXruns( ).GetCount( ));
+	}
+
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <cmath>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* streams the devices of the null host API in each canonical format and checks the buffers,
+   the spacing of the buffer timestamps, the cycle timings and that the timer stops when the
+   stream is suspended, including from its own buffer switch */
+
+static void Stream(AudioDevice& dev, const AudioStreamConfiguration& cfg) {
+	dev.Open(cfg);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	dev.Suspend( );
+}
+
+int main( ) {
+	AddNullDevice("sine", 1, 2, 48000.0, 32, NullSignal::Sine);
+
+	Session session(false);
+	session.InitializeHostAPI("null");
+	auto sine = session.FindDevice("null", "sine");
+	auto silent = session.FindDevice("null", "^null$");
+	Check(sine != session.end( ) && silent != session.end( ), "null devices are published");
+	if (failures) return 1;
+	Check(sine->GetNumInputs( ) == 1 && sine->GetNumOutputs( ) == 2, "channels of an added device");
+
+	{
+		std::atomic<unsigned> cycles(0), missing(0), ended(0);
+		std::atomic<int64_t> shortestInterval(INT64_MAX);
+		float peak = 0;
+		std::chrono::microseconds last(0);
+		sine->BufferSwitch = [&](IO io) {
+			if (io.input == nullptr || io.output == nullptr || io.numFrames != 32) { missing++; return; }
+			for (unsigned i(0); i < io.numFrames; ++i) peak = std::max(peak, std::fabs(io.input[i]));
+			if (last.count( )) shortestInterval.store(std::min<int64_t>(shortestInterval.load( ), (io.inputBufferTime - last).count( )));
+			last = io.inputBufferTime;
+			cycles++;
+		};
+		sine->StreamDidEnd = [&]( ) { ended++; };
+
+		Stream(*sine, sine->DefaultAllChannels( ).SampleRate(48000.0));
+		unsigned afterSuspend = cycles.load( );
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		Check(missing.load( ) == 0, "float stream buffers");
+		Check(cycles.load( ) > 10, "the timer drives the buffer switch");
+		Check(cycles.load( ) == afterSuspend, "no buffer switch after Suspend");
+		Check(ended.load( ) == 1, "StreamDidEnd on Suspend");
+		Check(peak > 0.45f && peak < 0.51f, "sine on the inputs");
+		Check(shortestInterval.load( ) >= 666, "buffer timestamps are a period apart");
+		Check(sine->GetCycleTimings( ).GetCount( ) == cycles.load( ), "every cycle is timed");
+		std::printf("%u cycles in 200 ms, %llu xruns\n", cycles.load( ), (unsigned long long)sine->GetXruns( ).GetCount( ));
+		sine->Close( );
+	}
+
+	{
+		std::atomic<unsigned> cycles(0), missing(0), noisy(0);
+		silent->BufferSwitch = [&](IO io) {
+			if (io.input16 == nullptr || io.output16 == nullptr) { missing++; return; }
+			for (unsigned i(0); i < io.numFrames * 2; ++i) if (io.input16[i]) noisy++;
+			cycles++;
+		};
+		Stream(*silent, silent->DefaultStereo( ).Canonical(CanonicalFormat::Int16));
+		Check(missing.load( ) == 0 && cycles.load( ) > 0, "int16 stream buffers");
+		Check(noisy.load( ) == 0, "silence on the inputs");
+	}
+
+	{
+		std::atomic<unsigned> cycles(0), missing(0);
+		silent->BufferSwitch = [&](IO io) {
+			if (io.inputChannels64 == nullptr || io.outputChannels64 == nullptr) { missing++; return; }
+			io.outputChannels64[1][io.numFrames - 1] = io.inputChannels64[0][0];
+			cycles++;
+		};
+		Stream(*silent, silent->DefaultStereo( ).Canonical(CanonicalFormat::Float64).Planar( ));
+		Check(missing.load( ) == 0 && cycles.load( ) > 0, "planar float64 stream buffers");
+	}
+
+	{
+		/* suspended from its own buffer switch, then resumed from the control thread */
+		std::atomic<unsigned> cycles(0);
+		silent->BufferSwitch = [&](IO) {
+			if (++cycles == 5) silent->Suspend( );
+		};
+		silent->Open(silent->DefaultStereo( ));
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		Check(cycles.load( ) == 5, "suspended from the buffer switch");
+		silent->Resume( );
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		Check(cycles.load( ) > 5, "resumed after suspending itself");
+		silent->Close( );
+	}
+
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}
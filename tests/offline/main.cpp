@@ -0,0 +1,148 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* renders through the offline host API from memory and wave file sources and checks the
+   rendered samples, the sample clock in the buffer times, the render length and that a long
+   render runs far faster than real time */
+
+static std::atomic<unsigned> ended(0);
+
+/* opens the stream and waits for the render to run out */
+static void Render(AudioDevice& dev, const AudioStreamConfiguration& cfg) {
+	unsigned before = ended.load( );
+	dev.Open(cfg);
+	auto limit = std::chrono::steady_clock::now( ) + std::chrono::seconds(120);
+	while (ended.load( ) == before && std::chrono::steady_clock::now( ) < limit) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	Check(ended.load( ) == before + 1, "StreamDidEnd when the render runs out");
+	dev.Close( );
+	Check(ended.load( ) == before + 1, "StreamDidEnd is raised once");
+}
+
+static std::vector<float> Ramp(unsigned frames, unsigned channels) {
+	std::vector<float> samples(frames * channels);
+	for (unsigned i(0); i < samples.size( ); ++i) samples[i] = float(i % 1000) / 1000.f - 0.5f;
+	return samples;
+}
+
+int main( ) {
+	AddOfflineDevice("render", 2, 2, 48000.0, 256);
+
+	Session session(false);
+	session.InitializeHostAPI("offline");
+	auto dev = session.FindDevice("offline", "render");
+	Check(dev != session.end( ), "offline device is published");
+	if (failures) return 1;
+	dev->StreamDidEnd = []( ) { ended++; };
+
+	/* half the gain, with the buffer times checked against the frames rendered before */
+	uint64_t framesBefore = 0;
+	unsigned buffers = 0, mistimed = 0;
+	dev->BufferSwitch = [&](IO io) {
+		auto expected = int64_t(framesBefore * 1e6 / io.config.GetSampleRate( ) + 0.5);
+		if (io.inputBufferTime.count( ) != expected || io.outputBufferTime != io.inputBufferTime) mistimed++;
+		if (io.input16) for (unsigned i(0); i < io.numFrames * 2; ++i) io.output16[i] = int16_t(io.input16[i] / 2);
+		else for (unsigned i(0); i < io.numFrames * 2; ++i) io.output[i] = io.input[i] * 0.5f;
+		framesBefore += io.numFrames;
+		buffers++;
+	};
+
+	{
+		auto input = Ramp(1000, 2);
+		std::vector<float> output;
+		SetOfflineRender(*dev, MemorySource(input, 2), MemorySink(output, 2));
+		Render(*dev, dev->DefaultStereo( ));
+		Check(buffers == 4 && framesBefore == 1000, "a partial buffer ends the render");
+		Check(mistimed == 0, "buffer times follow the sample clock");
+		Check(output.size( ) == input.size( ), "the sink receives every frame");
+		bool same = output.size( ) == input.size( );
+		for (unsigned i(0); same && i < input.size( ); ++i) same = output[i] == input[i] * 0.5f;
+		Check(same, "rendered samples");
+		Check(dev->DeviceTimeNow( ).count( ) == int64_t(1000 * 1e6 / 48000 + 0.5), "device time at the end of the render");
+		Check(dev->GetDeviceTimeCallback( ) == nullptr, "the sample clock is read through DeviceTimeNow");
+	}
+
+	{
+		framesBefore = buffers = 0;
+		std::vector<float> output;
+		SetOfflineRender(*dev, MemorySource(Ramp(1000, 2), 2), MemorySink(output, 2), 300);
+		Render(*dev, dev->DefaultStereo( ).Canonical(CanonicalFormat::Int16).SampleRate(44100.0));
+		Check(framesBefore == 300 && output.size( ) == 600, "the render stops at its length");
+	}
+
+	{
+		/* a wave file written by one render and read by the next */
+		const char *path = "pad_test_offline.wav";
+		framesBefore = buffers = 0;
+		auto input = Ramp(5000, 2);
+		SetOfflineRender(*dev, MemorySource(input, 2), WaveFileSink(path, 2, 48000.0));
+		Render(*dev, dev->DefaultStereo( ));
+
+		/* float data needs the 18 byte fmt chunk and a fact chunk with the frame count */
+		unsigned char header[58] = { 0 };
+		FILE *file = std::fopen(path, "rb");
+		size_t headerRead = file ? std::fread(header, 1, sizeof(header), file) : 0;
+		if (file) std::fclose(file);
+		auto field = [&](unsigned offset) { return uint32_t(header[offset]) | uint32_t(header[offset + 1]) << 8 | uint32_t(header[offset + 2]) << 16 | uint32_t(header[offset + 3]) << 24; };
+		Check(headerRead == sizeof(header) && field(16) == 18 && header[36] == 0 && header[37] == 0, "wave file fmt chunk has cbSize");
+		Check(std::memcmp(header + 38, "fact", 4) == 0 && field(42) == 4 && field(46) == 5000, "wave file fact chunk has the frame count");
+		Check(std::memcmp(header + 50, "data", 4) == 0 && field(54) == 5000 * 2 * 4 && field(4) == 50 + 5000 * 2 * 4, "wave file sizes are patched");
+
+		framesBefore = buffers = 0;
+		std::vector<float> output;
+		SetOfflineRender(*dev, WaveFileSource(path), MemorySink(output, 2));
+		Render(*dev, dev->DefaultStereo( ));
+		bool same = output.size( ) == input.size( );
+		for (unsigned i(0); same && i < input.size( ); ++i) same = output[i] == input[i] * 0.25f;
+		Check(same, "wave file round trip");
+		std::remove(path);
+	}
+
+	{
+		/* ten minutes of stereo from a generator into a sink that only counts */
+		const unsigned minutes = 10;
+		framesBefore = buffers = 0;
+		uint64_t generated = 0, received = 0;
+		OfflineSource generator = [&](float* const* channels, unsigned count, unsigned frames) {
+			for (unsigned c(0); c < count; ++c) for (unsigned i(0); i < frames; ++i) channels[c][i] = float((generated + i) % 100) * 0.01f;
+			generated += frames;
+			return frames;
+		};
+		OfflineSink counter = [&](const float* const*, unsigned, unsigned frames) { received += frames; };
+		SetOfflineRender(*dev, generator, counter, uint64_t(minutes) * 60 * 48000);
+
+		auto begin = std::chrono::steady_clock::now( );
+		Render(*dev, dev->DefaultStereo( ));
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now( ) - begin;
+		Check(received == uint64_t(minutes) * 60 * 48000, "long render length");
+		Check(mistimed == 0, "buffer times of a long render");
+		Check(elapsed.count( ) < minutes * 60 / 10.0, "renders at least ten times faster than real time");
+		std::printf("%u minutes rendered in %.2f s, %.0fx real time\n", minutes, elapsed.count( ), minutes * 60 / elapsed.count( ));
+	}
+
+	{
+		/* planar channels convert one at a time, so their routes are mixed across the calls */
+		dev->BufferSwitch = [](IO io) {
+			for (unsigned c(0); c < 2; ++c) std::memcpy(io.outputChannels[c], io.inputChannels[c], io.numFrames * sizeof(float));
+		};
+		auto input = Ramp(1000, 2);
+		std::vector<float> output;
+		SetOfflineRender(*dev, MemorySource(input, 2), MemorySink(output, 2));
+		Render(*dev, dev->DefaultStereo( ).Planar( ).InputRoute(1, 0, 0.5f).OutputRoute(0, 1).OutputGain(0, 2.f));
+		bool same = output.size( ) == input.size( );
+		for (unsigned i(0); same && i < input.size( ); i += 2) same = output[i] == input[i] && output[i + 1] == input[i] * 0.5f;
+		Check(same, "routes of a planar stream");
+	}
+
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}
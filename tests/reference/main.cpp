@@ -0,0 +1,372 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <limits>
+#include <vector>
+#include <random>
+#include <type_traits>
+#include "pad_converters.h"
+#include "pad_samples.h"
+
+using namespace PAD::Converter;
+
+/* randomized check of every kernel table against a scalar reference of the conversion:
+   random channel counts, frame counts, strides and buffer offsets, and sample values that
+   include the edges of the nominal range, ties, denormals, infinities and NaN. Usage:
+   pad_test_reference [seed [cases]] */
+
+static int failures = 0;
+
+struct FormatInfo {
+	HostFormat fmt;
+	unsigned bytes;
+	bool isFloat;
+	int32_t minus, plus;
+	int shift;
+	bool bigEndian;
+};
+
+static const FormatInfo formats[] = {
+#define PAD_TEST_FORMAT(NAME, HOST, MINUS, PLUS, SHIFT, BIGENDIAN) \
+	{ HostFormat::NAME, sizeof(HOST), std::is_floating_point<HOST>::value, MINUS, PLUS, SHIFT, BIGENDIAN },
+	PAD_HOST_FORMATS(PAD_TEST_FORMAT)
+#undef PAD_TEST_FORMAT
+};
+
+static void Store(const FormatInfo& f, uint8_t *dst, uint64_t u) {
+	for (unsigned i = 0; i < f.bytes; ++i) dst[f.bigEndian ? f.bytes - 1 - i : i] = uint8_t(u >> (8 * i));
+}
+
+static uint64_t Load(const FormatInfo& f, const uint8_t *src) {
+	uint64_t u = 0;
+	for (unsigned i = 0; i < f.bytes; ++i) u |= uint64_t(src[f.bigEndian ? f.bytes - 1 - i : i]) << (8 * i);
+	return u;
+}
+
+/* canonical to host: the canonical sample is taken to float, scaled to the nominal range,
+   clipped with NaN going to the positive bound, and rounded to nearest even */
+static void Quantize(const FormatInfo& f, float x, uint8_t *dst) {
+	if (f.isFloat) {
+		float y = std::isnan(x) ? 1.f : std::min(std::max(x, -1.f), 1.f);
+		uint64_t u = 0;
+		if (f.bytes == 8) {
+			double d = y;
+			std::memcpy(&u, &d, 8);
+		} else std::memcpy(&u, &y, 4);
+		Store(f, dst, u);
+		return;
+	}
+	float v = x * float(-f.minus);
+	v = std::isnan(v) ? float(f.plus) : std::min(std::max(v, float(f.minus)), float(f.plus));
+	int32_t r = int32_t(std::nearbyint(v));
+	Store(f, dst, uint64_t(uint32_t(r) << f.shift));
+}
+
+/* host to canonical: integers are sign extended from the sample width and scaled in float */
+static float Expand(const FormatInfo& f, const uint8_t *src) {
+	uint64_t u = Load(f, src);
+	if (f.isFloat && f.bytes == 8) {
+		double d;
+		std::memcpy(&d, &u, 8);
+		return float(d);
+	} else if (f.isFloat) {
+		float x;
+		uint32_t u32 = uint32_t(u);
+		std::memcpy(&x, &u32, 4);
+		return x;
+	}
+	unsigned unused = 32 - 8 * f.bytes;
+	int32_t raw = int32_t(uint32_t(u) << unused) >> unused;
+	return float(raw) * float(-1.0 / (double(f.minus) * double(1 << f.shift)));
+}
+
+/* significant bits of a full scale sample of an integer host format */
+static int HostBits(const FormatInfo& f) {
+	int bits = 1;
+	for (int64_t range = -int64_t(f.minus); range > 1; range /= 2) ++bits;
+	return bits + f.shift;
+}
+
+/* integer canonical to host: integer hosts take the top bits of the canonical sample,
+   truncating, and float hosts see it scaled to the nominal range */
+template <typename CANON> static void QuantizeInt(const FormatInfo& f, CANON v, uint8_t *dst) {
+	const int bits = 8 * sizeof(CANON);
+	if (f.isFloat) {
+		double x = double(v) / double(1u << (bits - 1));
+		uint64_t u = 0;
+		if (f.bytes == 8) std::memcpy(&u, &x, 8);
+		else {
+			float y = float(x);
+			uint32_t u32;
+			std::memcpy(&u32, &y, 4);
+			u = u32;
+		}
+		Store(f, dst, u);
+		return;
+	}
+	const int host = HostBits(f);
+	int32_t r = host > bits ? int32_t(uint32_t(int32_t(v)) << (host - bits)) : int32_t(v) >> (bits - host);
+	Store(f, dst, uint64_t(uint32_t(r)));
+}
+
+/* host to integer canonical: integer hosts are sign extended, clipped to the nominal range
+   when the container is wider, and shifted to the canonical width; float hosts are scaled,
+   clipped with NaN going to the positive bound and rounded to nearest even */
+template <typename CANON> static CANON ExpandInt(const FormatInfo& f, const uint8_t *src) {
+	const int bits = 8 * sizeof(CANON);
+	const double scale = double(1u << (bits - 1));
+	uint64_t u = Load(f, src);
+	if (f.isFloat) {
+		double x;
+		if (f.bytes == 8) std::memcpy(&x, &u, 8);
+		else {
+			float y;
+			uint32_t u32 = uint32_t(u);
+			std::memcpy(&y, &u32, 4);
+			x = y;
+		}
+		x = std::isnan(x) ? scale - 1 : std::min(std::max(x * scale, -scale), scale - 1);
+		return CANON(std::nearbyint(x));
+	}
+	unsigned unused = 32 - 8 * f.bytes;
+	int32_t raw = int32_t(uint32_t(u) << unused) >> unused;
+	const int host = HostBits(f);
+	if (f.shift == 0 && int(8 * f.bytes) > host) raw = std::min(std::max(raw, f.minus), f.plus);
+	return CANON(host > bits ? raw >> (host - bits) : int32_t(uint32_t(raw) << (bits - host)));
+}
+
+static void Reference(const FormatInfo& f, float x, uint8_t *dst) { Quantize(f, x, dst); }
+static void Reference(const FormatInfo& f, double x, uint8_t *dst) { Quantize(f, float(x), dst); }
+static void Reference(const FormatInfo& f, int32_t x, uint8_t *dst) { QuantizeInt(f, x, dst); }
+static void Reference(const FormatInfo& f, int16_t x, uint8_t *dst) { QuantizeInt(f, x, dst); }
+
+template <typename CANON> static CANON Reference(const FormatInfo& f, const uint8_t *src, std::true_type) { return ExpandInt<CANON>(f, src); }
+template <typename CANON> static CANON Reference(const FormatInfo& f, const uint8_t *src, std::false_type) { return CANON(Expand(f, src)); }
+template <typename CANON> static CANON Reference(const FormatInfo& f, const uint8_t *src) {
+	return Reference<CANON>(f, src, std::is_integral<CANON>( ));
+}
+
+template <typename CANON> static const char* CanonicalName( ) {
+	return std::is_integral<CANON>::value ? (sizeof(CANON) == 4 ? "int32" : "int16") : (sizeof(CANON) == 8 ? "double" : "float");
+}
+
+template <typename T> static bool Same(T a, T b) {
+	return (std::isnan(a) && std::isnan(b)) || std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+/* canonical samples: the nominal range and a little beyond, ties between host steps, and
+   values every SIMD path must clip or pass through the same way the scalar one does */
+template <typename CANON> static CANON CanonicalSample(const FormatInfo& f, std::mt19937& rng, std::false_type) {
+	static const float specials[] = {
+		0.f, -0.f, 1.f, -1.f, 0.5f, -0.5f, 1.0000001f, -1.0000001f, 2.f, -2.f,
+		1e-40f, -1e-40f, FLT_MIN, -FLT_MIN, FLT_MAX, -FLT_MAX, 1e30f, -1e30f,
+		std::numeric_limits<float>::infinity( ), -std::numeric_limits<float>::infinity( ),
+		std::numeric_limits<float>::quiet_NaN( ), -std::numeric_limits<float>::quiet_NaN( )
+	};
+	switch (rng( ) % 8) {
+	case 0: return CANON(specials[rng( ) % (sizeof(specials) / sizeof(specials[0]))]);
+	case 1: {
+		/* halfway between two steps of the host format */
+		float unit = f.isFloat ? float(1 << 23) : float(-f.minus);
+		return CANON((float(int32_t(rng( ) % 2001) - 1000) + 0.5f) / unit);
+	}
+	case 2: return sizeof(CANON) == 8 ? CANON(1e-310) : CANON(0);
+	default: return CANON(std::uniform_real_distribution<float>(-1.25f, 1.25f)(rng));
+	}
+}
+
+/* integer canonical samples: the extremes, values on and just off the steps of the host
+   format, and random bit patterns */
+template <typename CANON> static CANON CanonicalSample(const FormatInfo& f, std::mt19937& rng, std::true_type) {
+	switch (rng( ) % 6) {
+	case 0: return rng( ) % 2 ? std::numeric_limits<CANON>::min( ) : std::numeric_limits<CANON>::max( );
+	case 1: return CANON(rng( ) % 3) - 1;
+	case 2: {
+		int down = 8 * int(sizeof(CANON)) - HostBits(f);
+		CANON v = CANON(rng( ));
+		return down > 0 ? CANON(int32_t(v) >> down << down) - CANON(rng( ) % 2) : v;
+	}
+	default: return CANON(rng( ));
+	}
+}
+
+template <typename CANON> static CANON CanonicalSample(const FormatInfo& f, std::mt19937& rng) {
+	return CanonicalSample<CANON>(f, rng, std::is_integral<CANON>( ));
+}
+
+/* host samples: random bit patterns for the integer formats, and random values with the
+   same specials for the float formats */
+static void RandomHostSample(const FormatInfo& f, uint8_t *dst, std::mt19937& rng) {
+	if (f.isFloat == false) {
+		Store(f, dst, (uint64_t(rng( )) << 32) | rng( ));
+		return;
+	}
+	double x;
+	switch (rng( ) % 6) {
+	case 0: x = std::numeric_limits<double>::quiet_NaN( ); break;
+	case 1: x = rng( ) % 2 ? std::numeric_limits<double>::infinity( ) : -std::numeric_limits<double>::infinity( ); break;
+	case 2: x = rng( ) % 2 ? 1e-40 : -1e-310; break;
+	default: x = std::uniform_real_distribution<double>(-2, 2)(rng); break;
+	}
+	uint64_t u = 0;
+	if (f.bytes == 8) std::memcpy(&u, &x, 8);
+	else {
+		float y = float(x);
+		uint32_t u32;
+		std::memcpy(&u32, &y, 4);
+		u = u32;
+	}
+	Store(f, dst, u);
+}
+
+static void Convert(const ChannelKernels& k, const float *interleaved, void **blocks, unsigned frames, unsigned channels, unsigned stride) {
+	k.DeInterleave(interleaved, blocks, frames, channels, stride);
+}
+
+static void Convert(const ChannelKernels& k, const double *interleaved, void **blocks, unsigned frames, unsigned channels, unsigned stride) {
+	k.DeInterleave64(interleaved, blocks, frames, channels, stride);
+}
+
+static void Convert(const ChannelKernels& k, float *interleaved, const void **blocks, unsigned frames, unsigned channels, unsigned stride) {
+	k.Interleave(interleaved, blocks, frames, channels, stride);
+}
+
+static void Convert(const ChannelKernels& k, double *interleaved, const void **blocks, unsigned frames, unsigned channels, unsigned stride) {
+	k.Interleave64(interleaved, blocks, frames, channels, stride);
+}
+
+static void Convert(const ChannelKernels& k, const int32_t *interleaved, void **blocks, unsigned frames, unsigned channels, unsigned stride) {
+	k.DeInterleaveInt32(interleaved, blocks, frames, channels, stride);
+}
+
+static void Convert(const ChannelKernels& k, const int16_t *interleaved, void **blocks, unsigned frames, unsigned channels, unsigned stride) {
+	k.DeInterleaveInt16(interleaved, blocks, frames, channels, stride);
+}
+
+static void Convert(const ChannelKernels& k, int32_t *interleaved, const void **blocks, unsigned frames, unsigned channels, unsigned stride) {
+	k.InterleaveInt32(interleaved, blocks, frames, channels, stride);
+}
+
+static void Convert(const ChannelKernels& k, int16_t *interleaved, const void **blocks, unsigned frames, unsigned channels, unsigned stride) {
+	k.InterleaveInt16(interleaved, blocks, frames, channels, stride);
+}
+
+static void Fail(const char *what, const FormatInfo& f, ConverterISA isa, const char *canonical, unsigned channels, unsigned frames, unsigned stride, unsigned offset, unsigned misalign) {
+	if (failures++ < 20) {
+		std::fprintf(stderr, "FAIL %s: %s/%s from %s, %u channels, %u frames, stride %u, offset %u, misalign %u\n",
+			what, GetName(f.fmt), GetName(isa), canonical, channels, frames, stride, offset, misalign);
+	}
+}
+
+template <typename CANON> static void TestCase(const FormatInfo& f, ConverterISA isa, std::mt19937& rng) {
+	const char *canonical = CanonicalName<CANON>( );
+	const unsigned guard = 64, line = 64;
+
+	/* mostly small channel counts, sometimes wider than any register bundle, with frame
+	   counts that leave every remainder and sometimes span several tiles */
+	const unsigned channels = rng( ) % 4 ? 1 + rng( ) % 20 : 1 + rng( ) % 80;
+	const unsigned frames = rng( ) % 4 ? rng( ) % 70 : rng( ) % 1200;
+	const unsigned stride = channels + (rng( ) % 3 ? 0 : rng( ) % 5);
+	const unsigned offset = rng( ) % 2 ? 0 : rng( ) % 8;
+	const unsigned misalign = rng( ) % 2 ? 0 : rng( ) % line;
+	auto& kernels(rng( ) % 2 ? GetChannelKernels(f.fmt, isa) : GetChannelKernels(f.fmt, isa, channels));
+
+	/* block buffers start at a cache line, plus the misalignment, and end with a guard */
+	std::vector<std::vector<uint8_t>> storage(channels, std::vector<uint8_t>(2 * line + frames * f.bytes + guard));
+	std::vector<void*> blocks(channels);
+	for (unsigned c = 0; c < channels; ++c) {
+		uintptr_t base = ((uintptr_t)storage[c].data( ) + line - 1) & ~uintptr_t(line - 1);
+		blocks[c] = (uint8_t*)base + misalign;
+	}
+
+	/* interleaved buffers start at a cache line, plus the offset in samples */
+	const CANON sentinel = CANON(-12345.f);
+	std::vector<CANON> interleavedStorage(offset + frames * stride + 2 * line, sentinel);
+	uintptr_t interleavedBase = ((uintptr_t)interleavedStorage.data( ) + line - 1) & ~uintptr_t(line - 1);
+	CANON *interleaved = (CANON*)interleavedBase + offset;
+
+	for (unsigned i = 0; i < frames * stride; ++i) interleaved[i] = CanonicalSample<CANON>(f, rng);
+	for (unsigned c = 0; c < channels; ++c) std::memset(blocks[c], 0xcd, frames * f.bytes + guard);
+
+	Convert(kernels, (const CANON*)interleaved, blocks.data( ), frames, channels, stride);
+
+	bool ok = true, guardOk = true;
+	uint8_t expected[8];
+	for (unsigned c = 0; c < channels && ok; ++c) {
+		const uint8_t *block = (const uint8_t*)blocks[c];
+		for (unsigned i = 0; i < frames; ++i) {
+			Reference(f, interleaved[i * stride + c], expected);
+			if (std::memcmp(expected, block + i * f.bytes, f.bytes)) {
+				std::fprintf(stderr, "  channel %u frame %u: %g gives %llx, expected %llx\n", c, i, double(interleaved[i * stride + c]),
+					(unsigned long long)Load(f, block + i * f.bytes), (unsigned long long)Load(f, expected));
+				ok = false;
+				break;
+			}
+		}
+		for (unsigned i = 0; i < guard; ++i) if (block[frames * f.bytes + i] != 0xcd) guardOk = false;
+	}
+	if (!ok) Fail("deinterleave", f, isa, canonical, channels, frames, stride, offset, misalign);
+	if (!guardOk) Fail("deinterleave wrote past the block end", f, isa, canonical, channels, frames, stride, offset, misalign);
+
+	for (unsigned c = 0; c < channels; ++c) {
+		for (unsigned i = 0; i < frames; ++i) RandomHostSample(f, (uint8_t*)blocks[c] + i * f.bytes, rng);
+	}
+	std::fill(interleavedStorage.begin( ), interleavedStorage.end( ), sentinel);
+
+	Convert(kernels, interleaved, (const void**)blocks.data( ), frames, channels, stride);
+
+	ok = true;
+	for (unsigned i = 0; i < frames && ok; ++i) {
+		for (unsigned c = 0; c < stride; ++c) {
+			CANON got = interleaved[i * stride + c];
+			CANON want = c < channels ? Reference<CANON>(f, (const uint8_t*)blocks[c] + i * f.bytes) : sentinel;
+			if (!Same(got, want)) {
+				std::fprintf(stderr, "  column %u frame %u: %g, expected %g\n", c, i, double(got), double(want));
+				ok = false;
+				break;
+			}
+		}
+	}
+	for (size_t i = 0; i < interleavedStorage.size( ); ++i) {
+		CANON *p = interleavedStorage.data( ) + i;
+		if (p >= interleaved && p < interleaved + frames * stride) continue;
+		if (*p != sentinel) ok = false;
+	}
+	if (!ok) Fail("interleave", f, isa, canonical, channels, frames, stride, offset, misalign);
+}
+
+int main(int argc, char **argv) {
+	const unsigned seed = argc > 1 ? unsigned(std::strtoul(argv[1], nullptr, 0)) : 20161018u;
+	const unsigned cases = argc > 2 ? unsigned(std::strtoul(argv[2], nullptr, 0)) : 64;
+	std::mt19937 rng(seed);
+	const size_t defaultThreshold = GetStreamingThreshold( ), defaultTiling = GetTilingThreshold( );
+
+	for (int i = 0; i < (int)ConverterISA::NumISAs; ++i) {
+		ConverterISA isa = (ConverterISA)i;
+		if (IsSupported(isa) == false) {
+			std::printf("%s not supported, skipped\n", GetName(isa));
+			continue;
+		}
+		for (auto& f : formats) {
+			for (unsigned n = 0; n < cases; ++n) {
+				/* streaming stores take their own path through the aligned deinterleave */
+				SetStreamingThreshold(rng( ) % 4 ? defaultThreshold : 0);
+				/* and so do frame tiles */
+				SetTilingThreshold(rng( ) % 2 ? defaultTiling : 0);
+				TestCase<float>(f, isa, rng);
+				TestCase<double>(f, isa, rng);
+				TestCase<int32_t>(f, isa, rng);
+				TestCase<int16_t>(f, isa, rng);
+			}
+		}
+		std::printf("%s checked\n", GetName(isa));
+	}
+	SetStreamingThreshold(defaultThreshold);
+	SetTilingThreshold(defaultTiling);
+
+	if (failures) std::fprintf(stderr, "%d failures with seed %u\n", failures, seed);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <limits>
+#include <vector>
+#include "pad_converters.h"
+
+using namespace PAD::Converter;
+
+/* compares cached and streaming stores when deinterleaving to device buffers of growing
+   size. Each cycle is followed by a pass over a working set standing in for the state of
+   the audio callback, which cached stores evict once the buffers outgrow the cache */
+
+static const HostFormat formats[] = { HostFormat::Int16LSB, HostFormat::Int32LSB, HostFormat::Float32LSB };
+
+static volatile float sink;
+
+static double Measure(const ChannelKernels& kernels, unsigned channels, unsigned frames, bool stream, std::vector<float>& workingSet) {
+	std::vector<float> interleaved(channels * frames, 0.25f);
+	std::vector<std::vector<int32_t>> storage(channels, std::vector<int32_t>(frames));
+	std::vector<void*> blocks(channels);
+	for (unsigned c = 0; c < channels; ++c) blocks[c] = storage[c].data( );
+
+	SetStreamingThreshold(stream ? 0 : std::numeric_limits<size_t>::max( ));
+	const unsigned cycles = (1 << 27) / (channels * frames) + 4;
+	float acc = 0;
+	auto t0 = std::chrono::high_resolution_clock::now( );
+	for (unsigned i = 0; i < cycles; ++i) {
+		kernels.DeInterleave(interleaved.data( ), blocks.data( ), frames, channels, channels);
+		for (size_t j = 0; j < workingSet.size( ); j += 16) acc += workingSet[j];
+	}
+	auto t1 = std::chrono::high_resolution_clock::now( );
+	sink = acc;
+
+	/* samples per nanosecond, working set pass included */
+	return double(cycles) * channels * frames / std::chrono::duration<double, std::nano>(t1 - t0).count( );
+}
+
+int main( ) {
+	const unsigned channels = 32;
+	const size_t defaultThreshold = GetStreamingThreshold( );
+	std::vector<float> workingSet(256 * 1024 / sizeof(float), 1.f);
+
+	std::printf("%-8s %-12s %12s %10s %10s\n", "isa", "format", "dest bytes", "cached", "streamed");
+	for (int i = 0; i < (int)ConverterISA::NumISAs; ++i) {
+		ConverterISA isa = (ConverterISA)i;
+		if (IsSupported(isa) == false) continue;
+		for (auto fmt : formats) {
+			auto& kernels(GetChannelKernels(fmt, isa));
+			unsigned sampleBytes = fmt == HostFormat::Int16LSB ? 2 : 4;
+			size_t crossover = 0;
+			for (unsigned frames = 256; frames <= 256 * 1024; frames *= 2) {
+				size_t bytes = size_t(frames) * channels * sampleBytes;
+				double cached = Measure(kernels, channels, frames, false, workingSet);
+				double streamed = Measure(kernels, channels, frames, true, workingSet);
+				if (streamed < cached) crossover = 0;
+				else if (crossover == 0) crossover = bytes;
+				std::printf("%-8s %-12s %12zu %10.3f %10.3f\n", GetName(isa), GetName(fmt), bytes, cached, streamed);
+			}
+			if (crossover) std::printf("%-8s %-12s streaming wins from %zu bytes\n", GetName(isa), GetName(fmt), crossover);
+			else std::printf("%-8s %-12s streaming never wins\n", GetName(isa), GetName(fmt));
+		}
+	}
+	SetStreamingThreshold(defaultThreshold);
+	std::printf("(samples per nanosecond, %u channels, default threshold %zu bytes)\n", channels, defaultThreshold);
+	return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdio>
+#include <chrono>
+#include "pad.h"
+
+/* shared by the tests: a failure count reported by Check, and a device that only exists to
+   have DispatchBufferSwitch called on it */
+
+static int failures = 0;
+
+static inline void Check(bool ok, const char *what) {
+	if (!ok && failures++ < 20) std::fprintf(stderr, "FAIL %s\n", what);
+}
+
+class StubDevice : public PAD::AudioDevice {
+	unsigned numInputs, numOutputs;
+public:
+	StubDevice(unsigned inputs = 2, unsigned outputs = 2) :numInputs(inputs), numOutputs(outputs) { }
+	unsigned GetNumInputs( ) const { return numInputs; }
+	unsigned GetNumOutputs( ) const { return numOutputs; }
+	const char *GetName( ) const { return "stub"; }
+	const char *GetHostAPI( ) const { return "stub"; }
+	bool Supports(const PAD::AudioStreamConfiguration&) const { return true; }
+	PAD::AudioStreamConfiguration DefaultMono( ) const { return PAD::AudioStreamConfiguration( ); }
+	PAD::AudioStreamConfiguration DefaultStereo( ) const { return PAD::AudioStreamConfiguration( ); }
+	PAD::AudioStreamConfiguration DefaultAllChannels( ) const { return PAD::AudioStreamConfiguration( ); }
+	const PAD::AudioStreamConfiguration& Open(const PAD::AudioStreamConfiguration& c) { return c; }
+	void Resume( ) { }
+	void Suspend( ) { }
+	void Close( ) { }
+	GetDeviceTime GetDeviceTimeCallback( ) const { return nullptr; }
+	std::chrono::microseconds DeviceTimeNow( ) const { return std::chrono::microseconds(0); }
+};
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <limits>
+#include "pad_converters.h"
+
+using namespace PAD::Converter;
+
+/* compares the frame tiled traversal of the converters with their default traversal, which
+   converts one register bundle of channels over the whole buffer at a time and so strides
+   through the interleaved buffer once per bundle; tiling is forced with a zero threshold. The
+   last column is interleave with the automatic per-ISA default */
+
+static const HostFormat formats[] = { HostFormat::Int16LSB, HostFormat::Int32LSB, HostFormat::Float32LSB };
+
+static const size_t untiled = std::numeric_limits<size_t>::max( ), tiled = 0;
+
+static double Measure(const ChannelKernels& kernels, unsigned channels, unsigned frames, size_t threshold, bool interleave) {
+	std::vector<float> interleaved(channels * frames, 0.25f);
+	std::vector<std::vector<int32_t>> storage(channels, std::vector<int32_t>(frames));
+	std::vector<void*> blocks(channels);
+	for (unsigned c = 0; c < channels; ++c) blocks[c] = storage[c].data( );
+
+	const unsigned cycles = (1 << 26) / (channels * frames) + 1;
+	SetTilingThreshold(threshold);
+	auto t0 = std::chrono::high_resolution_clock::now( );
+	for (unsigned i = 0; i < cycles; ++i) {
+		if (interleave) kernels.Interleave(interleaved.data( ), (const void**)blocks.data( ), frames, channels, channels);
+		else kernels.DeInterleave(interleaved.data( ), blocks.data( ), frames, channels, channels);
+	}
+	auto t1 = std::chrono::high_resolution_clock::now( );
+
+	/* samples per nanosecond */
+	return double(cycles) * channels * frames / std::chrono::duration<double, std::nano>(t1 - t0).count( );
+}
+
+int main( ) {
+	const unsigned frames = 1024;
+	const size_t defaultTiling = GetTilingThreshold( );
+	std::printf("%-8s %-12s %8s %13s %12s %12s %12s %12s\n", "isa", "format", "channels", "deint untiled", "deint tiled", "int untiled", "int tiled", "int default");
+	for (int i = 0; i < (int)ConverterISA::NumISAs; ++i) {
+		ConverterISA isa = (ConverterISA)i;
+		if (IsSupported(isa) == false) continue;
+		for (auto fmt : formats) {
+			auto& kernels(GetChannelKernels(fmt, isa));
+			for (unsigned channels : { 64u, 128u, 256u }) {
+				std::printf("%-8s %-12s %8u %13.3f %12.3f %12.3f %12.3f %12.3f\n", GetName(isa), GetName(fmt), channels,
+					Measure(kernels, channels, frames, untiled, false), Measure(kernels, channels, frames, tiled, false),
+					Measure(kernels, channels, frames, untiled, true), Measure(kernels, channels, frames, tiled, true),
+					Measure(kernels, channels, frames, AutomaticTiling, true));
+			}
+		}
+	}
+	SetTilingThreshold(defaultTiling);
+	std::printf("(samples per nanosecond, %u frames)\n", frames);
+	return 0;
+}
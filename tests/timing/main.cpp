@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* checks the statistics of the cycle timing ring on synthetic cycles, and that snapshots
+   taken while the audio thread keeps writing are contiguous and never torn */
+
+static bool Near(double a, double b) {
+	return std::fabs(a - b) < 1e-12;
+}
+
+/* every field follows from the index, so a torn slot can be recognized */
+static CycleTiming Synthetic(uint64_t n) {
+	const int64_t period = 1000000;
+	CycleTiming t;
+	t.start = int64_t(n) * period;
+	t.period = period;
+	t.input = 1000 + int64_t(n % 7);
+	t.process = int64_t(n % 100) * 5000;
+	t.output = 2000 + int64_t(n % 7);
+	return t;
+}
+
+static bool Consistent(const CycleTiming& t) {
+	auto n = uint64_t(t.start / t.period);
+	auto s = Synthetic(n);
+	return t.input == s.input && t.process == s.process && t.output == s.output;
+}
+
+int main( ) {
+	{
+		CycleTimingRing ring;
+		auto stats = ring.GetStatistics( );
+		Check(stats.cycles == 0 && stats.max == 0, "an empty ring has no statistics");
+
+		/* 100 cycles of a 1 ms period with process times 0, 5, .. 495 us */
+		for (uint64_t n = 0; n < 100; ++n) ring.Push(Synthetic(n));
+		stats = ring.GetStatistics( );
+		Check(stats.cycles == 100, "all cycles are in the snapshot");
+		Check(Near(stats.intervalJitter, 0) && Near(stats.maxIntervalError, 0), "regular cycles have no jitter");
+		Check(Near(stats.processP99, 495e-6), "p99 of the process stage");
+		Check(Near(stats.p50, 250e-6 + 3e-6 + 2 * (50 % 7) * 1e-9), "p50 of the whole cycle");
+		Check(Near(stats.max, 495e-6 + 3e-6 + 2 * (99 % 7) * 1e-9), "longest cycle");
+		Check(Near(stats.minMargin, 1e-3 - stats.max), "margin of the longest cycle");
+
+		/* one cycle starting 200 us late */
+		auto late = Synthetic(100);
+		late.start += 200000;
+		ring.Push(late);
+		stats = ring.GetStatistics( );
+		Check(Near(stats.maxIntervalError, 200e-6), "a late start shows as interval error");
+		Check(stats.intervalJitter > 0, "a late start shows as jitter");
+
+		/* an overrun leaves a negative margin */
+		auto overrun = Synthetic(101);
+		overrun.process = 1500000;
+		ring.Push(overrun);
+		Check(ring.GetStatistics( ).minMargin < 0, "an overrun has a negative margin");
+
+		for (uint64_t n = 102; n < 5000; ++n) ring.Push(Synthetic(n));
+		auto snapshot = ring.Snapshot( );
+		Check(snapshot.size( ) == CycleTimingRing::Capacity, "a full ring holds its capacity");
+		Check(snapshot.back( ).start == Synthetic(4999).start, "the snapshot ends at the latest cycle");
+	}
+
+	{
+		CycleTimingRing ring;
+		std::atomic<bool> running(true);
+		std::thread audio([&]( ) {
+			for (uint64_t n = 0; running.load( ); ++n) ring.Push(Synthetic(n));
+		});
+
+		unsigned snapshots = 0;
+		auto end = std::chrono::steady_clock::now( ) + std::chrono::milliseconds(500);
+		while (std::chrono::steady_clock::now( ) < end) {
+			auto s = ring.Snapshot( );
+			for (size_t i = 0; i < s.size( ); ++i) {
+				Check(Consistent(s[i]), "torn slot in a snapshot");
+				if (i) Check(s[i].start - s[i - 1].start == s[i].period, "snapshot is not contiguous");
+			}
+			++snapshots;
+			std::this_thread::yield( );
+		}
+		running.store(false);
+		audio.join( );
+		std::printf("%u snapshots of %llu cycles\n", snapshots, (unsigned long long)ring.GetCount( ));
+	}
+
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include "pad.h"
+#include "../testing.h"
+
+using namespace PAD;
+
+/* drives a device with buffer timestamps that skip ahead and checks the xruns the gap
+   detector raises, the counters, that backend reports and stream restarts are not
+   counted twice, and reports from another thread while buffers are dispatched */
+
+int main( ) {
+	/* 480 frames at 48 kHz: a 10 ms period */
+	AudioStreamConfiguration cfg(48000.0);
+	float output[480];
+	StubDevice dev(0, 1);
+	std::vector<XrunInfo> seen;
+	dev.XrunOccurred = [&](XrunInfo x) { seen.push_back(x); };
+
+	std::chrono::microseconds now(1000000);
+	auto cycle = [&](std::chrono::microseconds advance) {
+		now += advance;
+		IO io{ cfg, nullptr, output, 480, now, now };
+		dev.DispatchBufferSwitch(io);
+	};
+
+	const std::chrono::microseconds period(10000);
+	for (int i = 0; i < 10; ++i) cycle(period);
+	cycle(period + std::chrono::microseconds(4000));
+	Check(seen.empty( ), "jitter under half a period is not an xrun");
+
+	/* two buffers late */
+	cycle(3 * period);
+	Check(seen.size( ) == 1, "a gap of two buffers is an xrun");
+	if (seen.size( ) == 1) {
+		Check(seen[0].framesLost == 960, "frames lost in the gap");
+		Check(seen[0].cycle == 11, "cycle of the xrun");
+		Check(seen[0].stage == XrunStage::Scheduling, "a gap after a short cycle is late scheduling");
+	}
+	Check(dev.GetXruns( ).GetCount( ) == 1 && dev.GetXruns( ).GetFramesLost( ) == 960, "counters");
+
+	/* a backend report covers the gap that follows it */
+	dev.ReportXrun(XrunStage::Device, 480);
+	cycle(2 * period);
+	Check(seen.size( ) == 2 && seen.back( ).stage == XrunStage::Device, "backend reports raise the event");
+	Check(dev.GetXruns( ).GetCount( ) == 2 && dev.GetXruns( ).GetFramesLost( ) == 1440, "reported xruns are counted once");
+
+	/* a previous cycle that ran past its period is blamed for the gap */
+	dev.BufferSwitch = [](IO) { std::this_thread::sleep_for(std::chrono::milliseconds(15)); };
+	cycle(period);
+	dev.BufferSwitch = [](IO) { };
+	cycle(2 * period);
+	Check(seen.size( ) == 3 && seen.back( ).stage == XrunStage::Process, "an overrun in the client is blamed on Process");
+
+	/* a stream restart is not a gap */
+	dev.ResetXrunDetector( );
+	cycle(std::chrono::microseconds(5000000));
+	cycle(period);
+	Check(seen.size( ) == 3, "restart after ResetXrunDetector");
+
+	/* without timestamps there is nothing to detect */
+	IO untimed{ cfg, nullptr, output, 480, std::chrono::microseconds(0), std::chrono::microseconds(0) };
+	dev.DispatchBufferSwitch(untimed);
+	cycle(period);
+	Check(seen.size( ) == 3, "cycles without timestamps");
+
+	{
+		/* a notification thread of the backend reports while the audio thread dispatches */
+		const unsigned reports = 1000, buffers = 5000;
+		std::atomic<unsigned> reported(0), misplaced(0);
+		std::atomic<uint64_t> dispatched(0);
+		uint64_t first = 0;
+		dev.XrunOccurred = [&](XrunInfo x) { first = x.cycle; };
+		dev.ReportXrun(XrunStage::Device, 0);
+		dev.XrunOccurred = [&](XrunInfo x) {
+			if (x.stage != XrunStage::Device) return;
+			/* the cycle is one the audio thread has reached */
+			if (x.cycle < first || x.cycle > first + dispatched.load( )) misplaced++;
+			reported++;
+		};
+		uint64_t counted = dev.GetXruns( ).GetCount( );
+		std::thread notifier([&]( ) {
+			for (unsigned i = 0; i < reports; ++i) dev.ReportXrun(XrunStage::Device, 1);
+		});
+		for (unsigned i = 0; i < buffers; ++i) {
+			cycle(period);
+			dispatched++;
+		}
+		notifier.join( );
+		Check(reported.load( ) == reports, "reports from another thread raise the event");
+		Check(misplaced.load( ) == 0, "cycle of a report from another thread");
+		Check(dev.GetXruns( ).GetCount( ) == counted + reports, "reports from another thread are counted");
+	}
+
+	if (failures) std::fprintf(stderr, "%d failures\n", failures);
+	return failures ? 1 : 0;
+}